@@ -0,0 +1,60 @@
+/*
+ * ps - list processes.
+ *
+ * Usage: ps
+ *
+ * Shows, for each process, its pid and parent's pid (-1 if nobody
+ * will wait for it), its state, number of threads and scheduler run
+ * queue level, the clock ticks it has used in user mode and in the
+ * kernel, its stride scheduling tickets (0 if it has none, see
+ * __tickets), how many times it gave up the CPU by sleeping (voluntary
+ * switches) or was preempted (involuntary ones), how many of its
+ * pages are in RAM, and its name.
+ */
+
+#include <sys/types.h>
+#include <sys/psinfo.h>
+#include <stdio.h>
+#include <err.h>
+
+#define MAXPROCS 256
+
+static struct psinfo procs[MAXPROCS];
+
+static const char *const statenames[] = {
+	"run", "ready", "sleep", "zombie",
+};
+
+int
+main(void)
+{
+	const char *state;
+	int n, i;
+
+	n = __psinfo(procs, MAXPROCS);
+	if (n < 0) {
+		err(1, "__psinfo");
+	}
+
+	printf("%5s %5s %-6s %3s %3s %8s %8s %5s %7s %7s %5s  %s\n",
+	       "pid", "ppid", "state", "thr", "lvl", "utime", "stime",
+	       "tix", "vcsw", "ivcsw", "rss", "name");
+	for (i=0; i<n; i++) {
+		state = "?";
+		if (procs[i].ps_state >= PS_RUN &&
+		    procs[i].ps_state <= PS_ZOMB) {
+			state = statenames[procs[i].ps_state];
+		}
+		printf("%5d %5d %-6s %3d %3d %8lu %8lu %5d %7lu %7lu %5lu  %s\n",
+		       procs[i].ps_pid, procs[i].ps_ppid, state,
+		       procs[i].ps_nthreads, procs[i].ps_level,
+		       (unsigned long) procs[i].ps_utime,
+		       (unsigned long) procs[i].ps_stime,
+		       procs[i].ps_tickets,
+		       (unsigned long) procs[i].ps_nvcsw,
+		       (unsigned long) procs[i].ps_nivcsw,
+		       (unsigned long) procs[i].ps_rss,
+		       procs[i].ps_name);
+	}
+	return 0;
+}
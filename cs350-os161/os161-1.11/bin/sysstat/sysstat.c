@@ -0,0 +1,66 @@
+/*
+ * sysstat - print system call statistics.
+ *
+ * Usage: sysstat
+ *
+ * Shows, for each system call that has been made, how many times it
+ * was called, how many calls failed, the average and worst latency in
+ * microseconds, and a histogram of latencies by decade (<10us,
+ * <100us, ... <1s, >=1s).
+ */
+
+#include <sys/types.h>
+#include <sys/sysstat.h>
+#include <stdio.h>
+#include <err.h>
+
+static struct sysstat stats[SYSSTAT_NCALLS];
+
+int
+main(void)
+{
+	unsigned long avg, done;
+	int n, i, b;
+
+	n = __sysstat(stats, SYSSTAT_NCALLS);
+	if (n < 0) {
+		err(1, "__sysstat");
+	}
+
+	printf("%-16s %8s %6s %10s %10s  histogram\n",
+	       "call", "count", "errors", "avg us", "max us");
+	for (i=0; i<n; i++) {
+		if (stats[i].ss_count == 0) {
+			continue;
+		}
+
+		/* average over the calls that returned */
+		done = 0;
+		for (b=0; b<SYSSTAT_NBUCKETS; b++) {
+			done += stats[i].ss_hist[b];
+		}
+		avg = 0;
+		if (done > 0) {
+			avg = stats[i].ss_secs < 4000 ?
+				(stats[i].ss_secs*1000000UL +
+				 stats[i].ss_usecs) / done :
+				(stats[i].ss_secs / done) * 1000000UL;
+		}
+
+		if (stats[i].ss_name[0]) {
+			printf("%-16s", stats[i].ss_name);
+		}
+		else {
+			printf("%-16d", i);
+		}
+		printf(" %8lu %6lu %10lu %10lu ",
+		       (unsigned long) stats[i].ss_count,
+		       (unsigned long) stats[i].ss_errors,
+		       avg, (unsigned long) stats[i].ss_max);
+		for (b=0; b<SYSSTAT_NBUCKETS; b++) {
+			printf(" %lu", (unsigned long) stats[i].ss_hist[b]);
+		}
+		printf("\n");
+	}
+	return 0;
+}
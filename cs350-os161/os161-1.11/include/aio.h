@@ -0,0 +1,19 @@
+#ifndef _AIO_H_
+#define _AIO_H_
+
+/*
+ * Get struct aiocb and the AIO_* constants from the kernel
+ */
+#include <sys/types.h>
+#include <kern/aio.h>
+
+/*
+ * Asynchronous I/O system calls. See <kern/aio.h> for details.
+ * aio_submit returns a request id; aio_wait returns the byte count
+ * of the finished request, or -1 with errno set (EAGAIN with
+ * AIO_NOWAIT if it isn't finished yet).
+ */
+int aio_submit(const struct aiocb *cb);
+int aio_wait(int id, int flags);
+
+#endif /* _AIO_H_ */
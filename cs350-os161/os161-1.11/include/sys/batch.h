@@ -0,0 +1,32 @@
+#ifndef _SYS_BATCH_H_
+#define _SYS_BATCH_H_
+
+/*
+ * Get the ring layout and operation codes from the kernel
+ */
+#include <kern/batch.h>
+
+/*
+ * The system calls. __batch_register tells the kernel where the
+ * process's ring is (NULL to forget it); __batch_submit runs the
+ * queued operations and returns how many it ran.
+ */
+int __batch_register(struct batch_ring *ring);
+int __batch_submit(void);
+
+/*
+ * Wrapper routines in libc.
+ *
+ * batch_init clears RING and registers it. batch_queue adds one
+ * operation, failing with EAGAIN if the submission queue is full.
+ * batch_submit hands everything queued to the kernel. batch_reap
+ * copies out the oldest completion and returns 1, or returns 0 if
+ * there are none left.
+ */
+int batch_init(struct batch_ring *ring);
+int batch_queue(struct batch_ring *ring, int op, int fd, void *buf,
+		unsigned len, int arg, unsigned cookie);
+int batch_submit(struct batch_ring *ring);
+int batch_reap(struct batch_ring *ring, struct batch_cqe *ret);
+
+#endif /* _SYS_BATCH_H_ */
@@ -0,0 +1,15 @@
+#ifndef _SYS_PSINFO_H_
+#define _SYS_PSINFO_H_
+
+/*
+ * Get struct psinfo and the PS_* constants from the kernel
+ */
+#include <kern/psinfo.h>
+
+/*
+ * Copy a snapshot of up to N processes into BUF, in pid order.
+ * Returns how many entries were filled in.
+ */
+int __psinfo(struct psinfo *buf, int n);
+
+#endif /* _SYS_PSINFO_H_ */
@@ -0,0 +1,16 @@
+#ifndef _SYS_SYSSTAT_H_
+#define _SYS_SYSSTAT_H_
+
+/*
+ * Get struct sysstat and the SYSSTAT_* constants from the kernel
+ */
+#include <kern/sysstat.h>
+
+/*
+ * Copy the kernel's statistics for the first N call numbers into
+ * BUF. Returns how many entries were filled in (at most
+ * SYSSTAT_NCALLS).
+ */
+int __sysstat(struct sysstat *buf, int n);
+
+#endif /* _SYS_SYSSTAT_H_ */
@@ -0,0 +1,18 @@
+#ifndef _SYS_USERPAGE_H_
+#define _SYS_USERPAGE_H_
+
+/*
+ * Get struct userpage and USERPAGE_ADDR from the kernel
+ */
+#include <kern/userpage.h>
+
+/*
+ * libc's getpid() and __time() read the user page instead of making
+ * a system call. These are the system calls themselves, for when the
+ * page won't do: __sys___time reads the clock directly, where the
+ * page's copy is only updated once a clock tick.
+ */
+pid_t __sys_getpid(void);
+time_t __sys___time(time_t *seconds, unsigned long *nanoseconds);
+
+#endif /* _SYS_USERPAGE_H_ */
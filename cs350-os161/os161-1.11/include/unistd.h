@@ -120,6 +120,12 @@ int dup2(int filehandle, int newhandle);
 int pipe(int filehandles[2]);
 time_t __time(time_t *seconds, unsigned long *nanoseconds);
 int __getcwd(char *buf, size_t buflen);
+pid_t __spawn(const char *prog, char *const *args);
+int __thread_create(void (*entry)(int), void *stack, int arg);
+__DEAD void __thread_exit(int code);
+int __thread_join(int tid, int *code);
+int nanosleep(const struct timespec *req, struct timespec *rem);
+int __tickets(pid_t pid, int tickets);
 /* stat - see sys/stat.h */
 /* lstat - see sys/stat.h */
 
@@ -129,5 +135,11 @@ int __getcwd(char *buf, size_t buflen);
 
 char *getcwd(char *buf, size_t buflen);		/* calls __getcwd */
 time_t time(time_t *seconds);			/* calls __time */
+unsigned long __time_ms(void);			/* calls __sys___time */
+unsigned sleep(unsigned seconds);		/* calls nanosleep */
+pid_t spawnv(const char *prog, char *const *args); /* calls __spawn */
+int threadfork(void (*func)(void));		/* calls __thread_create */
+__DEAD void threadexit(int code);		/* calls __thread_exit */
+int threadjoin(int tid, int *code);		/* calls __thread_join */
 
 #endif /* _UNISTD_H_ */
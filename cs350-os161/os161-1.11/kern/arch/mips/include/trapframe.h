@@ -74,4 +74,11 @@ struct trapframe {
 void mips_usermode(struct trapframe *tf);
 void md_forkentry(void* tf, unsigned long data);
 
+/*
+ * The trapframe of the interrupt being handled, set by mips_trap
+ * before calling the handler. Lets the clock code see where it
+ * interrupted. Only meaningful inside an interrupt handler.
+ */
+extern struct trapframe *curintrframe;
+
 #endif /* _MIPS_TRAPFRAME_H_ */
@@ -7,6 +7,7 @@
 #include <vm.h>
 #include <machine/spl.h>
 #include <machine/tlb.h>
+#include <userpage.h>
 
 /*
  * Dumb MIPS-only "VM system" that is intended to only be just barely
@@ -88,6 +89,11 @@ vm_fault(int faulttype, vaddr_t faultaddress)
 
 	DEBUG(DB_VM, "dumbvm: fault: 0x%x\n", faultaddress);
 
+	if (faultaddress == USERPAGE_ADDR) {
+		splx(spl);
+		return userpage_fault(faulttype);
+	}
+
 	switch (faulttype) {
 	    case VM_FAULT_READONLY:
 		/* We always create pages read-write, so we can't get this */
@@ -176,6 +182,18 @@ as_destroy(struct addrspace *as)
 	kfree(as);
 }
 
+u_int32_t
+as_resident(struct addrspace *as)
+{
+	u_int32_t n;
+
+	n = as->as_npages1 + as->as_npages2;
+	if (as->as_stackpbase != 0) {
+		n += DUMBVM_STACKPAGES;
+	}
+	return n;
+}
+
 void
 as_activate(struct addrspace *as)
 {
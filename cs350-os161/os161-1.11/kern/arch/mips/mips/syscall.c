@@ -9,12 +9,12 @@
 #include <thread.h>
 #include <synch.h>
 #include <curthread.h>
+#include <clock.h>
+#include <sysstat.h>
+#include <ktrace.h>
 #include "opt-A2.h"
 
-extern struct semaphore* forksem;
-extern struct semaphore* t;
 extern void as_activate(struct addrspace*);
-extern void V(struct semaphore*);
 /*
  * System call handler.
  *
@@ -58,11 +58,17 @@ mips_syscall(struct trapframe *tf)
 	int callno;
 	int32_t retval;
 	int err;
+	time_t secs;
+	u_int32_t nsecs;
 
 	assert(curspl==0);
 
 	callno = tf->tf_v0;
 
+	sysstat_enter(callno);
+	KTRACE(KTRACE_SYSCALL, KT_SYSENTER, callno, 0);
+	gettime(&secs, &nsecs);
+
 	/*
 	 * Initialize retval to 0. Many of the system calls don't
 	 * really return a value, just 0 for success and -1 on
@@ -97,6 +103,14 @@ mips_syscall(struct trapframe *tf)
                  err = 0;
                  retval = sys_write(tf->tf_a0,(const void*)tf->tf_a1,tf->tf_a2,&err);
                  break;
+            case SYS_lseek:
+                 err = 0;
+                 retval = sys_lseek(tf->tf_a0,tf->tf_a1,tf->tf_a2,&err);
+                 break;
+            case SYS_pipe:
+                 err = 0;
+                 retval = sys_pipe((int*)tf->tf_a0,&err);
+                 break;
             case SYS_fork:
                  err = 0;
                  retval = sys_fork(tf,&err);
@@ -105,6 +119,14 @@ mips_syscall(struct trapframe *tf)
                  err = 0;
                  retval = sys_getpid();
                  break;
+            case SYS___time:
+                 err = 0;
+                 retval = sys___time((time_t*)tf->tf_a0,(unsigned long*)tf->tf_a1,&err);
+                 break;
+            case SYS_nanosleep:
+                 err = 0;
+                 retval = sys_nanosleep((const struct timespec*)tf->tf_a0,(struct timespec*)tf->tf_a1,&err);
+                 break;
             case SYS_waitpid:
                  err = 0;
                  retval = sys_waitpid(tf->tf_a0,(int*)tf->tf_a1,tf->tf_a2,&err);
@@ -117,6 +139,49 @@ mips_syscall(struct trapframe *tf)
                  err = 0;
                  retval = sys_execv((const char*)tf->tf_a0,(char**)tf->tf_a1,&err);
                  break;
+            case SYS___spawn:
+                 err = 0;
+                 retval = sys___spawn((const char*)tf->tf_a0,(char**)tf->tf_a1,&err);
+                 break;
+            case SYS___batch_register:
+                 err = 0;
+                 retval = sys___batch_register((struct batch_ring*)tf->tf_a0,&err);
+                 break;
+            case SYS___batch_submit:
+                 err = 0;
+                 retval = sys___batch_submit(&err);
+                 break;
+            case SYS_aio_submit:
+                 err = 0;
+                 retval = sys_aio_submit((const struct aiocb*)tf->tf_a0,&err);
+                 break;
+            case SYS_aio_wait:
+                 err = 0;
+                 retval = sys_aio_wait(tf->tf_a0,tf->tf_a1,&err);
+                 break;
+            case SYS___thread_create:
+                 err = 0;
+                 retval = sys___thread_create(tf->tf_a0,tf->tf_a1,tf->tf_a2,&err);
+                 break;
+            case SYS___thread_exit:
+                 sys___thread_exit(tf->tf_a0);
+                 break;
+            case SYS___thread_join:
+                 err = 0;
+                 retval = sys___thread_join(tf->tf_a0,(int*)tf->tf_a1,&err);
+                 break;
+            case SYS___sysstat:
+                 err = 0;
+                 retval = sys___sysstat((struct sysstat*)tf->tf_a0,tf->tf_a1,&err);
+                 break;
+            case SYS___psinfo:
+                 err = 0;
+                 retval = sys___psinfo((struct psinfo*)tf->tf_a0,tf->tf_a1,&err);
+                 break;
+            case SYS___tickets:
+                 err = 0;
+                 retval = sys___tickets(tf->tf_a0,tf->tf_a1,&err);
+                 break;
             #endif
 	    default:
 		kprintf("Unknown syscall %d\n", callno);
@@ -139,6 +204,9 @@ mips_syscall(struct trapframe *tf)
 		tf->tf_v0 = retval;
 		tf->tf_a3 = 0;      /* signal no error */
 	}
+
+	sysstat_exit(callno, err, secs, nsecs);
+	KTRACE(KTRACE_SYSCALL, KT_SYSEXIT, callno, err);
 	
 	/*
 	 * Now, advance the program counter, to avoid restarting
@@ -169,8 +237,6 @@ md_forkentry(void* tf ,unsigned long as)
     // activate
     as_activate(curthread->t_vmspace);
   //    kprintf("in md_forkentry, current pid is %d, parent pid is %d\n",curthread->pid,curthread->ppid);
-    V(forksem);
-    V(t);
     mips_usermode(&new);
     panic("error: return from mips_usermode()\n");
 }
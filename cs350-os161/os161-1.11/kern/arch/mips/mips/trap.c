@@ -7,11 +7,15 @@
 #include <vm.h>
 #include <thread.h>
 #include <curthread.h>
+#include <uthread.h>
+#include <userpage.h>
 
 #include "opt-A2.h"
 
 extern u_int32_t curkstack;
 
+struct trapframe *curintrframe;
+
 /* in exception.S */
 extern void asm_usermode(struct trapframe *tf);
 extern int sys__exit(int);
@@ -90,6 +94,8 @@ mips_trap(struct trapframe *tf)
 
 	/* Interrupt? Call the interrupt handler and return. */
 	if (code == EX_IRQ) {
+		/* in case it's the clock: let it see where we were */
+		curintrframe = tf;
 		mips_interrupt(tf->tf_cause);
 		goto done;
 	}
@@ -209,9 +215,26 @@ mips_trap(struct trapframe *tf)
 	panic("OS:I can't handle this.. I'm stupid\n");
 
  done:
+        #if OPT_A2
+        /*
+         * If another thread of this process is ending it, don't go
+         * back to user mode; leave instead.
+         */
+        if (!iskern && curthread->exiting) {
+           splx(savespl);
+           uthread_leave();
+        }
+        #endif
+
 	/* Make sure interrupts are off */
 	splhigh();
 
+#if OPT_A2
+	if (!iskern) {
+		userpage_setpid(curthread->pid);
+	}
+#endif
+
 	/*
 	 * Restore previous context's curspl value.
 	 *
@@ -261,6 +284,10 @@ mips_usermode(struct trapframe *tf)
 	splhigh();
 	curspl = 0;
 
+#if OPT_A2
+	userpage_setpid(curthread->pid);
+#endif
+
 	/*
 	 * This assertion will fail if either
 	 *   (1) curkstack is corrupted, or
@@ -124,6 +124,24 @@ getch_intr(struct con_softc *cs)
 	return cs->cs_gotchar;
 }
 
+/*
+ * Same, for a user read: gives up with EINTR instead if the thread is
+ * interrupted, since input may never come.
+ */
+static
+int
+getch_user(struct con_softc *cs, char *ch)
+{
+	int result;
+
+	result = P_intr(cs->cs_rsem);
+	if (result) {
+		return result;
+	}
+	*ch = cs->cs_gotchar;
+	return 0;
+}
+
 /*
  * Called from underlying device when a read-ready interrupt occurs.
  */
@@ -228,7 +246,12 @@ con_io(struct device *dev, struct uio *uio)
 
 	while (uio->uio_resid > 0) {
 		if (uio->uio_rw==UIO_READ) {
-			ch = getch();
+			assert(the_console != NULL);
+			result = getch_user(the_console, &ch);
+			if (result) {
+				lock_release(lk);
+				return result;
+			}
 			if (ch=='\r') {
 				ch = '\n';
 			}
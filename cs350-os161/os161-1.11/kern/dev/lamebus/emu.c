@@ -21,6 +21,7 @@
 #include <uio.h>
 #include <vfs.h>
 #include <emufs.h>
+#include <elfcache.h>
 #include <lamebus/emu.h>
 #include <machine/bus.h>
 #include "autoconf.h"
@@ -552,6 +553,8 @@ emufs_write(struct vnode *v, struct uio *uio)
 
 	assert(uio->uio_rw==UIO_WRITE);
 
+	elfcache_invalidate(v);
+
 	while (uio->uio_resid > 0) {
 		amt = uio->uio_resid;
 		if (amt > EMU_MAXIO) {
@@ -681,6 +684,7 @@ int
 emufs_truncate(struct vnode *v, off_t len)
 {
 	struct emufs_vnode *ev = v->vn_data;
+	elfcache_invalidate(v);
 	return emu_trunc(ev->ev_emu, ev->ev_handle, len);
 }
 
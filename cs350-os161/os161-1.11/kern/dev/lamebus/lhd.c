@@ -10,6 +10,7 @@
 #include <uio.h>
 #include <vfs.h>
 #include <lamebus/lhd.h>
+#include <ktrace.h>
 #include "autoconf.h"
 
 /* Registers (offsets within slot) */
@@ -218,6 +219,8 @@ lhd_io(struct device *d, struct uio *uio)
 		lhd_wreg(lh, LHD_REG_SECT, sector+i);
 
 		/* and start the operation. */
+		KTRACE(KTRACE_DISK, KT_DISKSTART, sector+i,
+		       uio->uio_rw == UIO_WRITE);
 		lhd_wreg(lh, LHD_REG_STAT, statval);
 
 		/* Now wait until the interrupt handler tells us we're done. */
@@ -225,6 +228,7 @@ lhd_io(struct device *d, struct uio *uio)
 
 		/* Get the result value saved by the interrupt handler. */
 		result = lh->lh_result;
+		KTRACE(KTRACE_DISK, KT_DISKDONE, sector+i, result);
 
 		/*
 		 * Are we reading? If so, and if we succeeded,
@@ -2,6 +2,7 @@
  * Driver for LAMEbus clock/timer card
  */
 #include <types.h>
+#include <kern/errno.h>
 #include <lib.h>
 #include <clock.h>
 #include <machine/bus.h>
@@ -22,6 +23,9 @@
 
 static int haveclock=0;
 
+/* The timer doing hardclock, for clock_oneshot and clock_periodic. */
+static struct ltimer_softc *hardclock_lt;
+
 /*
  * Setup routine called by autoconf stuff when an ltimer is found.
  */
@@ -35,6 +39,7 @@ config_ltimer(struct ltimer_softc *lt, int ltimerno)
 	if (!haveclock) {
 		haveclock = 1;
 		lt->lt_hardclock = 1;
+		hardclock_lt = lt;
 
 		/*
 		 * Arm the timer to go off HZ times a second, and set
@@ -58,6 +63,38 @@ config_ltimer(struct ltimer_softc *lt, int ltimerno)
 	return 0;
 }
 
+/*
+ * Tickless idle: turn off autoreload and count down once.
+ */
+int
+clock_oneshot(u_int32_t usecs)
+{
+	struct ltimer_softc *lt = hardclock_lt;
+
+	if (lt == NULL) {
+		return ENODEV;
+	}
+	bus_write_register(lt->lt_bus, lt->lt_buspos, LT_REG_ROE, 0);
+	bus_write_register(lt->lt_bus, lt->lt_buspos, LT_REG_COUNT, usecs);
+	return 0;
+}
+
+/*
+ * And back to HZ times a second, as set up by config_ltimer.
+ */
+void
+clock_periodic(void)
+{
+	struct ltimer_softc *lt = hardclock_lt;
+
+	if (lt == NULL) {
+		return;
+	}
+	bus_write_register(lt->lt_bus, lt->lt_buspos, LT_REG_ROE, 1);
+	bus_write_register(lt->lt_bus, lt->lt_buspos, LT_REG_COUNT,
+			   LT_GRANULARITY/HZ);
+}
+
 /*
  * Interrupt handler.
  */
@@ -7,6 +7,7 @@
 #include <types.h>
 #include <lib.h>
 #include <kern/errno.h>
+#include <synch.h>
 #include <array.h>
 #include <bitmap.h>
 #include <uio.h>
@@ -117,11 +118,13 @@ sfs_sync(struct fs *fs)
 	sfs = fs->fs_data;
 
 	/* Go over the array of loaded vnodes, syncing as we go. */
+	rwlock_acquire_read(sfs->sfs_vnlock);
 	num = array_getnum(sfs->sfs_vnodes);
 	for (i=0; i<num; i++) {
 		struct sfs_vnode *sv = array_getguy(sfs->sfs_vnodes, i);
 		VOP_FSYNC(&sv->sv_v);
 	}
+	rwlock_release_read(sfs->sfs_vnlock);
 
 	/* If the free block map needs to be written, write it. */
 	if (sfs->sfs_freemapdirty) {
@@ -178,6 +181,7 @@ sfs_unmount(struct fs *fs)
 	assert(sfs->sfs_freemapdirty==0);
 
 	/* Once we start nuking stuff we can't fail. */
+	rwlock_destroy(sfs->sfs_vnlock);
 	array_destroy(sfs->sfs_vnodes);
 	bitmap_destroy(sfs->sfs_freemap);
 	
@@ -246,6 +250,12 @@ sfs_domount(void *options, struct device *dev, struct fs **ret)
 		kfree(sfs);
 		return ENOMEM;
 	}
+	sfs->sfs_vnlock = rwlock_create("sfs_vnodes");
+	if (sfs->sfs_vnlock == NULL) {
+		array_destroy(sfs->sfs_vnodes);
+		kfree(sfs);
+		return ENOMEM;
+	}
 
 	/* Set the device so we can use sfs_rblock() */
 	sfs->sfs_device = dev;
@@ -253,6 +263,7 @@ sfs_domount(void *options, struct device *dev, struct fs **ret)
 	/* Load superblock */
 	result = sfs_rblock(sfs, &sfs->sfs_super, SFS_SB_LOCATION);
 	if (result) {
+		rwlock_destroy(sfs->sfs_vnlock);
 		array_destroy(sfs->sfs_vnodes);
 		kfree(sfs);
 		return result;
@@ -265,6 +276,7 @@ sfs_domount(void *options, struct device *dev, struct fs **ret)
 			"(0x%x, should be 0x%x)\n", 
 			sfs->sfs_super.sp_magic,
 			SFS_MAGIC);
+		rwlock_destroy(sfs->sfs_vnlock);
 		array_destroy(sfs->sfs_vnodes);
 		kfree(sfs);
 		return EINVAL;
@@ -281,6 +293,7 @@ sfs_domount(void *options, struct device *dev, struct fs **ret)
 	/* Load free space bitmap */
 	sfs->sfs_freemap = bitmap_create(SFS_FS_BITMAPSIZE(sfs));
 	if (sfs->sfs_freemap == NULL) {
+		rwlock_destroy(sfs->sfs_vnlock);
 		array_destroy(sfs->sfs_vnodes);
 		kfree(sfs);
 		return ENOMEM;
@@ -288,6 +301,7 @@ sfs_domount(void *options, struct device *dev, struct fs **ret)
 	result = sfs_mapio(sfs, UIO_READ);
 	if (result) {
 		bitmap_destroy(sfs->sfs_freemap);
+		rwlock_destroy(sfs->sfs_vnlock);
 		array_destroy(sfs->sfs_vnodes);
 		kfree(sfs);
 		return result;
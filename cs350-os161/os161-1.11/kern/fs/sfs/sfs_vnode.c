@@ -14,6 +14,7 @@
 #include <uio.h>
 #include <dev.h>
 #include <sfs.h>
+#include <elfcache.h>
 
 /* At bottom of file */
 static int 
@@ -863,9 +864,11 @@ sfs_reclaim(struct vnode *v)
 
 	/*
 	 * Make sure someone else hasn't picked up the vnode since the
-	 * decision was made to reclaim it. (You must also synchronize
-	 * this with sfs_loadvnode.)
+	 * decision was made to reclaim it. Holding the vnode table
+	 * exclusively until it's out of the table keeps sfs_loadvnode
+	 * from finding it in the meantime.
 	 */
+	rwlock_acquire_write(sfs->sfs_vnlock);
 	lock_acquire(v->vn_countlock);
 	if (v->vn_refcount != 1) {
 
@@ -874,6 +877,7 @@ sfs_reclaim(struct vnode *v)
 		v->vn_refcount--;
 
 		lock_release(v->vn_countlock);
+		rwlock_release_write(sfs->sfs_vnlock);
 		return EBUSY;
 	}
 	lock_release(v->vn_countlock);
@@ -883,6 +887,7 @@ sfs_reclaim(struct vnode *v)
 	if (sv->sv_i.sfi_linkcount==0) {
 		result = VOP_TRUNCATE(&sv->sv_v, 0);
 		if (result) {
+			rwlock_release_write(sfs->sfs_vnlock);
 			return result;
 		}
 	}
@@ -890,6 +895,7 @@ sfs_reclaim(struct vnode *v)
 	/* Sync the inode to disk */
 	result = sfs_sync_inode(sv);
 	if (result) {
+		rwlock_release_write(sfs->sfs_vnlock);
 		return result;
 	}
 
@@ -913,6 +919,7 @@ sfs_reclaim(struct vnode *v)
 		      sv->sv_ino);
 	}
 	array_remove(sfs->sfs_vnodes, ix);
+	rwlock_release_write(sfs->sfs_vnlock);
 
 	VOP_KILL(&sv->sv_v);
 
@@ -944,6 +951,7 @@ sfs_write(struct vnode *v, struct uio *uio)
 {
 	struct sfs_vnode *sv = v->vn_data;
 	assert(uio->uio_rw==UIO_WRITE);
+	elfcache_invalidate(v);
 	return sfs_io(sv, uio);
 }
 
@@ -1086,6 +1094,8 @@ sfs_truncate(struct vnode *v, off_t len)
 
 	assert(sizeof(idbuf)==SFS_BLOCKSIZE);
 
+	elfcache_invalidate(v);
+
 	/*
 	 * Go through the direct blocks. Discard any that are
 	 * past the limit we're truncating to.
@@ -1539,20 +1549,19 @@ static const struct vnode_ops sfs_dirops = {
 };
 
 /*
- * Function to load a inode into memory as a vnode, or dig up one
- * that's already resident.
+ * Look for inode INO in the vnodes table, and if it's there, return
+ * it with a new reference. The caller must hold sfs_vnlock, in
+ * either mode.
  */
 static
-int
-sfs_loadvnode(struct sfs_fs *sfs, u_int32_t ino, int forcetype,
-		 struct sfs_vnode **ret)
+struct sfs_vnode *
+sfs_findvnode(struct sfs_fs *sfs, u_int32_t ino)
 {
 	struct sfs_vnode *sv;
-	const struct vnode_ops *ops = NULL;
 	int i, num;
-	int result;
 
-	/* Look in the vnodes table */
+	assert(rwlock_is_held(sfs->sfs_vnlock));
+
 	num = array_getnum(sfs->sfs_vnodes);
 
 	/* Linear search. Is this too slow? You decide. */
@@ -1566,16 +1575,42 @@ sfs_loadvnode(struct sfs_fs *sfs, u_int32_t ino, int forcetype,
 		}
 
 		if (sv->sv_ino==ino) {
-			/* Found */
-
-			/* May only be set when creating new objects */
-			assert(forcetype==SFS_TYPE_INVAL);
-
 			VOP_INCREF(&sv->sv_v);
-			*ret = sv;
-			return 0;
+			return sv;
 		}
 	}
+	return NULL;
+}
+
+/*
+ * Function to load a inode into memory as a vnode, or dig up one
+ * that's already resident.
+ *
+ * Finding a resident vnode, the common case, only needs the table
+ * shared. Loading one reads the disk without the table locked, then
+ * looks again with it held exclusively before adding, in case
+ * somebody else loaded the same inode meanwhile.
+ */
+static
+int
+sfs_loadvnode(struct sfs_fs *sfs, u_int32_t ino, int forcetype,
+		 struct sfs_vnode **ret)
+{
+	struct sfs_vnode *sv, *sv2;
+	const struct vnode_ops *ops = NULL;
+	int result;
+
+	/* Look in the vnodes table */
+	rwlock_acquire_read(sfs->sfs_vnlock);
+	sv = sfs_findvnode(sfs, ino);
+	rwlock_release_read(sfs->sfs_vnlock);
+	if (sv != NULL) {
+		/* May only be set when creating new objects */
+		assert(forcetype==SFS_TYPE_INVAL);
+
+		*ret = sv;
+		return 0;
+	}
 
 	/* Didn't have it loaded; load it */
 
@@ -1637,8 +1672,19 @@ sfs_loadvnode(struct sfs_fs *sfs, u_int32_t ino, int forcetype,
 	/* Set the other fields in our vnode structure */
 	sv->sv_ino = ino;
 
-	/* Add it to our table */
+	/* Add it to our table, unless we lost a race to load it */
+	rwlock_acquire_write(sfs->sfs_vnlock);
+	sv2 = sfs_findvnode(sfs, ino);
+	if (sv2 != NULL) {
+		rwlock_release_write(sfs->sfs_vnlock);
+		assert(forcetype==SFS_TYPE_INVAL);
+		VOP_KILL(&sv->sv_v);
+		kfree(sv);
+		*ret = sv2;
+		return 0;
+	}
 	result = array_add(sfs->sfs_vnodes, sv);
+	rwlock_release_write(sfs->sfs_vnlock);
 	if (result) {
 		VOP_KILL(&sv->sv_v);
 		kfree(sv);
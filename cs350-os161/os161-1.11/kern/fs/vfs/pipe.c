@@ -0,0 +1,548 @@
+/*
+ * Pipes: an in-kernel ring buffer with a vnode for each end.
+ */
+#include <types.h>
+#include <lib.h>
+#include <synch.h>
+#include <kern/errno.h>
+#include <kern/unistd.h>
+#include <kern/stat.h>
+#include <vnode.h>
+#include <uio.h>
+#include <pipe.h>
+
+struct pipe {
+	struct lock *p_lock;          /* protects everything below */
+	struct cv *p_readcv;          /* readers wait here for data */
+	struct cv *p_writecv;         /* writers wait here for space */
+
+	char *p_buf;                  /* PIPE_SIZE ring buffer */
+	size_t p_head;                /* where the next read starts */
+	size_t p_count;               /* bytes in the ring */
+
+	int p_readopen;               /* read end still exists */
+	int p_writeopen;              /* write end still exists */
+
+	/*
+	 * A reader blocked on an empty pipe leaves its uio here, so a
+	 * writer can copy straight into it. Only kernel-space uios are
+	 * posted, since the writer runs in a different address space.
+	 */
+	struct uio *p_directuio;
+
+	struct vnode p_readvn;
+	struct vnode p_writevn;
+};
+
+static const struct vnode_ops pipe_read_ops;
+static const struct vnode_ops pipe_write_ops;
+
+static
+void
+pipe_destroy(struct pipe *p)
+{
+	cv_destroy(p->p_writecv);
+	cv_destroy(p->p_readcv);
+	lock_destroy(p->p_lock);
+	kfree(p->p_buf);
+	kfree(p);
+}
+
+int
+pipe_create(struct vnode **readend, struct vnode **writeend)
+{
+	struct pipe *p;
+	int result;
+
+	p = kmalloc(sizeof(struct pipe));
+	if (p == NULL) {
+		return ENOMEM;
+	}
+	p->p_buf = kmalloc(PIPE_SIZE);
+	p->p_lock = lock_create("pipe");
+	p->p_readcv = cv_create("pipe-read");
+	p->p_writecv = cv_create("pipe-write");
+	if (p->p_buf == NULL || p->p_lock == NULL || p->p_readcv == NULL ||
+	    p->p_writecv == NULL) {
+		if (p->p_writecv) cv_destroy(p->p_writecv);
+		if (p->p_readcv) cv_destroy(p->p_readcv);
+		if (p->p_lock) lock_destroy(p->p_lock);
+		if (p->p_buf) kfree(p->p_buf);
+		kfree(p);
+		return ENOMEM;
+	}
+
+	p->p_head = 0;
+	p->p_count = 0;
+	p->p_readopen = 1;
+	p->p_writeopen = 1;
+	p->p_directuio = NULL;
+
+	result = VOP_INIT(&p->p_readvn, &pipe_read_ops, NULL, p);
+	if (result) {
+		pipe_destroy(p);
+		return result;
+	}
+	result = VOP_INIT(&p->p_writevn, &pipe_write_ops, NULL, p);
+	if (result) {
+		VOP_KILL(&p->p_readvn);
+		pipe_destroy(p);
+		return result;
+	}
+
+	/* Each end starts out opened once, as if by vfs_open. */
+	VOP_INCOPEN(&p->p_readvn);
+	VOP_INCOPEN(&p->p_writevn);
+
+	*readend = &p->p_readvn;
+	*writeend = &p->p_writevn;
+	return 0;
+}
+
+int
+pipe_isvnode(struct vnode *v)
+{
+	return v->vn_ops == &pipe_read_ops || v->vn_ops == &pipe_write_ops;
+}
+
+/*
+ * Open: not reachable by name, so this only happens via pipe_create.
+ */
+static
+int
+pipe_open(struct vnode *v, int flags)
+{
+	(void)v;
+	(void)flags;
+	return 0;
+}
+
+static
+int
+pipe_close(struct vnode *v)
+{
+	(void)v;
+	return 0;
+}
+
+/*
+ * Called when the last reference to one end goes away. Wake up anyone
+ * on the other end so they see EOF or EPIPE, and free the pipe once
+ * both ends are gone.
+ */
+static
+int
+pipe_reclaim(struct vnode *v)
+{
+	struct pipe *p = v->vn_data;
+	int destroy;
+
+	lock_acquire(p->p_lock);
+	if (v == &p->p_readvn) {
+		p->p_readopen = 0;
+		cv_broadcast(p->p_writecv, p->p_lock);
+	}
+	else {
+		assert(v == &p->p_writevn);
+		p->p_writeopen = 0;
+		cv_broadcast(p->p_readcv, p->p_lock);
+	}
+	destroy = !p->p_readopen && !p->p_writeopen;
+	lock_release(p->p_lock);
+
+	VOP_KILL(v);
+	if (destroy) {
+		pipe_destroy(p);
+	}
+	return 0;
+}
+
+/*
+ * Move up to LEN bytes between the ring, starting at ring position
+ * POS, and UIO, wrapping at the end of the buffer.
+ */
+static
+int
+pipe_ringmove(struct pipe *p, size_t pos, size_t len, struct uio *uio)
+{
+	size_t chunk;
+	int result;
+
+	while (len > 0) {
+		chunk = PIPE_SIZE - pos;
+		if (chunk > len) {
+			chunk = len;
+		}
+		result = uiomove(p->p_buf + pos, chunk, uio);
+		if (result) {
+			return result;
+		}
+		pos = (pos + chunk) % PIPE_SIZE;
+		len -= chunk;
+	}
+	return 0;
+}
+
+static
+int
+pipe_read(struct vnode *v, struct uio *uio)
+{
+	struct pipe *p = v->vn_data;
+	size_t startresid = uio->uio_resid;
+	size_t amt;
+	int result;
+
+	assert(uio->uio_rw == UIO_READ);
+
+	lock_acquire(p->p_lock);
+
+	while (p->p_count == 0 && p->p_writeopen && uio->uio_resid > 0) {
+		if (p->p_directuio == NULL &&
+		    uio->uio_segflg == UIO_SYSSPACE) {
+			p->p_directuio = uio;
+		}
+		result = cv_wait_intr(p->p_readcv, p->p_lock);
+		if (p->p_directuio == uio) {
+			p->p_directuio = NULL;
+		}
+		if (uio->uio_resid != startresid) {
+			/* A writer copied straight into our buffer. */
+			lock_release(p->p_lock);
+			return 0;
+		}
+		if (result) {
+			lock_release(p->p_lock);
+			return result;
+		}
+	}
+
+	amt = p->p_count;
+	if (amt > uio->uio_resid) {
+		amt = uio->uio_resid;
+	}
+	result = pipe_ringmove(p, p->p_head, amt, uio);
+	if (result == 0) {
+		p->p_head = (p->p_head + amt) % PIPE_SIZE;
+		p->p_count -= amt;
+		if (amt > 0) {
+			cv_broadcast(p->p_writecv, p->p_lock);
+		}
+	}
+
+	lock_release(p->p_lock);
+	return result;
+}
+
+/*
+ * Hand data straight to the blocked reader whose uio is posted.
+ */
+static
+int
+pipe_directcopy(struct pipe *p, struct uio *uio)
+{
+	struct uio *ruio = p->p_directuio;
+	size_t amt;
+	int result;
+
+	assert(ruio->uio_segflg == UIO_SYSSPACE);
+
+	amt = ruio->uio_resid;
+	if (amt > uio->uio_resid) {
+		amt = uio->uio_resid;
+	}
+
+	/* uiomove copies from a UIO_WRITE uio into the kernel buffer */
+	result = uiomove(ruio->uio_iovec.iov_kbase, amt, uio);
+	if (result) {
+		return result;
+	}
+	ruio->uio_iovec.iov_kbase = (char *)ruio->uio_iovec.iov_kbase + amt;
+	ruio->uio_iovec.iov_len -= amt;
+	ruio->uio_offset += amt;
+	ruio->uio_resid -= amt;
+
+	p->p_directuio = NULL;
+	cv_broadcast(p->p_readcv, p->p_lock);
+	return 0;
+}
+
+static
+int
+pipe_write(struct vnode *v, struct uio *uio)
+{
+	struct pipe *p = v->vn_data;
+	size_t startresid = uio->uio_resid;
+	size_t amt;
+	int result = 0;
+
+	assert(uio->uio_rw == UIO_WRITE);
+
+	lock_acquire(p->p_lock);
+
+	while (uio->uio_resid > 0) {
+		if (!p->p_readopen) {
+			/* Report what got through, if anything did. */
+			if (uio->uio_resid == startresid) {
+				result = EPIPE;
+			}
+			break;
+		}
+
+		if (p->p_directuio != NULL && p->p_count == 0) {
+			result = pipe_directcopy(p, uio);
+			if (result) {
+				break;
+			}
+			continue;
+		}
+
+		amt = PIPE_SIZE - p->p_count;
+		if (amt == 0) {
+			result = cv_wait_intr(p->p_writecv, p->p_lock);
+			if (result) {
+				/* As above. */
+				if (uio->uio_resid != startresid) {
+					result = 0;
+				}
+				break;
+			}
+			continue;
+		}
+		if (amt > uio->uio_resid) {
+			amt = uio->uio_resid;
+		}
+		result = pipe_ringmove(p, (p->p_head + p->p_count) % PIPE_SIZE,
+				       amt, uio);
+		if (result) {
+			break;
+		}
+		p->p_count += amt;
+		cv_broadcast(p->p_readcv, p->p_lock);
+	}
+
+	lock_release(p->p_lock);
+	return result;
+}
+
+static
+int
+pipe_ioctl(struct vnode *v, int op, userptr_t data)
+{
+	(void)v;
+	(void)op;
+	(void)data;
+	return EIOCTL;
+}
+
+static
+int
+pipe_gettype(struct vnode *v, u_int32_t *ret)
+{
+	(void)v;
+	*ret = S_IFIFO;
+	return 0;
+}
+
+static
+int
+pipe_stat(struct vnode *v, struct stat *statbuf)
+{
+	struct pipe *p = v->vn_data;
+	int result;
+
+	bzero(statbuf, sizeof(struct stat));
+
+	result = VOP_GETTYPE(v, &statbuf->st_mode);
+	if (result) {
+		return result;
+	}
+
+	lock_acquire(p->p_lock);
+	statbuf->st_size = p->p_count;
+	lock_release(p->p_lock);
+	statbuf->st_nlink = 1;
+	return 0;
+}
+
+static
+int
+pipe_tryseek(struct vnode *v, off_t pos)
+{
+	(void)v;
+	(void)pos;
+	return ESPIPE;
+}
+
+static
+int
+pipe_fsync(struct vnode *v)
+{
+	(void)v;
+	return 0;
+}
+
+static
+int
+pipe_mmap(struct vnode *v)
+{
+	(void)v;
+	return EUNIMP;
+}
+
+static
+int
+pipe_truncate(struct vnode *v, off_t len)
+{
+	(void)v;
+	(void)len;
+	return EINVAL;
+}
+
+/*
+ * Operations that make no sense on a pipe, or on the wrong end of one.
+ */
+
+static
+int
+pipe_badio(struct vnode *v, struct uio *uio)
+{
+	(void)v;
+	(void)uio;
+	return EINVAL;
+}
+
+static
+int
+pipe_creat(struct vnode *v, const char *name, int excl, struct vnode **ret)
+{
+	(void)v;
+	(void)name;
+	(void)excl;
+	(void)ret;
+	return ENOTDIR;
+}
+
+static
+int
+pipe_symlink(struct vnode *v, const char *contents, const char *name)
+{
+	(void)v;
+	(void)contents;
+	(void)name;
+	return ENOTDIR;
+}
+
+static
+int
+pipe_nameop(struct vnode *v, const char *name)
+{
+	(void)v;
+	(void)name;
+	return ENOTDIR;
+}
+
+static
+int
+pipe_link(struct vnode *v, const char *name, struct vnode *file)
+{
+	(void)v;
+	(void)name;
+	(void)file;
+	return ENOTDIR;
+}
+
+static
+int
+pipe_rename(struct vnode *v, const char *n1, struct vnode *v2, const char *n2)
+{
+	(void)v;
+	(void)n1;
+	(void)v2;
+	(void)n2;
+	return ENOTDIR;
+}
+
+static
+int
+pipe_lookup(struct vnode *v, char *pathname, struct vnode **ret)
+{
+	(void)v;
+	(void)pathname;
+	(void)ret;
+	return ENOTDIR;
+}
+
+static
+int
+pipe_lookparent(struct vnode *v, char *pathname, struct vnode **ret,
+		char *buf, size_t len)
+{
+	(void)v;
+	(void)pathname;
+	(void)ret;
+	(void)buf;
+	(void)len;
+	return ENOTDIR;
+}
+
+/*
+ * Function tables for the two ends. They differ only in which of
+ * read and write is allowed; pipe_isvnode tells pipes apart by them.
+ */
+static const struct vnode_ops pipe_read_ops = {
+	VOP_MAGIC,
+
+	pipe_open,
+	pipe_close,
+	pipe_reclaim,
+	pipe_read,
+	pipe_badio,   /* readlink */
+	pipe_badio,   /* getdirentry */
+	pipe_badio,   /* write */
+	pipe_ioctl,
+	pipe_stat,
+	pipe_gettype,
+	pipe_tryseek,
+	pipe_fsync,
+	pipe_mmap,
+	pipe_truncate,
+	pipe_badio,   /* namefile */
+	pipe_creat,
+	pipe_symlink,
+	pipe_nameop,  /* mkdir */
+	pipe_link,
+	pipe_nameop,  /* remove */
+	pipe_nameop,  /* rmdir */
+	pipe_rename,
+	pipe_lookup,
+	pipe_lookparent,
+};
+
+static const struct vnode_ops pipe_write_ops = {
+	VOP_MAGIC,
+
+	pipe_open,
+	pipe_close,
+	pipe_reclaim,
+	pipe_badio,   /* read */
+	pipe_badio,   /* readlink */
+	pipe_badio,   /* getdirentry */
+	pipe_write,
+	pipe_ioctl,
+	pipe_stat,
+	pipe_gettype,
+	pipe_tryseek,
+	pipe_fsync,
+	pipe_mmap,
+	pipe_truncate,
+	pipe_badio,   /* namefile */
+	pipe_creat,
+	pipe_symlink,
+	pipe_nameop,  /* mkdir */
+	pipe_link,
+	pipe_nameop,  /* remove */
+	pipe_nameop,  /* rmdir */
+	pipe_rename,
+	pipe_lookup,
+	pipe_lookparent,
+};
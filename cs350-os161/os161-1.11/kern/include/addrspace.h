@@ -68,6 +68,9 @@ struct addrspace {
  *    as_define_stack - set up the stack region in the address space.
  *                (Normally called *after* as_complete_load().) Hands
  *                back the initial stack pointer for the new process.
+ *
+ *    as_resident - return how many pages of the address space are
+ *                currently in RAM. Interrupts must be off.
  */
 
 struct addrspace *as_create(void);
@@ -83,6 +86,7 @@ int               as_define_region(struct addrspace *as,
 int		  as_prepare_load(struct addrspace *as);
 int		  as_complete_load(struct addrspace *as);
 int               as_define_stack(struct addrspace *as, vaddr_t *initstackptr);
+u_int32_t         as_resident(struct addrspace *as);
 
 /*
  * Functions in loadelf.c
@@ -0,0 +1,34 @@
+#ifndef _AIO_H_
+#define _AIO_H_
+
+/*
+ * Kernel side of asynchronous I/O (see kern/aio.h).
+ *
+ * Requests are queued and serviced by a pool of kernel worker
+ * threads, started on demand; they exit again once no requests are
+ * outstanding. The worker does the I/O into or out
+ * of a kernel buffer, since it runs outside the submitting process's
+ * address space; data is copied in at submit time and out at wait
+ * time, in the process's own context.
+ *
+ * Functions:
+ *     aio_bootstrap     - set up; call once at boot.
+ *     aio_shutdown      - stop the workers; call before unmounting.
+ *     aio_cleanup       - discard the requests of exiting process PID.
+ *     aio_setworkers    - change the worker pool size (1..AIO_MAXWORKERS).
+ *     aio_getworkers    - get the worker pool size.
+ *     aio_printstats    - print request counts, queue depth and latency.
+ */
+
+#define AIO_DEFWORKERS  2
+#define AIO_MAXWORKERS  16
+#define AIO_MAXREQS     256   /* outstanding requests, system-wide */
+
+void aio_bootstrap(void);
+void aio_shutdown(void);
+void aio_cleanup(pid_t pid);
+int aio_setworkers(int n);
+int aio_getworkers(void);
+void aio_printstats(void);
+
+#endif /* _AIO_H_ */
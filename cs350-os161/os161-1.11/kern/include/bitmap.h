@@ -9,6 +9,11 @@
  *                      Returns NULL on error.
  *     bitmap_getdata - return pointer to raw bit data (for I/O).
  *     bitmap_alloc   - locate a cleared bit, set it, and return its index.
+ *     bitmap_alloc_from - like bitmap_alloc, but start looking at index
+ *                      START and wrap around (next-fit).
+ *     bitmap_resize  - grow the bitmap to NBITS bits. The new bits are
+ *                      cleared. Returns an error code.
+ *     bitmap_getsize - return the number of bits in the bitmap.
  *     bitmap_mark    - set a clear bit by its index.
  *     bitmap_unmark  - clear a set bit by its index.
  *     bitmap_isset   - return whether a particular bit is set or not.
@@ -20,6 +25,10 @@ struct bitmap;  /* Opaque. */
 struct bitmap *bitmap_create(u_int32_t nbits);
 void          *bitmap_getdata(struct bitmap *);
 int            bitmap_alloc(struct bitmap *, u_int32_t *index);
+int            bitmap_alloc_from(struct bitmap *, u_int32_t start,
+				 u_int32_t *index);
+int            bitmap_resize(struct bitmap *, u_int32_t nbits);
+u_int32_t      bitmap_getsize(struct bitmap *);
 void           bitmap_mark(struct bitmap *, u_int32_t index);
 void           bitmap_unmark(struct bitmap *, u_int32_t index);
 int	       bitmap_isset(struct bitmap *, u_int32_t index);
@@ -9,6 +9,19 @@
  * hardclock() is called from the timer interrupt HZ times a second.
  * gettime() may be used to fetch the current time of day.
  * getinterval() computes the time from time1 to time2.
+ *
+ * When nothing is runnable, the scheduler waits in clock_idle()
+ * instead of cpu_idle(). Unless turned off with clock_settickless,
+ * that stops the periodic tick and asks the clock device for a single
+ * interrupt at the next timer deadline (at most a second away), then,
+ * on waking for whatever reason, catches up on the ticks it skipped
+ * and goes back to ticking. clock_printstats reports how many were
+ * skipped.
+ *
+ * The clock device driving hardclock provides:
+ *     clock_oneshot  - stop ticking and interrupt once, USECS from
+ *                      now. Returns an error if it can't.
+ *     clock_periodic - go back to interrupting HZ times a second.
  */
 
 /* hardclocks per second */
@@ -27,8 +40,18 @@
 #define HZ  100
 #endif
 
+/* microseconds per hardclock */
+#define TICK_USECS  (1000000 / HZ)
+
 void hardclock(void);
 
+void clock_idle(void);
+void clock_settickless(int on);
+void clock_printstats(void);
+
+int clock_oneshot(u_int32_t usecs);
+void clock_periodic(void);
+
 void gettime(time_t *seconds, u_int32_t *nanoseconds);
 
 void getinterval(time_t secs1, u_int32_t nsecs,
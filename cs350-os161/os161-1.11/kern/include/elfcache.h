@@ -0,0 +1,52 @@
+#ifndef _ELFCACHE_H_
+#define _ELFCACHE_H_
+
+/*
+ * Cache of parsed ELF executables.
+ *
+ * load_elf needs the entry point and the PT_LOAD segments of the
+ * program. Reading and validating those takes several small reads, so
+ * the result is kept here, keyed by vnode, and reused the next time
+ * the same file is executed. Each cached entry holds a reference to
+ * its vnode so the key stays valid. Writing to or truncating a file
+ * must call elfcache_invalidate so stale headers are not reused.
+ *
+ * Functions:
+ *     elfcache_lookup     - copy the cached image for V into IMG.
+ *                           Returns 0 on a hit, nonzero on a miss.
+ *     elfcache_insert     - remember IMG as the image for V.
+ *     elfcache_invalidate - forget V, if it is cached.
+ *     elfcache_flush      - forget everything (e.g., before unmount).
+ *     elfcache_setenabled - turn the cache on or off (off flushes it).
+ *     elfcache_printstats - print hit/miss counts.
+ */
+
+#define ELFCACHE_SIZE    8     /* number of executables cached */
+#define ELF_MAXSEGS      8     /* most PT_LOAD segments we handle */
+
+struct vnode;
+
+/* One PT_LOAD segment */
+struct elf_seg {
+	vaddr_t es_vaddr;
+	off_t es_offset;
+	size_t es_memsz;
+	size_t es_filesz;
+	int es_flags;          /* PF_R | PF_W | PF_X */
+};
+
+/* What load_elf needs from an executable */
+struct elf_image {
+	vaddr_t ei_entry;
+	int ei_nsegs;
+	struct elf_seg ei_segs[ELF_MAXSEGS];
+};
+
+int elfcache_lookup(struct vnode *v, struct elf_image *img);
+void elfcache_insert(struct vnode *v, const struct elf_image *img);
+void elfcache_invalidate(struct vnode *v);
+void elfcache_flush(void);
+void elfcache_setenabled(int on);
+void elfcache_printstats(void);
+
+#endif /* _ELFCACHE_H_ */
@@ -5,15 +5,48 @@
 #include <vnode.h>
 #include <thread.h>
 #include <curthread.h>
+/*
+ * An open file. Threads of a process share its descriptor table, so
+ * one may close a file while another is using it; refcount counts the
+ * table's slot plus every call in progress, and the file is closed
+ * when the last of them lets go (release_ft). Changed with interrupts
+ * off.
+ */
 struct filetable {
     off_t offset;
     struct vnode* file;
     int mode;
-    int dup;
+    int refcount;
 };
 
+/*
+ * Per-process descriptor table. fds[] starts with FDTABLE_INITSIZE
+ * slots and doubles when every slot is taken, up to FD_MAX. The used
+ * bitmap has one bit per slot so the lowest free descriptor can be
+ * found without scanning fds[]. count is one past the highest
+ * descriptor in use, so walks over the table (fork, exit) stop there.
+ */
+#define FDTABLE_INITSIZE 16
+#define FD_MAX 1024
 
-struct filetable* crate_ft();
-void destroy_ft(struct filetable* table);
+struct fdtable {
+    struct filetable** fds;
+    struct bitmap* used;
+    int size;
+    int count;
+};
+
+struct filetable* create_ft();
+void destroy_ft(struct filetable* table);       // frees, doesn't close
+void release_ft(struct filetable* table);       // drops a reference
+struct filetable* copy_ft(struct filetable* old);
 int conSetup(struct thread*);
+
+struct fdtable* fdtable_create(void);
+void fdtable_destroy(struct fdtable* fdt);      // closes every open file
+int fdtable_copy(struct fdtable* old, struct fdtable** ret);
+struct filetable* fdtable_get(struct fdtable* fdt, int fd); // release_ft it
+int fdtable_add(struct fdtable* fdt, struct filetable* ft, int* fd);
+struct filetable* fdtable_remove(struct fdtable* fdt, int fd);
+int fdtable_close(struct fdtable* fdt, int fd);
 #endif
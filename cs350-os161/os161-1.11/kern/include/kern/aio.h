@@ -0,0 +1,43 @@
+#ifndef _KERN_AIO_H_
+#define _KERN_AIO_H_
+
+/*
+ * Asynchronous I/O.
+ *
+ * aio_submit() queues a read or write described by a struct aiocb
+ * and returns a request id at once; a kernel worker thread carries
+ * it out in the background. aio_wait() collects the result of a
+ * request: the number of bytes transferred, or -1 with errno set if
+ * the I/O failed. With AIO_NOWAIT it fails with EAGAIN instead of
+ * blocking if the request hasn't finished, so it can be used to poll.
+ *
+ * The transfer happens at aio_offset and does not use or change the
+ * descriptor's seek position. For a read, the data appears in
+ * aio_buf when aio_wait returns, not before. For a write, aio_buf may
+ * be reused as soon as aio_submit returns.
+ *
+ * Every request must be collected with aio_wait; requests still
+ * outstanding when a process exits are discarded.
+ *
+ * This file is shared between the kernel and userland.
+ */
+
+/* Operations */
+#define AIO_READ     1
+#define AIO_WRITE    2
+
+/* Flags for aio_wait */
+#define AIO_NOWAIT   1
+
+/* Largest single transfer */
+#define AIO_MAXBYTES 65536
+
+struct aiocb {
+	int aio_op;           /* AIO_READ or AIO_WRITE */
+	int aio_fd;
+	void *aio_buf;
+	size_t aio_nbytes;    /* at most AIO_MAXBYTES */
+	off_t aio_offset;     /* file position to transfer at */
+};
+
+#endif /* _KERN_AIO_H_ */
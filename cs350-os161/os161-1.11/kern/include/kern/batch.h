@@ -0,0 +1,63 @@
+#ifndef _KERN_BATCH_H_
+#define _KERN_BATCH_H_
+
+/*
+ * Batched system calls.
+ *
+ * A process puts a struct batch_ring in its own memory and registers
+ * it once with __batch_register(). After that it queues operations by
+ * filling in br_sq[br_sqtail % BATCH_RING_SIZE] and advancing
+ * br_sqtail, and calls __batch_submit() to have the kernel run
+ * everything queued in one trap. For each operation the kernel posts
+ * a completion at br_cq[br_cqtail % BATCH_RING_SIZE] and advances
+ * br_cqtail; the process consumes completions by advancing br_cqhead.
+ *
+ * Operations run in order. The kernel stops early if the completion
+ * queue is full; __batch_submit returns the number of operations it
+ * ran. A failed operation does not stop the batch - its completion
+ * carries -errno instead.
+ *
+ * The head and tail counters run freely and are only reduced modulo
+ * BATCH_RING_SIZE when indexing.
+ *
+ * A registration is dropped by execv and is not inherited by fork or
+ * __spawn children; they must register their own ring.
+ *
+ * This file is shared between the kernel and userland.
+ */
+
+#define BATCH_RING_SIZE  64
+
+/* Operation codes */
+#define BATCH_READ    1   /* read(fd, buf, len) */
+#define BATCH_WRITE   2   /* write(fd, buf, len) */
+#define BATCH_OPEN    3   /* open(buf, arg) - buf is the path, arg flags */
+#define BATCH_CLOSE   4   /* close(fd) */
+#define BATCH_LSEEK   5   /* lseek(fd, arg, len) - len is the whence */
+
+/* Submission queue entry */
+struct batch_sqe {
+	int bs_op;            /* BATCH_* */
+	int bs_fd;
+	void *bs_buf;         /* data buffer, or path for BATCH_OPEN */
+	unsigned bs_len;      /* length, or whence for BATCH_LSEEK */
+	int bs_arg;           /* open flags, or offset for BATCH_LSEEK */
+	unsigned bs_cookie;   /* copied to the completion untouched */
+};
+
+/* Completion queue entry */
+struct batch_cqe {
+	unsigned bc_cookie;   /* from the submission */
+	int bc_result;        /* return value, or -errno on failure */
+};
+
+struct batch_ring {
+	unsigned br_sqhead;   /* next submission the kernel will run */
+	unsigned br_sqtail;   /* next free submission slot (user) */
+	unsigned br_cqhead;   /* next completion to consume (user) */
+	unsigned br_cqtail;   /* next completion slot (kernel) */
+	struct batch_sqe br_sq[BATCH_RING_SIZE];
+	struct batch_cqe br_cq[BATCH_RING_SIZE];
+};
+
+#endif /* _KERN_BATCH_H_ */
@@ -40,6 +40,18 @@
 #define SYS___getcwd     29
 #define SYS_stat         30
 #define SYS_lstat        31
+#define SYS___spawn      32
+#define SYS___batch_register 33
+#define SYS___batch_submit 34
+#define SYS_aio_submit   35
+#define SYS_aio_wait     36
+#define SYS___thread_create 37
+#define SYS___thread_exit 38
+#define SYS___thread_join 39
+#define SYS___sysstat     40
+#define SYS_nanosleep     41
+#define SYS___psinfo      42
+#define SYS___tickets     43
 /*CALLEND*/
 
 
@@ -0,0 +1,59 @@
+#ifndef _KERN_KTRACE_H_
+#define _KERN_KTRACE_H_
+
+/*
+ * Kernel event trace records.
+ *
+ * The kernel keeps the last KTRACE_NRECS events in a ring (see
+ * ktrace.h and the "ktrace" menu command). A dump prints each record
+ * as one console line: KTRACE_DUMPTAG followed by the KTRACE_WORDS
+ * words of the record in hex. A stream sends KTRACE_STREAMMAGIC and
+ * then the same words through the ltrace device, one ltrace_debug
+ * call each, so they show up in the simulator's output instead of
+ * going through the console.
+ *
+ * This file is shared between the kernel and the host-side decoder
+ * (sbin/ktracedump).
+ */
+
+/* Event categories, enabled separately. */
+#define KTRACE_SCHED     0x01   /* context switches */
+#define KTRACE_FAULT     0x02   /* TLB and page faults */
+#define KTRACE_VM        0x04   /* evictions and swap I/O */
+#define KTRACE_SYSCALL   0x08   /* syscall entry and exit */
+#define KTRACE_DISK      0x10   /* disk I/O */
+#define KTRACE_ALL       0x1f
+
+/* Event types, and what their two arguments are. */
+#define KT_SWITCH        1    /* thread switched from (thread), state */
+#define KT_TLBFAULT      2    /* fault type, address */
+#define KT_PAGEFAULT     3    /* address, 0 = zero-filled, 1 = from swap */
+#define KT_EVICT         4    /* virtual address, physical address */
+#define KT_SWAPIN        5    /* swap file offset, physical address */
+#define KT_SWAPOUT       6    /* swap file offset, physical address */
+#define KT_SYSENTER      7    /* call number, 0 */
+#define KT_SYSEXIT       8    /* call number, error (0 = success) */
+#define KT_DISKSTART     9    /* sector, 1 if writing */
+#define KT_DISKDONE      10   /* sector, error */
+
+/* States for KT_SWITCH: what the old thread became. */
+#define KT_STATE_READY   0
+#define KT_STATE_SLEEP   1
+#define KT_STATE_ZOMB    2
+
+struct ktrace_rec {
+	u_int32_t kr_secs;      /* rtclock time */
+	u_int32_t kr_nsecs;
+	u_int32_t kr_type;      /* KT_* */
+	u_int32_t kr_thread;    /* thread running (its address), or 0 */
+	u_int32_t kr_pid;       /* its process, or 0 */
+	u_int32_t kr_arg0;
+	u_int32_t kr_arg1;
+};
+
+#define KTRACE_WORDS        7
+#define KTRACE_NRECS        1024
+#define KTRACE_DUMPTAG      "ktrace:"
+#define KTRACE_STREAMMAGIC  0x6b747263   /* "ktrc" */
+
+#endif /* _KERN_KTRACE_H_ */
@@ -0,0 +1,45 @@
+#ifndef _KERN_PSINFO_H_
+#define _KERN_PSINFO_H_
+
+/*
+ * Per-process accounting, as returned by __psinfo().
+ *
+ * Times are in clock ticks (HZ per second), charged by hardclock to
+ * whatever process was running when the tick came in: to ps_utime if
+ * it interrupted user mode, ps_stime otherwise. A context switch is
+ * voluntary if the process went to sleep, involuntary if it was
+ * preempted while still runnable. ps_rss is the number of the
+ * process's pages currently in RAM. ps_tickets is its share under
+ * stride scheduling, or 0 if it is in the feedback queues.
+ *
+ * For a process with several threads, ps_state is that of its
+ * busiest thread (running, then ready, then sleeping), and ps_level
+ * and ps_name come from one of them.
+ *
+ * This file is shared between the kernel and userland.
+ */
+
+#define PSINFO_NAMELEN  32
+
+/* ps_state values */
+#define PS_RUN     0     /* on the CPU */
+#define PS_READY   1     /* runnable, waiting for the CPU */
+#define PS_SLEEP   2     /* blocked */
+#define PS_ZOMB    3     /* exited, not yet waited for */
+
+struct psinfo {
+	int ps_pid;
+	int ps_ppid;              /* -1 if nobody will wait for it */
+	int ps_state;
+	int ps_nthreads;
+	int ps_level;             /* scheduler run queue level */
+	int ps_tickets;           /* stride tickets; 0 if none */
+	u_int32_t ps_utime;       /* ticks in user mode */
+	u_int32_t ps_stime;       /* ticks in the kernel */
+	u_int32_t ps_nvcsw;       /* voluntary context switches */
+	u_int32_t ps_nivcsw;      /* involuntary context switches */
+	u_int32_t ps_rss;         /* resident pages */
+	char ps_name[PSINFO_NAMELEN];
+};
+
+#endif /* _KERN_PSINFO_H_ */
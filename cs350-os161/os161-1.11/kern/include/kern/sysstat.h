@@ -0,0 +1,34 @@
+#ifndef _KERN_SYSSTAT_H_
+#define _KERN_SYSSTAT_H_
+
+/*
+ * Per-system-call statistics, as returned by __sysstat().
+ *
+ * The kernel keeps one struct sysstat for each call number below
+ * SYSSTAT_NCALLS. Latencies are measured with the real-time clock
+ * from entry to exit of the syscall handler, so time spent blocked
+ * counts. Calls that do not return (_exit, a successful execv) are
+ * counted but have no latency.
+ *
+ * The histogram is by decade: ss_hist[i] counts calls that took
+ * less than 10^(i+1) microseconds (and not less than 10^i, for
+ * i > 0); the last bucket counts everything slower.
+ *
+ * This file is shared between the kernel and userland.
+ */
+
+#define SYSSTAT_NCALLS    64
+#define SYSSTAT_NBUCKETS  7      /* <10us, <100us, ... <1s, >=1s */
+#define SYSSTAT_NAMELEN   24
+
+struct sysstat {
+	char ss_name[SYSSTAT_NAMELEN];  /* "" if no such call */
+	u_int32_t ss_count;       /* calls made */
+	u_int32_t ss_errors;      /* calls that failed */
+	u_int32_t ss_secs;        /* total latency: seconds... */
+	u_int32_t ss_usecs;       /* ...plus microseconds */
+	u_int32_t ss_max;         /* slowest call, in microseconds */
+	u_int32_t ss_hist[SYSSTAT_NBUCKETS];
+};
+
+#endif /* _KERN_SYSSTAT_H_ */
@@ -11,4 +11,10 @@ typedef int32_t off_t;   /* Offset within file */
 typedef int32_t pid_t;   /* Process ID */
 typedef int32_t time_t;  /* Time in seconds */
 
+/* A length of time, for nanosleep */
+struct timespec {
+	time_t tv_sec;
+	long tv_nsec;            /* 0 to 999999999 */
+};
+
 #endif /* _KERN_TYPES_H_ */
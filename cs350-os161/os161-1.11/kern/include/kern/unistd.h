@@ -34,6 +34,13 @@
 #define SEEK_CUR      1      /* Seek relative to current position in file */
 #define SEEK_END      2      /* Seek relative to end of file */
 
+/* Flags for waitpid */
+#define WNOHANG       1      /* Return 0 instead of waiting */
+
+/* Ticket counts for __tickets */
+#define TICKETS_QUERY (-1)   /* Leave unchanged, just return it */
+#define TICKETS_MAX   10000  /* Most one process may hold */
+
 /* The codes for ioctl are in kern/ioctl.h */
 /* The codes for stat/fstat/lstat are in kern/stat.h */
 
@@ -0,0 +1,33 @@
+#ifndef _KERN_USERPAGE_H_
+#define _KERN_USERPAGE_H_
+
+/*
+ * The user page: a read-only page the kernel maps at USERPAGE_ADDR in
+ * every address space, so libc can get the time and the pid without
+ * a system call.
+ *
+ * up_secs/up_nsecs is the time of day as of the last clock tick, so
+ * it is only as fine as the tick (1/HZ seconds); the __time system
+ * call reads the clock itself. up_ticks counts ticks since boot.
+ * up_pid is the pid of the process running, which from user level
+ * is always the reader's own.
+ *
+ * The kernel bumps up_seq before and after each update. A reader
+ * copies the fields out and tries again if up_seq was odd or has
+ * changed meanwhile. Until up_magic reads USERPAGE_MAGIC, nothing
+ * else in the page is meaningful; use the system calls.
+ */
+
+#define USERPAGE_ADDR   0x7fff0000   /* a little below the user stack */
+#define USERPAGE_MAGIC  0x75706731   /* "upg1" */
+
+struct userpage {
+	u_int32_t up_magic;
+	volatile u_int32_t up_seq;
+	time_t up_secs;
+	u_int32_t up_nsecs;
+	u_int32_t up_ticks;
+	pid_t up_pid;
+};
+
+#endif /* _KERN_USERPAGE_H_ */
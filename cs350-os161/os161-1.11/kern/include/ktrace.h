@@ -0,0 +1,45 @@
+#ifndef _KTRACE_H_
+#define _KTRACE_H_
+
+/*
+ * Kernel event tracing: a fixed ring of timestamped binary records
+ * (see kern/ktrace.h for the format), so a misbehaving test can be
+ * looked at afterwards without kprintfs changing its timing.
+ *
+ * Recording is off until categories are turned on with the "ktrace"
+ * menu command; a disabled tracepoint costs a load and a branch.
+ *
+ * Functions:
+ *     KTRACE          - record event TYPE with arguments A0 and A1, if
+ *                       category CAT is enabled. Any context, any spl.
+ *     ktrace_setmask  - set the enabled categories (KTRACE_*).
+ *     ktrace_getmask  - return them.
+ *     ktrace_clear    - throw away everything recorded.
+ *     ktrace_dump     - print the ring on the console, oldest first.
+ *     ktrace_stream   - send the ring out through the ltrace device.
+ *     ktrace_printstatus - print the mask and how much is recorded.
+ *
+ * Recording is paused during ktrace_dump and ktrace_stream.
+ */
+
+#include <kern/ktrace.h>
+
+extern volatile u_int32_t ktrace_mask;
+
+void ktrace_record(u_int32_t type, u_int32_t a0, u_int32_t a1);
+
+#define KTRACE(cat, type, a0, a1) \
+	do { \
+		if (ktrace_mask & (cat)) { \
+			ktrace_record(type, (u_int32_t)(a0), (u_int32_t)(a1)); \
+		} \
+	} while (0)
+
+void ktrace_setmask(u_int32_t mask);
+u_int32_t ktrace_getmask(void);
+void ktrace_clear(void);
+void ktrace_dump(void);
+void ktrace_stream(void);
+void ktrace_printstatus(void);
+
+#endif /* _KTRACE_H_ */
@@ -197,7 +197,8 @@ int copyoutstr(const char *src, userptr_t userdest, size_t len, size_t *got);
  * Threads sleeping on lbolt are woken up once a second.
  *
  * clocksleep() suspends execution for the requested number of seconds,
- * like userlevel sleep(3). (Don't confuse it with thread_sleep.)
+ * like userlevel sleep(3). (Don't confuse it with thread_sleep.) For
+ * shorter sleeps, and timeouts, see timer.h.
  */
 extern int lbolt;
 void clocksleep(int seconds);
@@ -0,0 +1,69 @@
+#ifndef _LOCKSTAT_H_
+#define _LOCKSTAT_H_
+
+/*
+ * Lock contention statistics (options lockstat).
+ *
+ * Every lock and semaphore carries a struct lockstat, and all of them
+ * are on one list, so the "lockstat" menu command can show which
+ * ones threads spend the most time waiting for.
+ *
+ * For a lock, "held" means from lock_acquire returning to
+ * lock_release. A semaphore has no owner, so its hold time is from
+ * each P to the next V; that is only really meaningful for
+ * semaphores used as mutexes (initial count 1).
+ *
+ * Times come from the rtclock, and are only taken once it is
+ * attached (lockstat_bootstrap); before that, only counts are kept.
+ * An uncontended acquire costs two clock reads.
+ *
+ * Functions:
+ *     lockstat_bootstrap - start timing; call after dev_bootstrap.
+ *     lockstat_init      - set up and register LS for primitive NAME.
+ *     lockstat_fini      - unregister LS.
+ *     lockstat_now       - read the clock for a wait start time.
+ *     lockstat_acquired  - record an acquire. If CONTENDED, it had to
+ *                          wait, starting at SECS/NSECS.
+ *     lockstat_released  - record a release.
+ *     lockstat_print     - print the N primitives with the most total
+ *                          wait time.
+ *     lockstat_reset     - zero all the counters.
+ *
+ * Except for lockstat_print and lockstat_reset, interrupts must be
+ * off.
+ */
+
+#include "opt-lockstat.h"
+
+#if OPT_LOCKSTAT
+
+#define LOCKSTAT_NAMELEN  16
+
+struct lockstat {
+	const char *ls_name;
+	int ls_issem;
+	u_int32_t ls_acquires;
+	u_int32_t ls_contended;
+	u_int32_t ls_waitsecs, ls_waitusecs;   /* total wait */
+	u_int32_t ls_maxwait;                  /* in us */
+	u_int32_t ls_holdsecs, ls_holdusecs;   /* total hold */
+	u_int32_t ls_maxhold;                  /* in us */
+	time_t ls_holdsecs0;                   /* when last acquired */
+	u_int32_t ls_holdnsecs0;
+	char ls_lastwaiter[LOCKSTAT_NAMELEN];  /* last thread to wait */
+	struct lockstat *ls_next, *ls_prev;
+};
+
+void lockstat_bootstrap(void);
+void lockstat_init(struct lockstat *ls, const char *name, int issem);
+void lockstat_fini(struct lockstat *ls);
+void lockstat_now(time_t *secs, u_int32_t *nsecs);
+void lockstat_acquired(struct lockstat *ls, int contended,
+		       time_t secs, u_int32_t nsecs);
+void lockstat_released(struct lockstat *ls);
+void lockstat_print(int n);
+void lockstat_reset(void);
+
+#endif /* OPT_LOCKSTAT */
+
+#endif /* _LOCKSTAT_H_ */
@@ -0,0 +1,31 @@
+#ifndef _PIPE_H_
+#define _PIPE_H_
+
+/*
+ * Pipes.
+ *
+ * A pipe is a PIPE_SIZE ring buffer with two vnodes, one for each
+ * end, so it can live in a descriptor table like any open file and be
+ * used through VOP_READ/VOP_WRITE. Reads return whatever is buffered
+ * (blocking only while the pipe is empty and a writer still exists);
+ * writes block until everything has been written. If a reader is
+ * blocked on an empty pipe, writers copy straight into its buffer
+ * instead of going through the ring.
+ *
+ * Reading from a pipe with no writers left returns end of file;
+ * writing to one with no readers left fails with EPIPE.
+ *
+ * Functions:
+ *     pipe_create - make a pipe. Hands back the read end and the write
+ *                   end, each opened once (close them with vfs_close).
+ *     pipe_isvnode - return nonzero if V is one end of a pipe.
+ */
+
+#define PIPE_SIZE  4096     /* one page */
+
+struct vnode;
+
+int pipe_create(struct vnode **readend, struct vnode **writeend);
+int pipe_isvnode(struct vnode *v);
+
+#endif /* _PIPE_H_ */
@@ -0,0 +1,116 @@
+#ifndef _PROCTABLE_H_
+#define _PROCTABLE_H_
+
+/*
+ * Process table.
+ *
+ * Process records are indexed directly by pid, so lookup is O(1).
+ * Free pids are tracked in a bitmap and handed out next-fit, starting
+ * just past the last pid given out, so a pid is not reused until the
+ * allocator has gone all the way around. The table starts small and
+ * doubles when it fills up, up to the limit set by proctable_setmax
+ * (the "maxproc" menu command, which can be given on the boot line).
+ *
+ * Pid 0 is never handed out.
+ *
+ * Each process record also links the process into its parent's
+ * family: a parent keeps a list of its running children and a list
+ * of its exited ones (zombies), so waiting for any child and reaping
+ * it are O(1). A parent waiting for children sleeps on its own record,
+ * and an exiting child wakes only its own parent. The family links
+ * and exit state are protected by turning interrupts off, like the
+ * table itself, since records are freed from thread_destroy.
+ *
+ * A process with ppid -1 has no parent that will wait for it; its
+ * record is freed when its thread is destroyed.
+ *
+ * Functions:
+ *     proctable_bootstrap - set up the table. Must be called before
+ *                           the first thread is created.
+ *     proctable_shutdown  - free every remaining process record.
+ *     proc_alloc    - allocate a pid and process record for thread T.
+ *                     Returns EAGAIN if the process limit is reached,
+ *                     ENOMEM if out of memory.
+ *     proc_get      - look up the process record for PID, or NULL.
+ *     proc_free     - release the record for PID and make the pid
+ *                     available again. Unlinks it from its family.
+ *     proc_adopt    - make PID a child of PPID.
+ *     proc_detach   - unlink PID from its parent, which will never
+ *                     wait for it.
+ *     proc_exit     - record that PID exited with CODE: move it to
+ *                     its parent's zombie list and wake the parent.
+ *                     Its own children are orphaned, and its zombies
+ *                     freed.
+ *     proc_wait     - wait for child PID of PPID, or any child if PID
+ *                     is -1, to exit, then reap it, returning its pid
+ *                     and exit code. With WNOHANG, returns pid 0
+ *                     instead of blocking. Fails with EINVAL if PID is
+ *                     not a child of PPID, ECHILD if waiting for any
+ *                     child and there are none, EINTR if the thread is
+ *                     interrupted (see thread_interrupt).
+ *     proctable_setmax - change the process limit. Fails with EINVAL if
+ *                     N is out of range or below the current table size.
+ *     proctable_getmax - return the process limit.
+ *     proctable_count  - return the number of pids in use.
+ *
+ * Each record also carries the accounting that ps reports:
+ *     proc_tick     - charge a clock tick to PID, as user time if USER
+ *                     is set, otherwise system time. Called by
+ *                     hardclock.
+ *     proc_switched - count a context switch away from PID: voluntary
+ *                     if it went to sleep. Called by mi_switch.
+ *     proc_snapshot - fill in BUF with up to MAX processes, in pid
+ *                     order, and return how many.
+ * The first two are called with interrupts off.
+ */
+
+#define PROCTABLE_INITSIZE  32     /* initial table size (slots) */
+#define PROC_MAX_DEFAULT    255    /* default process limit */
+#define PROC_MAX_LIMIT      32767  /* largest limit proctable_setmax takes */
+
+struct thread;
+struct uthread;
+struct psinfo;
+
+struct process {
+    pid_t pid;
+    pid_t ppid;                // -1 if no parent will wait for us
+    int exitcode; 
+    int exited;  // whether it has been exited
+    struct process* children;  // running children
+    struct process* zombies;   // exited children not yet waited for
+    struct process* next;      // on parent's children or zombies list
+    struct process* prev;
+    struct thread* t; //self (the last thread, in a multithreaded process)
+    int nthreads;              // live threads, see uthread.h
+    int exiting;               // a thread is ending the process
+    int nexttid;
+    struct uthread* threads;   // join records, once multithreaded
+    u_int32_t utime;           // ticks charged in user mode
+    u_int32_t stime;           // ticks charged in the kernel
+    u_int32_t nvcsw;           // voluntary context switches
+    u_int32_t nivcsw;          // involuntary context switches
+};
+
+void proctable_bootstrap(void);
+void proctable_shutdown(void);
+
+int proc_alloc(struct thread *t, pid_t *ret);
+struct process *proc_get(pid_t pid);
+void proc_free(pid_t pid);
+
+void proc_adopt(pid_t ppid, pid_t pid);
+void proc_detach(pid_t pid);
+void proc_exit(pid_t pid, int code);
+int proc_wait(pid_t ppid, pid_t pid, int options, pid_t *retpid,
+	      int *retcode);
+
+int proctable_setmax(int n);
+int proctable_getmax(void);
+int proctable_count(void);
+
+void proc_tick(pid_t pid, int user);
+void proc_switched(pid_t pid, int voluntary);
+int proc_snapshot(struct psinfo *buf, int max);
+
+#endif /* _PROCTABLE_H_ */
@@ -0,0 +1,44 @@
+#ifndef _PROF_H_
+#define _PROF_H_
+
+/*
+ * Statistical PC-sampling profiler (options prof).
+ *
+ * While running, each hardclock tick records the program counter it
+ * interrupted. Kernel PCs go into a histogram over the kernel's text;
+ * user PCs are counted per process (pid and program name), in a
+ * fixed-size table. Buckets are PROF_BUCKET bytes of code.
+ *
+ * The dump is printed on the console for sbin/profdump to symbolize
+ * on the host, one line per nonzero bucket:
+ *     prof: k <pc> <count>              kernel
+ *     prof: p <n> <pid> <name>          user process number n
+ *     prof: u <n> <pc> <count>          user, process number n
+ * between "prof: begin" and "prof: end" lines. PCs are in hex.
+ *
+ * Functions:
+ *     prof_tick        - take a sample; called by hardclock.
+ *     prof_start       - clear the counts and start sampling.
+ *                        Returns an error code.
+ *     prof_stop        - stop sampling.
+ *     prof_dump        - print the samples.
+ */
+
+#include "opt-prof.h"
+
+#if OPT_PROF
+
+#define PROF_SHIFT      5
+#define PROF_BUCKET     (1 << PROF_SHIFT)
+#define PROF_USERSLOTS  512     /* user (process, bucket) pairs */
+#define PROF_NPROCS     64      /* processes with user samples */
+#define PROF_NAMELEN    32
+
+void prof_tick(void);
+int prof_start(void);
+void prof_stop(void);
+void prof_dump(void);
+
+#endif /* OPT_PROF */
+
+#endif /* _PROF_H_ */
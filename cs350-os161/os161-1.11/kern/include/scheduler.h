@@ -9,7 +9,14 @@
  *                     already on the run queue or sleeping, weird things
  *                     may happen. Returns an error code.
  *
+ *     scheduler_tick - charge the current thread for a clock tick. Returns
+ *                     nonzero if it should now yield. Called by hardclock.
+ *     sched_settickets - give thread T TICKETS tickets, moving it to
+ *                     stride scheduling, or back to the feedback queues
+ *                     if TICKETS is 0. Interrupts must be off.
+ *
  *     print_run_queue - dump the run queue to the console for debugging.
+ *     sched_printstats - print queue lengths and wait times per level.
  *
  *     scheduler_bootstrap - initialize scheduler data 
  *                           (must happen early in boot)
@@ -18,12 +25,30 @@
  *                           Returns an error code.
  */
 
+/*
+ * The run queue has SCHED_NLEVELS priority levels, 0 the highest; see
+ * scheduler.c. Everything is moved back to level 0 every
+ * SCHED_BOOSTTICKS ticks.
+ */
+#define SCHED_NLEVELS     4
+#define SCHED_BOOSTTICKS  HZ
+
+/*
+ * Tickets held by the feedback queues as a whole, when competing with
+ * threads that have tickets of their own.
+ */
+#define SCHED_TSTICKETS   100
+
 struct thread;
 
 struct thread *scheduler(void);
 int make_runnable(struct thread *t);
 
+int scheduler_tick(void);
+void sched_settickets(struct thread *t, int tickets);
+
 void print_run_queue(void);
+void sched_printstats(void);
 
 void scheduler_bootstrap(void);
 int scheduler_preallocate(int numthreads);
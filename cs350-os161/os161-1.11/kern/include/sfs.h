@@ -26,6 +26,7 @@ struct sfs_fs {
 	int sfs_superdirty;             /* true if superblock modified */
 	struct device *sfs_device;      /* device mounted on */
 	struct array *sfs_vnodes;       /* vnodes loaded into memory */
+	struct rwlock *sfs_vnlock;      /* protects sfs_vnodes */
 	struct bitmap *sfs_freemap;     /* blocks in use are marked 1 */
 	int sfs_freemapdirty;           /* true if freemap modified */
 };
@@ -7,11 +7,28 @@
 
 
 #include "opt-A1.h"
+#include "opt-lockstat.h"
+#include <lockstat.h>
+
+struct thread;
+
+/*
+ * Queue of threads blocked on a primitive, in the order they arrived.
+ * Used internally by all three; see synch.c.
+ */
+struct waitq {
+	struct thread *wq_head;
+	struct thread *wq_tail;
+};
+
 /*
  * Dijkstra-style semaphore.
  * Operations:
  *     P (proberen): decrement count. If the count is 0, block until
  *                   the count is 1 again before decrementing.
+ *     P_intr:       like P, but gives up and returns EINTR, without
+ *                   decrementing, if the thread is interrupted (see
+ *                   thread_interrupt). Returns 0 otherwise.
  *     V (verhogen): increment count.
  * 
  * Both operations are atomic.
@@ -23,10 +40,15 @@
 struct semaphore {
 	char *name;
 	volatile int count;
+	struct waitq waiters;
+#if OPT_LOCKSTAT
+	struct lockstat stats;
+#endif
 };
 
 struct semaphore *sem_create(const char *name, int initial_count);
 void              P(struct semaphore *);
+int               P_intr(struct semaphore *);
 void              V(struct semaphore *);
 void              sem_destroy(struct semaphore *);
 
@@ -55,7 +77,11 @@ struct lock {
         #if OPT_A1
         int volatile status;
         struct thread *target;
+        struct waitq waiters;
         #endif
+#if OPT_LOCKSTAT
+	struct lockstat stats;
+#endif
 };
 
 struct lock *lock_create(const char *name);
@@ -75,6 +101,9 @@ void         lock_destroy(struct lock *);
  * Operations:
  *    cv_wait      - Release the supplied lock, go to sleep, and, after
  *                   waking up again, re-acquire the lock.
+ *    cv_wait_intr - Same, but returns EINTR (still with the lock held)
+ *                   if the thread is interrupted (see thread_interrupt)
+ *                   before being signalled. Returns 0 otherwise.
  *    cv_signal    - Wake up one thread that's sleeping on this CV.
  *    cv_broadcast - Wake up all threads sleeping on this CV.
  *
@@ -85,7 +114,9 @@ void         lock_destroy(struct lock *);
  * These operations must be atomic. You get to write them.
  *
  * These CVs are expected to support Mesa semantics, that is, no
- * guarantees are made about scheduling.
+ * guarantees are made about scheduling. (Waiters are woken in the
+ * order they started waiting, but must still recheck their
+ * condition.)
  *
  * The name field is for easier debugging. A copy of the name is made
  * internally.
@@ -94,7 +125,7 @@ void         lock_destroy(struct lock *);
 struct cv {
 	char *name;
         #if OPT_A1
-        struct queue *sleeping_list;
+        struct waitq waiters;
         #endif
 	// add what you need here
 	// (don't forget to mark things volatile as needed)
@@ -102,8 +133,56 @@ struct cv {
 
 struct cv *cv_create(const char *name);
 void       cv_wait(struct cv *cv, struct lock *lock);
+int        cv_wait_intr(struct cv *cv, struct lock *lock);
 void       cv_signal(struct cv *cv, struct lock *lock);
 void       cv_broadcast(struct cv *cv, struct lock *lock);
 void       cv_destroy(struct cv *);
 
+/*
+ * Reader-writer lock.
+ *
+ * Operations:
+ *    rwlock_acquire_read  - Get shared access. Any number of threads
+ *                           can hold it shared at once.
+ *    rwlock_release_read  - Give up shared access.
+ *    rwlock_acquire_write - Get exclusive access.
+ *    rwlock_release_write - Give up exclusive access.
+ *    rwlock_do_i_hold     - Return true if the current thread holds
+ *                           the lock exclusively; false otherwise.
+ *    rwlock_is_held       - Return true if anybody holds the lock, in
+ *                           either mode. (Readers aren't tracked
+ *                           individually, so this is the best a
+ *                           reader can assert.)
+ *
+ * Writers are preferred: once a writer is waiting, new readers wait
+ * behind it. But when a writer releases the lock, every reader that
+ * was waiting at that point gets in before the next writer, so
+ * readers can't be starved either.
+ *
+ * The lock may not be taken recursively in either mode, and a
+ * reader may not upgrade.
+ *
+ * The name field is for easier debugging. A copy of the name is made
+ * internally.
+ */
+
+struct rwlock {
+	char *name;
+        #if OPT_A1
+        volatile int readers;          /* threads holding it shared */
+        struct thread *writer;         /* thread holding it exclusive */
+        struct waitq readwaiters;
+        struct waitq writewaiters;
+        #endif
+};
+
+struct rwlock *rwlock_create(const char *name);
+void           rwlock_acquire_read(struct rwlock *);
+void           rwlock_release_read(struct rwlock *);
+void           rwlock_acquire_write(struct rwlock *);
+void           rwlock_release_write(struct rwlock *);
+int            rwlock_do_i_hold(struct rwlock *);
+int            rwlock_is_held(struct rwlock *);
+void           rwlock_destroy(struct rwlock *);
+
 #endif /* _SYNCH_H_ */
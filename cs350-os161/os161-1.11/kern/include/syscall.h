@@ -16,13 +16,48 @@ int sys_open(const char* filename,int flags,int *err);
 int sys_close(int fd,int *err);
 int sys_read(int fd, void *buf, size_t buflen,int *err);
 int sys_write(int fd, const void *buf, size_t nbytes,int *err);
+int sys_pipe(int* fds,int *err);
+off_t sys_lseek(int fd, off_t pos, int whence, int *err);
 void sys__exit(int code);
 pid_t sys_fork(struct trapframe* tf, int *err);
 pid_t sys_waitpid(pid_t pid,int* status, int option,int* err);
 pid_t sys_getpid(void);
+time_t sys___time(time_t *secs, unsigned long *nsecs, int *err);
+int sys_nanosleep(const struct timespec *req, struct timespec *rem, int *err);
 int sys_execv(const char* prog, char** args,int* err);
+pid_t sys___spawn(const char* prog, char** args,int* err);
+
+/* Batched syscalls, in batch.c */
+struct batch_ring;
+int sys___batch_register(struct batch_ring *ring, int *err);
+int sys___batch_submit(int *err);
+
+/* Asynchronous I/O, in aio.c */
+struct aiocb;
+int sys_aio_submit(const struct aiocb *cb, int *err);
+int sys_aio_wait(int id, int flags, int *err);
+
+/* User threads, in uthread.c */
+int sys___thread_create(vaddr_t entry, vaddr_t stack, int arg, int *err);
+void sys___thread_exit(int code);
+int sys___thread_join(int tid, int *retval, int *err);
+
+/* Process table snapshot, for ps */
+struct psinfo;
+int sys___psinfo(struct psinfo *buf, int n, int *err);
+
+/* Proportional-share tickets, for the scheduler */
+int sys___tickets(pid_t pid, int tickets, int *err);
+
+/* Per-syscall statistics, in sysstat.c */
+struct sysstat;
+int sys___sysstat(struct sysstat *buf, int n, int *err);
 //int execv(const char* prog, char** args,int *err);
 
+/* Program loading, shared by runprogram, execv and __spawn. */
+int load_program(char *progname, vaddr_t *entrypoint, vaddr_t *stackptr);
+int copyout_args(char **args, int nargs, vaddr_t *stackptr, userptr_t *uargv);
+
 #endif
 
 #endif /* _SYSCALL_H_ */
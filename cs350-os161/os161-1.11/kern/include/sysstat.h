@@ -0,0 +1,26 @@
+#ifndef _SYSSTAT_H_
+#define _SYSSTAT_H_
+
+/*
+ * Kernel side of per-syscall statistics (see kern/sysstat.h).
+ *
+ * mips_syscall calls sysstat_enter when a call comes in and, with the
+ * time from then, sysstat_exit when it is about to return. Both are
+ * cheap enough to leave on all the time.
+ *
+ * Functions:
+ *     sysstat_enter - count a call to CALLNO.
+ *     sysstat_exit  - record the latency of a call to CALLNO that
+ *                     started at SECS/NSECS and finished with ERR.
+ *     sysstat_print - print the table (the "sysstat" menu command).
+ *     sysstat_reset - zero the table.
+ */
+
+#include <kern/sysstat.h>
+
+void sysstat_enter(int callno);
+void sysstat_exit(int callno, int err, time_t secs, u_int32_t nsecs);
+void sysstat_print(void);
+void sysstat_reset(void);
+
+#endif /* _SYSSTAT_H_ */
@@ -26,6 +26,8 @@ int threadtest3(int, char **);
 int semtest(int, char **);
 int locktest(int, char **);
 int cvtest(int, char **);
+int synchbench(int, char **);
+int rwtest(int, char **);
 
 /* filesystem tests */
 int fstest(int, char **);
@@ -10,14 +10,14 @@
 #include <machine/pcb.h>
 #include "opt-A2.h"
 #include <filetable.h>
+#include <workq.h>
 
 
-#define MAX_FILE 50
-#define MAX_PROG 255
-
 
 
 struct addrspace;
+struct fdtable;
+struct batch_ring;
 
 struct thread {
 	/**********************************************************/
@@ -27,7 +27,21 @@ struct thread {
 	struct pcb t_pcb;
 	char *t_name;
 	const void *t_sleepaddr;
+	struct thread *t_wchan;       /* next queue in sleep table bucket */
+	struct thread *t_wqnext;      /* next sleeper on the same address */
+	struct thread *t_wqtail;      /* last sleeper (queue heads only) */
+	struct thread *t_synchnext;   /* next in a synch.c wait queue */
+	volatile int t_synchwait;     /* still on that queue */
 	char *t_stack;
+
+	/* Scheduler state; see scheduler.c */
+	int t_level;                  /* run queue level */
+	int t_ticks;                  /* ticks used of current quantum */
+	u_int32_t t_readytime;        /* tick it last became runnable */
+	int t_tickets;                /* proportional share; 0 if none */
+	u_int32_t t_pass;             /* stride scheduling virtual time */
+
+	struct work t_reap;           /* disposal, once it's a zombie */
 	
 	/**********************************************************/
 	/* Public thread members - can be used by other code      */
@@ -46,22 +60,14 @@ struct thread {
 	 */
 	struct vnode *t_cwd;
         #if OPT_A2
-        struct filetable* ft[MAX_FILE];
+        struct fdtable* fdt;
         pid_t pid;
+        struct batch_ring* batch;   /* user address of registered ring */
+        int tid;                    /* thread number within the process */
+        int exiting;                /* process is ending; leave, see uthread.h */
         #endif     
 };
 
-struct process {
-    pid_t ppid;
-    struct cv* exit;
-    struct lock* exitlock;
-    int waiting;
-    int exitcode; 
-    int exited;  // whether it has been exited
-    struct thread* t; //self
-};
-
-
 /* Call once during startup to allocate data structures. */
 struct thread *thread_bootstrap(void);
 
@@ -86,6 +92,28 @@ int thread_fork(const char *name,
 		void (*func)(void *, unsigned long),
 		struct thread **ret);
 
+#if OPT_A2
+/*
+ * Like thread_fork, but the new thread is a child process of the
+ * current one, with descriptor table FDT (which is consumed, even on
+ * failure). The child's pid is returned in RETPID. Returns as soon as
+ * the child is runnable.
+ */
+int thread_fork_process(const char *name, struct fdtable *fdt,
+			void *data1, unsigned long data2,
+			void (*func)(void *, unsigned long),
+			pid_t *retpid);
+
+/*
+ * Like thread_fork, but the new thread joins the current process,
+ * sharing its pid, descriptor table and address space, instead of
+ * getting a pid and console descriptors of its own.
+ */
+int thread_fork_sibling(const char *name,
+			void *data1, unsigned long data2,
+			void (*func)(void *, unsigned long));
+#endif
+
 /*
  * Cause the current thread to exit.
  * Interrupts need not be disabled.
@@ -113,12 +141,30 @@ void thread_sleep(const void *addr);
  */
 void thread_wakeup(const void *addr);
 
+/*
+ * Wake up just the thread that has slept longest on the specified
+ * address. Returns nonzero if there was one. Interrupts must be
+ * disabled.
+ */
+int thread_wakeone(const void *addr);
+
 /*
  * Return nonzero if there are any threads sleeping on the specified
  * address. Meant only for diagnostic purposes.
  */
 int thread_hassleepers(const void *addr);
 
+/*
+ * Wake thread T if it is asleep, whatever address it sleeps on. Every
+ * sleep has to cope with waking early: most just go back to sleep,
+ * but interruptible waits (P_intr, cv_wait_intr, timer_sleep and
+ * proc_wait) give up with EINTR if thread_interrupted() is then true.
+ * That is the case once the thread's process is ending (see
+ * uthread.h). Interrupts must be disabled.
+ */
+void thread_interrupt(struct thread *t);
+int thread_interrupted(void);
+
 /*
  * returns true (1) if the number of threads in the system is
  * equal to 1, otherwise returns fals (0).
@@ -144,14 +190,25 @@ int thread_hassleepers(const void *addr);
  */
 int one_thread_only(void);
 
+/*
+ * Dead threads are kept, with their stacks, in a cache that new
+ * threads are taken from before going to kmalloc. It holds up to
+ * THREAD_CACHE_DEFAULT threads unless changed with
+ * thread_cache_setmax (the "tcache" menu command), which takes 0
+ * (no caching) to THREAD_CACHE_MAX and frees any extras.
+ */
+#define THREAD_CACHE_DEFAULT  16
+#define THREAD_CACHE_MAX      64
+
+int thread_cache_setmax(int n);
+void thread_cache_printstats(void);
+
 /*
  * Private thread functions.
  */
 
 void process_shutdown(void);
 
-pid_t get_pid(void);
-
 
 /* Machine independent entry point for new threads. */
 void mi_threadstart(void *data1, unsigned long data2, 
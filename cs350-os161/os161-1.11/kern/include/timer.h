@@ -0,0 +1,51 @@
+#ifndef _TIMER_H_
+#define _TIMER_H_
+
+/*
+ * Kernel timers, kept in a hashed timer wheel that hardclock()
+ * advances once a tick (1/HZ seconds).
+ *
+ * A struct timeout belongs to the caller, who sets it up once with
+ * timeout_init and may then arm it any number of times. When it
+ * expires, its function is called from the timer interrupt, with
+ * interrupts off, so it must not sleep. A timeout must not be armed
+ * twice at once, and must be disarmed before its memory is reused.
+ *
+ * Functions:
+ *     timeout_init    - set up TO to call FUNC(ARG).
+ *     timeout_add     - arm TO to fire NTICKS ticks from now (at least
+ *                       one). Must not already be pending.
+ *     timeout_del     - disarm TO. Returns nonzero if it was pending,
+ *                       zero if it had already fired or was never
+ *                       armed.
+ *     timer_tick      - advance the wheel; called by hardclock.
+ *     timer_ticks     - ticks since boot.
+ *     timer_next      - ticks until the next timeout fires, or MAX if
+ *                       none fires sooner. Interrupts must be off.
+ *     timer_sleep     - put the current thread to sleep for NTICKS
+ *                       ticks. Returns 0, or EINTR if the thread is
+ *                       interrupted first (see thread_interrupt).
+ */
+
+#define TIMER_NSLOTS  64   /* wheel size; must be a power of 2 */
+
+struct timeout {
+	void (*to_func)(void *);
+	void *to_arg;
+	u_int32_t to_expire;           /* tick it fires on */
+	int to_pending;
+	struct timeout *to_next;
+	struct timeout *to_prev;
+};
+
+void timeout_init(struct timeout *to, void (*func)(void *), void *arg);
+void timeout_add(struct timeout *to, u_int32_t nticks);
+int timeout_del(struct timeout *to);
+
+void timer_tick(void);
+u_int32_t timer_ticks(void);
+u_int32_t timer_next(u_int32_t max);
+
+int timer_sleep(u_int32_t nticks);
+
+#endif /* _TIMER_H_ */
@@ -0,0 +1,24 @@
+#ifndef _USERPAGE_H_
+#define _USERPAGE_H_
+
+/*
+ * Kernel side of the user page (see kern/userpage.h).
+ *
+ * Functions:
+ *     userpage_bootstrap - allocate the page. Call after vm_bootstrap.
+ *     userpage_tick      - update the time; called from hardclock.
+ *     userpage_setpid    - set the pid shown; called on every return
+ *                          to user mode.
+ *     userpage_fault     - handle a TLB fault on USERPAGE_ADDR for
+ *                          vm_fault. Reads get the page mapped
+ *                          read-only; writes get EFAULT.
+ */
+
+#include <kern/userpage.h>
+
+void userpage_bootstrap(void);
+void userpage_tick(void);
+void userpage_setpid(pid_t pid);
+int userpage_fault(int faulttype);
+
+#endif /* _USERPAGE_H_ */
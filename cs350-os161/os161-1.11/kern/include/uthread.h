@@ -0,0 +1,51 @@
+#ifndef _UTHREAD_H_
+#define _UTHREAD_H_
+
+/*
+ * Multithreaded user processes.
+ *
+ * Extra threads are started with __thread_create. They share the
+ * creating thread's pid, address space and descriptor table; only
+ * the last thread of a process to go tears those down.
+ *
+ * A process stays alive until its last thread exits. __thread_exit
+ * from the last thread exits the process with that code. _exit (or a
+ * fatal fault) from any thread ends the whole process: the other
+ * threads are made to leave the next time they would return to user
+ * mode, and the caller waits for them before exiting. execv does the
+ * same before replacing the program. A thread blocked in a system call
+ * is woken with thread_interrupt, so that waits that could last
+ * indefinitely (console and pipe reads and writes, waitpid, aio_wait,
+ * nanosleep, __thread_join) fail with EINTR and it leaves on the way
+ * out; other waits just finish first.
+ *
+ * Threads are numbered within the process; the original thread is 0.
+ * Once a process has more than one thread it keeps a join record for
+ * each, which lives until the thread has exited and been joined.
+ *
+ * Functions:
+ *     uthread_single - make the current thread the only one in its
+ *                      process, waiting for the others to leave. If
+ *                      another thread is already doing this, the
+ *                      current thread leaves instead (does not return).
+ *     uthread_leave  - quit the current thread without ending the
+ *                      process. Used when curthread->exiting is set.
+ *     uthread_freeall - free the join records of process P.
+ */
+
+struct thread;
+struct process;
+
+struct uthread {
+	int ut_tid;
+	int ut_exited;
+	int ut_retval;         /* valid once exited */
+	struct thread *ut_thread;  /* NULL until started and once exited */
+	struct uthread *ut_next;
+};
+
+void uthread_single(void);
+void uthread_leave(void);
+void uthread_freeall(struct process *p);
+
+#endif /* _UTHREAD_H_ */
@@ -0,0 +1,42 @@
+#ifndef _WORKQ_H_
+#define _WORKQ_H_
+
+/*
+ * Deferred work, run later by a small pool of kernel worker threads.
+ *
+ * Like a struct timeout, a struct work belongs to the caller, who
+ * sets it up with work_init and hands it to workq_add. Queueing never
+ * allocates memory, so workq_add may be called with interrupts off,
+ * from an interrupt handler, or in the middle of a context switch.
+ * The function is later called as FUNC(ARG) in a worker, with
+ * interrupts on, so it may sleep. A work item must not be queued
+ * twice at once; once its function starts it may be queued again, or
+ * freed by the function itself.
+ *
+ * Functions:
+ *     workq_bootstrap  - start the workers; call once at boot.
+ *     workq_shutdown   - run whatever is still queued and stop the
+ *                        workers.
+ *     work_init        - set up W to call FUNC(ARG).
+ *     workq_add        - queue W. Returns ENXIO if the workers have
+ *                        been shut down, in which case the caller must
+ *                        do the work itself.
+ *     workq_printstats - print queue depth, counts, and waiting times.
+ */
+
+#define WORKQ_NWORKERS  2
+
+struct work {
+	void (*w_func)(void *);
+	void *w_arg;
+	u_int32_t w_queued;           /* tick it was queued on */
+	struct work *w_next;
+};
+
+void workq_bootstrap(void);
+void workq_shutdown(void);
+void work_init(struct work *w, void (*func)(void *), void *arg);
+int workq_add(struct work *w);
+void workq_printstats(void);
+
+#endif /* _WORKQ_H_ */
@@ -93,6 +93,100 @@ bitmap_alloc(struct bitmap *b, u_int32_t *index)
 	return ENOSPC;
 }
 
+/*
+ * Next-fit allocation: like bitmap_alloc, but begin the search at
+ * bit START instead of bit 0, wrapping around at the end. Callers
+ * keep START just past the last bit they got, so recently freed bits
+ * are not handed out again right away.
+ */
+int
+bitmap_alloc_from(struct bitmap *b, u_int32_t start, u_int32_t *index)
+{
+	u_int32_t ix, i, offset, bitno;
+	u_int32_t maxix = DIVROUNDUP(b->nbits, BITS_PER_WORD);
+
+	if (start >= b->nbits) {
+		start = 0;
+	}
+
+	/*
+	 * Visit every word once, starting with the one holding START.
+	 * The starting word is visited again at the end so the bits
+	 * below START in it get looked at too.
+	 */
+	ix = start / BITS_PER_WORD;
+	for (i=0; i<=maxix; i++, ix = (ix+1) % maxix) {
+		if (b->v[ix]==WORD_ALLBITS) {
+			continue;
+		}
+		for (offset = 0; offset < BITS_PER_WORD; offset++) {
+			WORD_TYPE mask = ((WORD_TYPE)1)<<offset;
+			bitno = (ix*BITS_PER_WORD)+offset;
+			if (i==0 && bitno < start) {
+				continue;
+			}
+			if ((b->v[ix] & mask)==0) {
+				b->v[ix] |= mask;
+				*index = bitno;
+				assert(*index < b->nbits);
+				return 0;
+			}
+		}
+	}
+	return ENOSPC;
+}
+
+/*
+ * Grow the bitmap to hold NBITS bits. Existing bits keep their
+ * values; the new ones start out cleared. Shrinking is not supported
+ * (asking for fewer bits than we have is a no-op).
+ */
+int
+bitmap_resize(struct bitmap *b, u_int32_t nbits)
+{
+	u_int32_t oldwords, words, j;
+	WORD_TYPE *nv;
+
+	if (nbits <= b->nbits) {
+		return 0;
+	}
+
+	oldwords = DIVROUNDUP(b->nbits, BITS_PER_WORD);
+	words = DIVROUNDUP(nbits, BITS_PER_WORD);
+
+	nv = kmalloc(words*sizeof(WORD_TYPE));
+	if (nv == NULL) {
+		return ENOMEM;
+	}
+	bzero(nv, words*sizeof(WORD_TYPE));
+	memcpy(nv, b->v, oldwords*sizeof(WORD_TYPE));
+
+	/* Release the leftover bits bitmap_create marked in use */
+	if (b->nbits % BITS_PER_WORD != 0) {
+		for (j = b->nbits % BITS_PER_WORD; j<BITS_PER_WORD; j++) {
+			nv[oldwords-1] &= ~((WORD_TYPE)1 << j);
+		}
+	}
+
+	/* ...and mark the ones past the new end */
+	if (nbits % BITS_PER_WORD != 0) {
+		for (j = nbits % BITS_PER_WORD; j<BITS_PER_WORD; j++) {
+			nv[words-1] |= ((WORD_TYPE)1 << j);
+		}
+	}
+
+	kfree(b->v);
+	b->v = nv;
+	b->nbits = nbits;
+	return 0;
+}
+
+u_int32_t
+bitmap_getsize(struct bitmap *b)
+{
+	return b->nbits;
+}
+
 static
 inline
 void
@@ -7,6 +7,7 @@
 #include <synch.h>
 #include <thread.h>
 #include <scheduler.h>
+#include <clock.h>
 #include <dev.h>
 #include <vfs.h>
 #include <vm.h>
@@ -14,8 +15,12 @@
 #include <version.h>
 #include <uw-vmstats.h>
 #include <swapfile.h>
+#include <aio.h>
+#include <workq.h>
+#include <userpage.h>
 #include "opt-A0.h"
 #include "opt-A3.h"
+#include "opt-lockstat.h"
 /*
  * These two pieces of data are maintained by the makefiles and build system.
  * buildconfig is the name of the config file the kernel was configured with.
@@ -77,13 +82,22 @@ boot(void)
 	thread_bootstrap();
 	vfs_bootstrap();
 	dev_bootstrap();
+	/* the clock is attached now; idle without ticking */
+	clock_settickless(1);
+#if OPT_LOCKSTAT
+	/* the clock is attached now; start timing waits and holds */
+	lockstat_bootstrap();
+#endif
         vm_bootstrap();
+        userpage_bootstrap();
 	kprintf_bootstrap();
        
 
 	/* Default bootfs - but ignore failure, in case emu0 doesn't exist */
 	vfs_setbootfs("emu0");
         swap_bootstrap();
+        aio_bootstrap();
+        workq_bootstrap();
 
 	/*
 	 * Make sure various things aren't screwed up.
@@ -102,6 +116,8 @@ shutdown(void)
 
 	kprintf("Shutting down.\n");
         vmstats_print();
+        aio_shutdown();
+        workq_shutdown();
         process_shutdown();
         swap_shutdown();
 
@@ -8,13 +8,26 @@
 #include <kern/limits.h>
 #include <lib.h>
 #include <clock.h>
+#include <timer.h>
 #include <thread.h>
+#include <curthread.h>
+#include <filetable.h>
 #include <syscall.h>
 #include <uio.h>
 #include <vfs.h>
 #include <sfs.h>
 #include <test.h>
+#include <proctable.h>
+#include <elfcache.h>
+#include <aio.h>
+#include <workq.h>
+#include <sysstat.h>
+#include <scheduler.h>
+#include <lockstat.h>
+#include <ktrace.h>
+#include <prof.h>
 #include "opt-synchprobs.h"
+#include "opt-lockstat.h"
 #include "opt-sfs.h"
 #include "opt-net.h"
 #include "opt-A2.h"
@@ -74,6 +87,10 @@ cmd_progthread(void *ptr, unsigned long nargs)
 	if (result) {
 		kprintf("Running program %s failed: %s\n", args[0],
 			strerror(result));
+#if OPT_A2
+		/* exit properly, so common_prog's wait ends */
+		sys__exit(-1);
+#endif
 		return;
 	}
 
@@ -83,23 +100,25 @@ cmd_progthread(void *ptr, unsigned long nargs)
 /*
  * Common code for cmd_prog and cmd_shell.
  *
- * This function uses the one_thread_only() function to make
- * the kernel menu thread wait until the newly-launched program
- * has finished.  The one_thread_only() function is a bit ugly
- * (it works in this specific situation but not more generally)
- * Once you have A2 working, you should be able to use your
- * call your waitpid implementation (instead of one_thread_only())
- * to provide the necessary synchronization.
+ * The program runs as a child process of the menu thread, which
+ * waits for it with proc_wait, as waitpid would. Counting threads
+ * (one_thread_only, still used without A2) doesn't work once kernel
+ * worker threads stay around.
  *
  * Also note that because the subprogram's thread uses the "args"
  * array and strings, there will be a race condition between the
  * subprogram and the menu input code if the menu thread is not
- * made to wait (using one_thread_only or some other mechanism)
+ * made to wait.
  */
 static
 int
 common_prog(int nargs, char **args)
 {
+#if OPT_A2
+	struct fdtable *fdt;
+	pid_t pid, retpid;
+	int code;
+#endif
 	int result;
 
 #if OPT_SYNCHPROBS
@@ -107,6 +126,29 @@ common_prog(int nargs, char **args)
 		"synchronization-problems kernel.\n");
 #endif
 
+#if OPT_A2
+	/* empty; the child gets the console in it */
+	fdt = fdtable_create();
+	if (fdt == NULL) {
+		kprintf("thread_fork failed: %s\n", strerror(ENOMEM));
+		return ENOMEM;
+	}
+
+	result = thread_fork_process(args[0] /* thread name */, fdt,
+			args /* thread arg */, nargs /* thread arg */,
+			cmd_progthread, &pid);
+	if (result) {
+		kprintf("thread_fork failed: %s\n", strerror(result));
+		return result;
+	}
+
+	result = proc_wait(curthread->pid, pid, 0, &retpid, &code);
+	if (result) {
+		kprintf("Waiting for %s failed: %s\n", args[0],
+			strerror(result));
+		return result;
+	}
+#else
 	result = thread_fork(args[0] /* thread name */,
 			args /* thread arg */, nargs /* thread arg */,
 			cmd_progthread, NULL);
@@ -114,13 +156,11 @@ common_prog(int nargs, char **args)
 		kprintf("thread_fork failed: %s\n", strerror(result));
 		return result;
 	}
-	
-	/* this function is a bit of a hack that is used to make
-	 * the kernel menu thread wait until the newly-forked
-         * thread completes before the menu thread returns */
+
 	while (!one_thread_only()) {
-	  clocksleep(1);
+	  timer_sleep(HZ/10);
 	}
+#endif
 
 	return 0;
 }
@@ -359,6 +399,312 @@ cmd_kheapstats(int nargs, char **args)
 	return 0;
 }
 
+/*
+ * Command for the ELF header cache: print stats, or turn it on/off.
+ */
+static
+int
+cmd_elfcache(int nargs, char **args)
+{
+	if (nargs == 2 && !strcmp(args[1], "on")) {
+		elfcache_setenabled(1);
+	}
+	else if (nargs == 2 && !strcmp(args[1], "off")) {
+		elfcache_setenabled(0);
+	}
+	else if (nargs != 1) {
+		kprintf("Usage: elfcache [on|off]\n");
+		return EINVAL;
+	}
+
+	elfcache_printstats();
+	return 0;
+}
+
+/*
+ * Command for the thread cache: print stats, or set its size.
+ */
+static
+int
+cmd_tcache(int nargs, char **args)
+{
+	int result;
+
+	if (nargs == 2) {
+		result = thread_cache_setmax(atoi(args[1]));
+		if (result) {
+			kprintf("tcache: %s: must be between 0 and %d\n",
+				args[1], THREAD_CACHE_MAX);
+			return result;
+		}
+	}
+	else if (nargs != 1) {
+		kprintf("Usage: tcache [size]\n");
+		return EINVAL;
+	}
+
+	thread_cache_printstats();
+	return 0;
+}
+
+/*
+ * Command for asynchronous I/O: print stats, or set the number of
+ * worker threads.
+ */
+static
+int
+cmd_aio(int nargs, char **args)
+{
+	int result;
+
+	if (nargs == 2) {
+		result = aio_setworkers(atoi(args[1]));
+		if (result) {
+			kprintf("aio: %s: must be between 1 and %d workers\n",
+				args[1], AIO_MAXWORKERS);
+			return result;
+		}
+	}
+	else if (nargs != 1) {
+		kprintf("Usage: aio [workers]\n");
+		return EINVAL;
+	}
+
+	aio_printstats();
+	return 0;
+}
+
+/*
+ * Command for work queue statistics.
+ */
+static
+int
+cmd_workq(int nargs, char **args)
+{
+	(void)nargs;
+	(void)args;
+
+	workq_printstats();
+	return 0;
+}
+
+/*
+ * Command for scheduler statistics, including tickless idle, which
+ * can also be turned on or off.
+ */
+static
+int
+cmd_sched(int nargs, char **args)
+{
+	if (nargs == 3 && !strcmp(args[1], "idle") && !strcmp(args[2], "on")) {
+		clock_settickless(1);
+	}
+	else if (nargs == 3 && !strcmp(args[1], "idle") &&
+		 !strcmp(args[2], "off")) {
+		clock_settickless(0);
+	}
+	else if (nargs != 1) {
+		kprintf("Usage: sched [idle on|off]\n");
+		return EINVAL;
+	}
+
+	sched_printstats();
+	clock_printstats();
+	return 0;
+}
+
+/*
+ * Command for system call statistics: print the table, then zero it
+ * if asked.
+ */
+static
+int
+cmd_sysstat(int nargs, char **args)
+{
+	if (nargs == 2 && !strcmp(args[1], "reset")) {
+		sysstat_print();
+		sysstat_reset();
+		return 0;
+	}
+	else if (nargs != 1) {
+		kprintf("Usage: sysstat [reset]\n");
+		return EINVAL;
+	}
+
+	sysstat_print();
+	return 0;
+}
+
+/*
+ * Command for the kernel event trace. With no arguments, shows what
+ * is being recorded. "on" and "off" take category names, or turn
+ * everything on or off if given none.
+ */
+static const struct {
+	const char *name;
+	u_int32_t mask;
+} ktrace_cats[] = {
+	{ "sched",	KTRACE_SCHED },
+	{ "fault",	KTRACE_FAULT },
+	{ "vm",		KTRACE_VM },
+	{ "syscall",	KTRACE_SYSCALL },
+	{ "disk",	KTRACE_DISK },
+	{ "all",	KTRACE_ALL },
+	{ NULL, 0 },
+};
+
+static
+int
+ktrace_usage(void)
+{
+	kprintf("Usage: ktrace [on|off [sched|fault|vm|syscall|disk|all]...]\n");
+	kprintf("       ktrace dump|stream|clear\n");
+	return EINVAL;
+}
+
+static
+int
+cmd_ktrace(int nargs, char **args)
+{
+	u_int32_t mask = 0;
+	int i, j;
+
+	if (nargs == 1) {
+		ktrace_printstatus();
+		return 0;
+	}
+	if (nargs == 2 && !strcmp(args[1], "dump")) {
+		ktrace_dump();
+		return 0;
+	}
+	if (nargs == 2 && !strcmp(args[1], "stream")) {
+		ktrace_stream();
+		return 0;
+	}
+	if (nargs == 2 && !strcmp(args[1], "clear")) {
+		ktrace_clear();
+		return 0;
+	}
+	if (strcmp(args[1], "on") && strcmp(args[1], "off")) {
+		return ktrace_usage();
+	}
+
+	if (nargs == 2) {
+		mask = KTRACE_ALL;
+	}
+	for (i=2; i<nargs; i++) {
+		for (j=0; ktrace_cats[j].name != NULL; j++) {
+			if (!strcmp(args[i], ktrace_cats[j].name)) {
+				break;
+			}
+		}
+		if (ktrace_cats[j].name == NULL) {
+			return ktrace_usage();
+		}
+		mask |= ktrace_cats[j].mask;
+	}
+
+	if (!strcmp(args[1], "on")) {
+		ktrace_setmask(ktrace_getmask() | mask);
+	}
+	else {
+		ktrace_setmask(ktrace_getmask() & ~mask);
+	}
+	ktrace_printstatus();
+	return 0;
+}
+
+#if OPT_PROF
+/*
+ * Command for the profiler. "start" throws away any earlier samples;
+ * "dump" can be used while it's running.
+ */
+static
+int
+cmd_prof(int nargs, char **args)
+{
+	int result;
+
+	if (nargs == 2 && !strcmp(args[1], "start")) {
+		result = prof_start();
+		if (result) {
+			kprintf("prof: %s\n", strerror(result));
+		}
+		return result;
+	}
+	else if (nargs == 2 && !strcmp(args[1], "stop")) {
+		prof_stop();
+		return 0;
+	}
+	else if (nargs == 2 && !strcmp(args[1], "dump")) {
+		prof_dump();
+		return 0;
+	}
+
+	kprintf("Usage: prof start|stop|dump\n");
+	return EINVAL;
+}
+#endif
+
+#if OPT_LOCKSTAT
+/*
+ * Command for lock contention statistics: print the N locks and
+ * semaphores that have spent longest waiting, then zero the counters
+ * if asked.
+ */
+static
+int
+cmd_lockstat(int nargs, char **args)
+{
+	int i, n = 10, reset = 0;
+
+	for (i=1; i<nargs; i++) {
+		if (!strcmp(args[i], "reset")) {
+			reset = 1;
+		}
+		else if ((n = atoi(args[i])) <= 0) {
+			kprintf("Usage: lockstat [n] [reset]\n");
+			return EINVAL;
+		}
+	}
+
+	lockstat_print(n);
+	if (reset) {
+		lockstat_reset();
+	}
+	return 0;
+}
+#endif
+
+/*
+ * Command for showing or setting the process limit. Can be given on
+ * the boot command line, before any programs are started.
+ */
+static
+int
+cmd_maxproc(int nargs, char **args)
+{
+	int result;
+
+	if (nargs == 1) {
+		kprintf("%d processes, limit %d\n", proctable_count(),
+			proctable_getmax());
+		return 0;
+	}
+	if (nargs != 2) {
+		kprintf("Usage: maxproc [limit]\n");
+		return EINVAL;
+	}
+
+	result = proctable_setmax(atoi(args[1]));
+	if (result) {
+		kprintf("maxproc: %s: limit must be at most %d and may "
+			"not shrink the table\n", args[1], PROC_MAX_LIMIT);
+		return result;
+	}
+	return 0;
+}
+
 ////////////////////////////////////////
 //
 // Menus.
@@ -398,6 +744,7 @@ static const char *opsmenu[] = {
 	"[cd]      Change directory          ",
 	"[pwd]     Print current directory   ",
 	"[sync]    Sync filesystems          ",
+	"[maxproc] Show/set process limit    ",
 	"[panic]   Intentional panic         ",
 	"[q]       Quit and shut down        ",
 	NULL
@@ -429,6 +776,8 @@ static const char *testmenu[] = {
 	"[sy1] Semaphore test                ",
 	"[sy2] Lock test             (1)     ",
 	"[sy3] CV test               (1)     ",
+	"[sy4] Synch contention bench (1)    ",
+	"[sy5] Rwlock test           (1)     ",
 	"[fs1] Filesystem test               ",
 	"[fs2] FS read stress        (4)     ",
 	"[fs3] FS write stress       (4)     ",
@@ -464,6 +813,19 @@ static const char *mainmenu[] = {
 	"[1b] Stoplight                      ",
 #endif
 	"[kh] Kernel heap stats              ",
+	"[elfcache] ELF cache stats [on|off] ",
+	"[aio] Async I/O stats [workers]     ",
+	"[workq] Work queue stats            ",
+	"[sysstat] Syscall stats [reset]     ",
+	"[sched] Sched stats [idle on|off]   ",
+	"[tcache] Thread cache stats [size]  ",
+#if OPT_LOCKSTAT
+	"[lockstat] Lock stats [n] [reset]   ",
+#endif
+	"[ktrace] Event trace [on|off|dump]  ",
+#if OPT_PROF
+	"[prof] PC profiler [start|stop|dump]",
+#endif
 	"[q] Quit and shut down              ",
 	NULL
 };
@@ -504,6 +866,7 @@ static struct {
 	{ "cd",		cmd_chdir },
 	{ "pwd",	cmd_pwd },
 	{ "sync",	cmd_sync },
+	{ "maxproc",	cmd_maxproc },
 	{ "panic",	cmd_panic },
 	{ "q",		cmd_quit },
 	{ "exit",	cmd_quit },
@@ -519,6 +882,19 @@ static struct {
 
 	/* stats */
 	{ "kh",         cmd_kheapstats },
+	{ "elfcache",	cmd_elfcache },
+	{ "aio",	cmd_aio },
+	{ "workq",	cmd_workq },
+	{ "sysstat",	cmd_sysstat },
+	{ "sched",	cmd_sched },
+	{ "tcache",	cmd_tcache },
+#if OPT_LOCKSTAT
+	{ "lockstat",	cmd_lockstat },
+#endif
+	{ "ktrace",	cmd_ktrace },
+#if OPT_PROF
+	{ "prof",	cmd_prof },
+#endif
 
 	/* base system tests */
 	{ "at",		arraytest },
@@ -537,6 +913,8 @@ static struct {
 	/* synchronization assignment tests */
 	{ "sy2",	locktest },
 	{ "sy3",	cvtest },
+	{ "sy4",	synchbench },
+	{ "sy5",	rwtest },
 
 	/* file system assignment tests */
 	{ "fs1",	fstest },
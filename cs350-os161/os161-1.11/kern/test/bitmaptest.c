@@ -1,4 +1,5 @@
 #include <types.h>
+#include <kern/errno.h>
 #include <lib.h>
 #include <bitmap.h>
 #include <test.h>
@@ -72,6 +73,31 @@ bitmaptest(int nargs, char **args)
 		assert(data[i]==0);
 	}
 
+	/* Everything is marked; grow it and hand out the new bits next-fit */
+	assert(bitmap_alloc_from(b, 0, &x)==ENOSPC);
+	assert(bitmap_resize(b, TESTSIZE*2)==0);
+	assert(bitmap_getsize(b)==TESTSIZE*2);
+	for (i=0; i<TESTSIZE; i++) {
+		assert(bitmap_isset(b, i));
+		assert(bitmap_isset(b, TESTSIZE+i)==0);
+	}
+
+	bitmap_unmark(b, 7);
+	assert(bitmap_alloc_from(b, TESTSIZE+5, &x)==0);
+	assert(x == TESTSIZE+5);
+	assert(bitmap_alloc_from(b, TESTSIZE+5, &x)==0);
+	assert(x == TESTSIZE+6);
+	while (bitmap_alloc_from(b, x+1, &x)==0) {
+		assert(x < TESTSIZE*2);
+		assert(bitmap_isset(b, x));
+	}
+	/* the search wrapped around and picked up bit 7 on the way */
+	for (i=0; i<TESTSIZE*2; i++) {
+		assert(bitmap_isset(b, i));
+	}
+
+	bitmap_destroy(b);
+
 	kprintf("Bitmap test complete\n");
 	return 0;
 }
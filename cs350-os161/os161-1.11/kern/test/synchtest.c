@@ -8,6 +8,7 @@
 #include <thread.h>
 #include <test.h>
 #include <clock.h>
+#include <machine/spl.h>
 
 #define NSEMLOOPS     63
 #define NLOCKLOOPS    1200
@@ -295,3 +296,351 @@ cvtest(int nargs, char **args)
 
 	return 0;
 }
+
+/*
+ * Contention benchmark.
+ *
+ * NBENCHTHREADS threads each take a lock NBENCHLOOPS times and yield
+ * while holding it, so everybody else piles up waiting. First with a
+ * "herd" lock that wakes all its waiters on release (how locks used
+ * to work), then with a real lock, which hands off to one waiter.
+ *
+ * Then a cv test: the same threads consume NBENCHLOOPS items each,
+ * handed out one at a time by a producer that wakes them with
+ * cv_broadcast, then with cv_signal. (The producer waits on a cv of
+ * its own, so only the consumers' cv is being compared.)
+ *
+ * For each, prints the time taken and the number of times a thread
+ * woke up only to find it had to wait again.
+ */
+
+#define NBENCHTHREADS 16
+#define NBENCHLOOPS   100
+
+struct herdlock {
+	volatile int held;
+};
+
+static struct herdlock herdlock;
+static struct cv *prodcv;
+static volatile int benchmode;
+static volatile int items, consumed;
+static volatile unsigned long wasted;
+
+static
+void
+herd_acquire(struct herdlock *h)
+{
+	int spl, slept = 0;
+
+	spl = splhigh();
+	while (h->held) {
+		if (slept) {
+			wasted++;
+		}
+		thread_sleep(h);
+		slept = 1;
+	}
+	h->held = 1;
+	splx(spl);
+}
+
+static
+void
+herd_release(struct herdlock *h)
+{
+	int spl;
+
+	spl = splhigh();
+	h->held = 0;
+	thread_wakeup(h);
+	splx(spl);
+}
+
+static
+void
+benchlockthread(void *junk, unsigned long num)
+{
+	int i;
+
+	(void)junk;
+	(void)num;
+
+	for (i=0; i<NBENCHLOOPS; i++) {
+		if (benchmode == 0) {
+			herd_acquire(&herdlock);
+		}
+		else {
+			lock_acquire(testlock);
+		}
+		testval1++;
+		thread_yield();
+		if (benchmode == 0) {
+			herd_release(&herdlock);
+		}
+		else {
+			lock_release(testlock);
+		}
+	}
+	V(donesem);
+}
+
+static
+void
+benchcvthread(void *junk, unsigned long num)
+{
+	int i;
+
+	(void)junk;
+	(void)num;
+
+	lock_acquire(testlock);
+	for (i=0; i<NBENCHLOOPS; i++) {
+		while (items == 0) {
+			cv_wait(testcv, testlock);
+			if (items == 0) {
+				wasted++;
+			}
+		}
+		items--;
+		consumed++;
+		/* let the producer know */
+		cv_signal(prodcv, testlock);
+	}
+	lock_release(testlock);
+	V(donesem);
+}
+
+/*
+ * Hand out the items one at a time, waking the consumers with
+ * cv_broadcast (mode 0) or cv_signal (mode 1).
+ */
+static
+void
+benchproduce(int mode)
+{
+	int i;
+
+	lock_acquire(testlock);
+	for (i=0; i<NBENCHTHREADS*NBENCHLOOPS; i++) {
+		while (items > 0) {
+			cv_wait(prodcv, testlock);
+		}
+		items++;
+		if (mode == 0) {
+			cv_broadcast(testcv, testlock);
+		}
+		else {
+			cv_signal(testcv, testlock);
+		}
+	}
+	lock_release(testlock);
+}
+
+static
+void
+benchrun(const char *name, int mode,
+	 void (*func)(void *, unsigned long), int produce)
+{
+	time_t secs1, secs2;
+	u_int32_t nsecs1, nsecs2;
+	int i, result;
+
+	benchmode = mode;
+	wasted = 0;
+	testval1 = 0;
+	items = consumed = 0;
+
+	gettime(&secs1, &nsecs1);
+	for (i=0; i<NBENCHTHREADS; i++) {
+		result = thread_fork("synchbench", NULL, i, func, NULL);
+		if (result) {
+			panic("synchbench: thread_fork failed: %s\n",
+			      strerror(result));
+		}
+	}
+	if (produce) {
+		benchproduce(mode);
+	}
+	for (i=0; i<NBENCHTHREADS; i++) {
+		P(donesem);
+	}
+	gettime(&secs2, &nsecs2);
+	getinterval(secs1, nsecs1, secs2, nsecs2, &secs2, &nsecs2);
+
+	kprintf("%-24s %3lu.%03lu s, %6lu wasted wakeups\n", name,
+		(unsigned long) secs2, (unsigned long) nsecs2/1000000,
+		(unsigned long) wasted);
+}
+
+int
+synchbench(int nargs, char **args)
+{
+	(void)nargs;
+	(void)args;
+
+	inititems();
+	prodcv = cv_create("prodcv");
+	if (prodcv == NULL) {
+		panic("synchbench: cv_create failed\n");
+	}
+	kprintf("Starting synch contention benchmark: %d threads, "
+		"%d rounds each...\n", NBENCHTHREADS, NBENCHLOOPS);
+
+	benchrun("lock, wake all", 0, benchlockthread, 0);
+	benchrun("lock, FIFO handoff", 1, benchlockthread, 0);
+	benchrun("cv_broadcast", 0, benchcvthread, 1);
+	benchrun("cv_signal", 1, benchcvthread, 1);
+
+	cv_destroy(prodcv);
+	prodcv = NULL;
+
+	kprintf("Synch benchmark done.\n");
+	return 0;
+}
+
+/*
+ * Reader-writer lock test.
+ *
+ * NRWREADERS readers and NRWWRITERS writers share one rwlock. Writers
+ * update the three test values together, yielding in between, so a
+ * reader that got in during a write would see them disagree. Both
+ * sides also yield while holding the lock so the others pile up
+ * behind them. Checks that writers are alone, that readers really do
+ * share, and that both sides get through.
+ */
+
+#define NRWREADERS  12
+#define NRWWRITERS  4
+#define NRWLOOPS    50
+
+static struct rwlock *testrw;
+static volatile int rwreaders, rwwriters, rwmaxreaders;
+
+static
+void
+rwfail(unsigned long num, const char *msg)
+{
+	kprintf("thread %lu: %s\n", num, msg);
+	panic("rwtest failed\n");
+}
+
+static
+void
+rwreadthread(void *junk, unsigned long num)
+{
+	unsigned long v1, v2, v3;
+	int i, spl;
+
+	(void)junk;
+
+	for (i=0; i<NRWLOOPS; i++) {
+		rwlock_acquire_read(testrw);
+		if (!rwlock_is_held(testrw) || rwlock_do_i_hold(testrw)) {
+			rwfail(num, "reader sees wrong lock state");
+		}
+
+		spl = splhigh();
+		if (rwwriters != 0) {
+			rwfail(num, "reader got in with a writer");
+		}
+		rwreaders++;
+		if (rwreaders > rwmaxreaders) {
+			rwmaxreaders = rwreaders;
+		}
+		splx(spl);
+
+		v1 = testval1;
+		thread_yield();
+		v2 = testval2;
+		v3 = testval3;
+		if (v2 != v1*v1 || v3 != v1%3) {
+			rwfail(num, "reader saw a half-done write");
+		}
+
+		spl = splhigh();
+		rwreaders--;
+		splx(spl);
+
+		rwlock_release_read(testrw);
+	}
+	V(donesem);
+}
+
+static
+void
+rwwritethread(void *junk, unsigned long num)
+{
+	int i;
+
+	(void)junk;
+
+	for (i=0; i<NRWLOOPS; i++) {
+		rwlock_acquire_write(testrw);
+		if (!rwlock_do_i_hold(testrw)) {
+			rwfail(num, "writer doesn't hold the lock");
+		}
+		if (rwreaders != 0 || rwwriters != 0) {
+			rwfail(num, "writer isn't alone");
+		}
+		rwwriters = 1;
+
+		testval1 = num + i;
+		thread_yield();
+		testval2 = testval1*testval1;
+		thread_yield();
+		testval3 = testval1%3;
+
+		rwwriters = 0;
+		rwlock_release_write(testrw);
+		thread_yield();
+	}
+	V(donesem);
+}
+
+int
+rwtest(int nargs, char **args)
+{
+	int i, result;
+
+	(void)nargs;
+	(void)args;
+
+	inititems();
+	testrw = rwlock_create("testrw");
+	if (testrw == NULL) {
+		panic("rwtest: rwlock_create failed\n");
+	}
+	kprintf("Starting rwlock test...\n");
+
+	testval1 = testval2 = testval3 = 0;
+	rwreaders = rwwriters = rwmaxreaders = 0;
+
+	for (i=0; i<NRWREADERS+NRWWRITERS; i++) {
+		result = thread_fork("rwtest", NULL, i,
+				     i < NRWREADERS ? rwreadthread
+				     : rwwritethread, NULL);
+		if (result) {
+			panic("rwtest: thread_fork failed: %s\n",
+			      strerror(result));
+		}
+	}
+	for (i=0; i<NRWREADERS+NRWWRITERS; i++) {
+		P(donesem);
+	}
+
+	if (rwlock_is_held(testrw)) {
+		panic("rwtest: lock still held at the end\n");
+	}
+	rwlock_destroy(testrw);
+	testrw = NULL;
+
+	kprintf("Up to %d readers at once\n", rwmaxreaders);
+	if (rwmaxreaders < 2) {
+		kprintf("Readers never shared the lock\n");
+		kprintf("Test failed\n");
+		return 0;
+	}
+	kprintf("Rwlock test done.\n");
+	return 0;
+}
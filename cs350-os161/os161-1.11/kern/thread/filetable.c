@@ -2,11 +2,13 @@
 #include <kern/unistd.h>
 #include <kern/errno.h>
 #include <lib.h>
+#include <bitmap.h>
 #include <filetable.h>
 #include <curthread.h>
 #include <thread.h>
 #include <vfs.h>
 #include <synch.h>
+#include <machine/spl.h>
 struct filetable* create_ft(){
 
    struct filetable* ft = kmalloc(sizeof(struct filetable));
@@ -14,8 +16,8 @@ struct filetable* create_ft(){
 
    ft->offset = 0;
    ft->mode = -1;
-   ft->dup = 0;
    ft->file = NULL;
+   ft->refcount = 1;
    return ft;
 }
 
@@ -24,64 +26,95 @@ inline void destroy_ft(struct filetable* ft){
      kfree(ft);
 }
 
+void release_ft(struct filetable* ft){
+     int s, last;
 
-int conSetup(struct thread* t){
-        if (t->ft[0] != NULL || t->ft[1] != NULL || t->ft[2] != NULL) return 0;
-        int result;
-        char* console = kstrdup("con:");
-        if (console == NULL) return ENOMEM;
+     s = splhigh();
+     assert(ft->refcount > 0);
+     last = (--ft->refcount == 0);
+     splx(s);
 
-        /* connect to stdin */
-        t->ft[0] = create_ft();
-        if (t->ft[0] == NULL) goto fail;
+     if (last) {
+        vfs_close(ft->file);
+        destroy_ft(ft);
+     }
+}
 
-        result = vfs_open(console,O_RDONLY,&(t->ft[0]->file));
-        if (result) goto fail;
+/*
+ * Slot FD of FDT, without taking a reference. Interrupts must be off,
+ * or the table not yet shared.
+ */
+static struct filetable* fdtable_peek(struct fdtable* fdt, int fd){
+   if (fdt == NULL || fd < 0 || fd >= fdt->count) return NULL;
+   return fdt->fds[fd];
+}
 
-        t->ft[0]->mode = O_RDONLY;
-        assert(t->ft[0]->file != NULL);
-        kfree(console);
+/*
+ * Open the console with MODE and put it in the lowest free slot.
+ */
+static int con_open(struct fdtable* fdt, int mode){
+        struct filetable* ft;
+        int fd, result;
+        char* console = kstrdup("con:");
+        if (console == NULL) return ENOMEM;
 
-        /* connect to stdout */
-        console = kstrdup("con:");
-        if(console == NULL){
+        ft = create_ft();
+        if (ft == NULL) {
+            kfree(console);
             return ENOMEM;
         }
 
-        t->ft[1] = create_ft();
-        if(t->ft[1] == NULL) goto fail;
-
-        result = vfs_open(console,O_WRONLY,&(t->ft[1]->file));
-        if (result) goto fail;
-
-        t->ft[1]->mode = O_WRONLY;
-        assert(t->ft[1]->file != NULL);
-
+        result = vfs_open(console,mode,&ft->file);
         kfree(console);
+        if (result) {
+            destroy_ft(ft);
+            return result;
+        }
+        ft->mode = mode;
+        assert(ft->file != NULL);
+
+        result = fdtable_add(fdt,ft,&fd);
+        if (result) {
+            vfs_close(ft->file);
+            destroy_ft(ft);
+            return result;
+        }
+        return 0;
+}
 
-        /* connect to stderr */
-        console = kstrdup("con:");
-        if(console == NULL){
-           return ENOMEM;
+int conSetup(struct thread* t){
+        int result;
+
+        if (t->fdt == NULL) {
+            t->fdt = fdtable_create();
+            if (t->fdt == NULL) return ENOMEM;
         }
+        if (fdtable_peek(t->fdt,0) != NULL || fdtable_peek(t->fdt,1) != NULL
+            || fdtable_peek(t->fdt,2) != NULL) return 0;
 
-        t->ft[2] = create_ft();
-        if (t->ft[2] == NULL) goto fail;
+        /* the table is empty, so these land in 0, 1 and 2 */
+        assert(t->fdt->count == 0);
 
-        result = vfs_open(console,O_WRONLY,&(t->ft[2]->file));
-        if (result) goto fail;
+        /* connect to stdin */
+        result = con_open(t->fdt,O_RDONLY);
+        if (result) return result;
 
-        t->ft[2]->mode = O_WRONLY;
-        assert(t->ft[2]->file != NULL);
+        /* connect to stdout */
+        result = con_open(t->fdt,O_WRONLY);
+        if (result) return result;
 
-        kfree(console);
+        /* connect to stderr */
+        result = con_open(t->fdt,O_WRONLY);
+        if (result) return result;
 
+        assert(fdtable_peek(t->fdt,2) != NULL);
         return 0;
-
-fail:   kfree(console);
-        return result;
 }
 
+/*
+ * The copy refers to the same vnode, so take an extra open reference
+ * on it; each copy is closed with vfs_close independently.
+ */
 struct filetable* copy_ft(struct filetable* old){
    struct filetable* new = create_ft();
    if (new == NULL) return NULL;
@@ -89,28 +122,197 @@ struct filetable* copy_ft(struct filetable* old){
    new->file = old->file;
    new->offset = old->offset;
    new->mode = old->mode;
-   new->dup = old->dup + 1;
+   VOP_INCREF(new->file);
+   VOP_INCOPEN(new->file);
    return new;
 }
 
+struct fdtable* fdtable_create(void){
+   struct fdtable* fdt = kmalloc(sizeof(struct fdtable));
+   if (fdt == NULL) return NULL;
+
+   fdt->fds = kmalloc(FDTABLE_INITSIZE * sizeof(struct filetable*));
+   if (fdt->fds == NULL) {
+      kfree(fdt);
+      return NULL;
+   }
+   fdt->used = bitmap_create(FDTABLE_INITSIZE);
+   if (fdt->used == NULL) {
+      kfree(fdt->fds);
+      kfree(fdt);
+      return NULL;
+   }
+   bzero(fdt->fds, FDTABLE_INITSIZE * sizeof(struct filetable*));
+   fdt->size = FDTABLE_INITSIZE;
+   fdt->count = 0;
+   return fdt;
+}
 
+void fdtable_destroy(struct fdtable* fdt){
+   int i;
+   for (i = 0 ; i < fdt->count ; i++) {
+      if (fdt->fds[i] != NULL) {
+         release_ft(fdt->fds[i]);
+      }
+   }
+   bitmap_destroy(fdt->used);
+   kfree(fdt->fds);
+   kfree(fdt);
+}
 
+/* double the table, up to FD_MAX slots */
+static int fdtable_grow(struct fdtable* fdt){
+   struct filetable** nfds;
+   int nsize = fdt->size * 2;
+   int result;
+
+   if (nsize > FD_MAX) nsize = FD_MAX;
+   if (nsize <= fdt->size) return EMFILE;
+
+   nfds = kmalloc(nsize * sizeof(struct filetable*));
+   if (nfds == NULL) return ENOMEM;
+
+   result = bitmap_resize(fdt->used, nsize);
+   if (result) {
+      kfree(nfds);
+      return result;
+   }
+
+   bzero(nfds, nsize * sizeof(struct filetable*));
+   memcpy(nfds, fdt->fds, fdt->size * sizeof(struct filetable*));
+   kfree(fdt->fds);
+   fdt->fds = nfds;
+   fdt->size = nsize;
+   return 0;
+}
 
+/*
+ * Threads of one process share the table, so it is read and changed
+ * with interrupts off; fdtable_add may replace fds[] as it grows.
+ */
+struct filetable* fdtable_get(struct fdtable* fdt, int fd){
+   struct filetable* ft;
+   int s = splhigh();
+
+   ft = fdtable_peek(fdt, fd);
+   if (ft != NULL) ft->refcount++;
+   splx(s);
+   return ft;
+}
 
+int fdtable_add(struct fdtable* fdt, struct filetable* ft, int* fd){
+   u_int32_t index;
+   int result, s;
+
+   s = splhigh();
+   if (bitmap_alloc(fdt->used, &index)) {
+      result = fdtable_grow(fdt);
+      if (result) {
+         splx(s);
+         return result;
+      }
+      result = bitmap_alloc(fdt->used, &index);
+      assert(result == 0);
+   }
+
+   assert(fdt->fds[index] == NULL);
+   fdt->fds[index] = ft;
+   if ((int)index >= fdt->count) fdt->count = index + 1;
+   splx(s);
+   *fd = index;
+   return 0;
+}
 
+struct filetable* fdtable_remove(struct fdtable* fdt, int fd){
+   int s = splhigh();
+   struct filetable* ft = fdtable_peek(fdt, fd);
+   if (ft == NULL) {
+      splx(s);
+      return NULL;
+   }
+
+   fdt->fds[fd] = NULL;
+   bitmap_unmark(fdt->used, fd);
+   while (fdt->count > 0 && fdt->fds[fdt->count-1] == NULL) fdt->count--;
+   splx(s);
+   return ft;
+}
 
+/*
+ * Take FD out of FDT and drop the table's reference, closing the file
+ * unless a call in another thread is still using it. Returns EBADF if
+ * FD isn't open.
+ */
+int fdtable_close(struct fdtable* fdt, int fd){
+   struct filetable* ft = fdtable_remove(fdt, fd);
+   if (ft == NULL) return EBADF;
+   release_ft(ft);
+   return 0;
+}
 
-
-
-
-
-
-
-
-
-
-
-
-
-
-
+/*
+ * Make a copy of OLD for a child process. Only the slots below
+ * old->count can be in use, so that is all we look at; the new table
+ * is sized to fit them.
+ *
+ * Copying a slot can sleep, so it isn't done with interrupts off.
+ * Instead we first take a snapshot of the slots, with a reference on
+ * each so that a sibling thread closing one can't free it under us.
+ */
+int fdtable_copy(struct fdtable* old, struct fdtable** ret){
+   struct fdtable* new;
+   struct filetable** snap;
+   int i, n, result, s;
+
+   s = splhigh();
+   n = old->count;
+   splx(s);
+
+   while (1) {
+      snap = kmalloc((n > 0 ? n : 1) * sizeof(struct filetable*));
+      if (snap == NULL) return ENOMEM;
+
+      s = splhigh();
+      if (old->count <= n) break;
+      // another thread opened more files meanwhile
+      n = old->count;
+      splx(s);
+      kfree(snap);
+   }
+   n = old->count;
+   for (i = 0 ; i < n ; i++) {
+      snap[i] = old->fds[i];
+      if (snap[i] != NULL) snap[i]->refcount++;
+   }
+   splx(s);
+
+   result = 0;
+   new = fdtable_create();
+   if (new == NULL) result = ENOMEM;
+   while (result == 0 && new->size < n) {
+      result = fdtable_grow(new);
+   }
+
+   for (i = 0 ; i < n ; i++) {
+      if (snap[i] == NULL) continue;
+      if (result == 0) {
+         new->fds[i] = copy_ft(snap[i]);
+         if (new->fds[i] == NULL) {
+            result = ENOMEM;
+         }
+         else {
+            bitmap_mark(new->used, i);
+            new->count = i + 1;
+         }
+      }
+      release_ft(snap[i]);
+   }
+   kfree(snap);
+
+   if (result) {
+      if (new != NULL) fdtable_destroy(new);
+      return result;
+   }
+   *ret = new;
+   return 0;
+}
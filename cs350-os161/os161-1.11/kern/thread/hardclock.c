@@ -1,8 +1,17 @@
 #include <types.h>
 #include <lib.h>
 #include <machine/spl.h>
+#include <machine/trapframe.h>
+#include <machine/specialreg.h>
 #include <thread.h>
+#include <curthread.h>
+#include <proctable.h>
 #include <clock.h>
+#include <userpage.h>
+#include <timer.h>
+#include <scheduler.h>
+#include <prof.h>
+#include "opt-A2.h"
 
 /* 
  * The address of lbolt has thread_wakeup called on it once a second.
@@ -11,6 +20,30 @@ int lbolt;
 
 static int lbolt_counter;
 
+/* Tickless idle state and statistics; see clock_idle. */
+static int tickless;
+static u_int32_t nhardclocks;       /* calls to hardclock */
+static u_int32_t idle_resid;        /* usecs idle not yet made into ticks */
+static u_int32_t idle_sleeps;       /* times the tick was stopped */
+static u_int32_t idle_skipped;      /* ticks that had no interrupt */
+
+/*
+ * Everything a tick does that doesn't depend on who it interrupted.
+ */
+static
+void
+clock_advance(void)
+{
+	userpage_tick();
+	timer_tick();
+
+	lbolt_counter++;
+	if (lbolt_counter >= HZ) {
+		lbolt_counter = 0;
+		thread_wakeup(&lbolt);
+	}
+}
+
 /*
  * This is called HZ times a second by the timer device setup.
  */
@@ -18,32 +51,108 @@ static int lbolt_counter;
 void
 hardclock(void)
 {
+	nhardclocks++;
+
 	/*
 	 * Collect statistics here as desired.
 	 */
 
-
-	lbolt_counter++;
-	if (lbolt_counter >= HZ) {
-		lbolt_counter = 0;
-		thread_wakeup(&lbolt);
+#if OPT_PROF
+	prof_tick();
+#endif
+#if OPT_A2
+	/* charge the tick to whoever it interrupted */
+	if (curthread != NULL) {
+		proc_tick(curthread->pid, curintrframe != NULL &&
+			  (curintrframe->tf_status & CST_KUp) != 0);
 	}
+#endif
+	clock_advance();
 
-	thread_yield();
+	if (scheduler_tick()) {
+		thread_yield();
+	}
 }
 
 /*
- * Suspend execution for n seconds.
+ * Wait for an interrupt with nothing to run. Called by the scheduler
+ * in place of cpu_idle, with curthread NULL and interrupts off.
  */
 void
-clocksleep(int num_secs)
+clock_idle(void)
+{
+	time_t secs1, secs2, dsecs;
+	u_int32_t nsecs1, nsecs2, dnsecs, n, usecs, elapsed, done;
+
+	assert(curspl>0);
+
+	/* wake for the next timeout, or lbolt, whichever is first */
+	n = timer_next(HZ - lbolt_counter);
+	if (!tickless || n < 2) {
+		cpu_idle();
+		return;
+	}
+
+	gettime(&secs1, &nsecs1);
+	done = nhardclocks;
+	if (clock_oneshot(n * TICK_USECS)) {
+		cpu_idle();
+		return;
+	}
+	cpu_idle();
+	clock_periodic();
+	gettime(&secs2, &nsecs2);
+	done = nhardclocks - done;
+
+	getinterval(secs1, nsecs1, secs2, nsecs2, &dsecs, &dnsecs);
+	if (dsecs >= 4000) {
+		/* keep it in 32 bits; nothing sleeps that long anyway */
+		dsecs = 4000;
+	}
+	usecs = dsecs*1000000 + dnsecs/1000 + idle_resid;
+	elapsed = usecs / TICK_USECS;
+	idle_resid = usecs % TICK_USECS;
+	idle_sleeps++;
+
+	/*
+	 * Run the ticks that got no interrupt. If the timer did go
+	 * off, hardclock already ran one.
+	 */
+	while (elapsed > done) {
+		clock_advance();
+		/* just counts toward the next boost; nothing is running */
+		scheduler_tick();
+		idle_skipped++;
+		elapsed--;
+	}
+}
+
+void
+clock_settickless(int on)
+{
+	tickless = on;
+}
+
+void
+clock_printstats(void)
 {
 	int s;
 
 	s = splhigh();
-	while (num_secs > 0) {
-		thread_sleep(&lbolt);
-		num_secs--;
-	}
+	kprintf("tickless idle %s: %lu ticks skipped in %lu idle waits, "
+		"%lu ticks taken\n", tickless ? "on" : "off",
+		(unsigned long) idle_skipped, (unsigned long) idle_sleeps,
+		(unsigned long) nhardclocks);
 	splx(s);
 }
+
+/*
+ * Suspend execution for n seconds.
+ */
+void
+clocksleep(int num_secs)
+{
+	if (num_secs > 0) {
+		timer_sleep(num_secs * HZ);
+	}
+}
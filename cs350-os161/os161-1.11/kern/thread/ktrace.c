@@ -0,0 +1,156 @@
+/*
+ * Kernel event tracing. See ktrace.h.
+ */
+#include <types.h>
+#include <lib.h>
+#include <clock.h>
+#include <thread.h>
+#include <curthread.h>
+#include <machine/spl.h>
+#include <lamebus/ltrace.h>
+#include <ktrace.h>
+#include "opt-A2.h"
+
+volatile u_int32_t ktrace_mask;
+
+/*
+ * ktrace_next counts every record ever made; the newest is in slot
+ * (ktrace_next-1) % KTRACE_NRECS. Once it passes KTRACE_NRECS, the
+ * oldest records are being overwritten.
+ */
+static struct ktrace_rec ktrace_ring[KTRACE_NRECS];
+static u_int32_t ktrace_next;
+
+void
+ktrace_record(u_int32_t type, u_int32_t a0, u_int32_t a1)
+{
+	struct ktrace_rec *kr;
+	time_t secs;
+	u_int32_t nsecs;
+	int spl;
+
+	gettime(&secs, &nsecs);
+
+	spl = splhigh();
+	kr = &ktrace_ring[ktrace_next % KTRACE_NRECS];
+	ktrace_next++;
+
+	kr->kr_secs = secs;
+	kr->kr_nsecs = nsecs;
+	kr->kr_type = type;
+	kr->kr_thread = (u_int32_t)curthread;
+	kr->kr_pid = 0;
+#if OPT_A2
+	if (curthread != NULL) {
+		kr->kr_pid = curthread->pid;
+	}
+#endif
+	kr->kr_arg0 = a0;
+	kr->kr_arg1 = a1;
+	splx(spl);
+}
+
+void
+ktrace_setmask(u_int32_t mask)
+{
+	ktrace_mask = mask & KTRACE_ALL;
+}
+
+u_int32_t
+ktrace_getmask(void)
+{
+	return ktrace_mask;
+}
+
+void
+ktrace_clear(void)
+{
+	int spl;
+
+	spl = splhigh();
+	ktrace_next = 0;
+	splx(spl);
+}
+
+/*
+ * Stop recording and work out which records are valid. Returns the
+ * old mask, to be put back with ktrace_resume.
+ */
+static
+u_int32_t
+ktrace_pause(u_int32_t *first, u_int32_t *count)
+{
+	u_int32_t mask;
+	int spl;
+
+	spl = splhigh();
+	mask = ktrace_mask;
+	ktrace_mask = 0;
+	if (ktrace_next > KTRACE_NRECS) {
+		*first = ktrace_next % KTRACE_NRECS;
+		*count = KTRACE_NRECS;
+	}
+	else {
+		*first = 0;
+		*count = ktrace_next;
+	}
+	splx(spl);
+	return mask;
+}
+
+static
+void
+ktrace_resume(u_int32_t mask)
+{
+	ktrace_mask = mask;
+}
+
+void
+ktrace_dump(void)
+{
+	struct ktrace_rec *kr;
+	u_int32_t first, count, i, mask;
+
+	mask = ktrace_pause(&first, &count);
+	kprintf("ktrace: begin %u records\n", count);
+	for (i=0; i<count; i++) {
+		kr = &ktrace_ring[(first + i) % KTRACE_NRECS];
+		kprintf("%s %08x %08x %08x %08x %08x %08x %08x\n",
+			KTRACE_DUMPTAG, kr->kr_secs, kr->kr_nsecs,
+			kr->kr_type, kr->kr_thread, kr->kr_pid,
+			kr->kr_arg0, kr->kr_arg1);
+	}
+	kprintf("ktrace: end\n");
+	ktrace_resume(mask);
+}
+
+void
+ktrace_stream(void)
+{
+	struct ktrace_rec *kr;
+	u_int32_t first, count, i, mask;
+
+	mask = ktrace_pause(&first, &count);
+	for (i=0; i<count; i++) {
+		kr = &ktrace_ring[(first + i) % KTRACE_NRECS];
+		ltrace_debug(KTRACE_STREAMMAGIC);
+		ltrace_debug(kr->kr_secs);
+		ltrace_debug(kr->kr_nsecs);
+		ltrace_debug(kr->kr_type);
+		ltrace_debug(kr->kr_thread);
+		ltrace_debug(kr->kr_pid);
+		ltrace_debug(kr->kr_arg0);
+		ltrace_debug(kr->kr_arg1);
+	}
+	kprintf("ktrace: streamed %u records\n", count);
+	ktrace_resume(mask);
+}
+
+void
+ktrace_printstatus(void)
+{
+	u_int32_t next = ktrace_next;
+
+	kprintf("ktrace: categories 0x%x, %u events recorded, %u kept\n",
+		ktrace_mask, next, next > KTRACE_NRECS ? KTRACE_NRECS : next);
+}
@@ -0,0 +1,217 @@
+/*
+ * Lock contention statistics. See lockstat.h.
+ */
+#include <types.h>
+#include <lib.h>
+#include <clock.h>
+#include <thread.h>
+#include <curthread.h>
+#include <machine/spl.h>
+#include <lockstat.h>
+
+/* All registered primitives. */
+static struct lockstat *lockstats;
+static int lockstat_timing;
+
+void
+lockstat_bootstrap(void)
+{
+	lockstat_timing = 1;
+}
+
+void
+lockstat_init(struct lockstat *ls, const char *name, int issem)
+{
+	int spl;
+
+	bzero(ls, sizeof(*ls));
+	ls->ls_name = name;
+	ls->ls_issem = issem;
+
+	spl = splhigh();
+	ls->ls_prev = NULL;
+	ls->ls_next = lockstats;
+	if (lockstats != NULL) {
+		lockstats->ls_prev = ls;
+	}
+	lockstats = ls;
+	splx(spl);
+}
+
+void
+lockstat_fini(struct lockstat *ls)
+{
+	int spl;
+
+	spl = splhigh();
+	if (ls->ls_prev != NULL) {
+		ls->ls_prev->ls_next = ls->ls_next;
+	}
+	else {
+		lockstats = ls->ls_next;
+	}
+	if (ls->ls_next != NULL) {
+		ls->ls_next->ls_prev = ls->ls_prev;
+	}
+	splx(spl);
+}
+
+void
+lockstat_now(time_t *secs, u_int32_t *nsecs)
+{
+	if (lockstat_timing) {
+		gettime(secs, nsecs);
+	}
+	else {
+		*secs = 0;
+		*nsecs = 0;
+	}
+}
+
+/*
+ * Microseconds from SECS/NSECS to now, and add them to the total in
+ * TSECS/TUSECS. Returns the microseconds, capped at 32 bits.
+ */
+static
+u_int32_t
+lockstat_since(time_t secs, u_int32_t nsecs,
+	       u_int32_t *tsecs, u_int32_t *tusecs)
+{
+	time_t now, dsecs;
+	u_int32_t nnow, dnsecs;
+
+	if (!lockstat_timing || (secs == 0 && nsecs == 0)) {
+		return 0;
+	}
+	gettime(&now, &nnow);
+	getinterval(secs, nsecs, now, nnow, &dsecs, &dnsecs);
+
+	*tsecs += dsecs;
+	*tusecs += dnsecs/1000;
+	if (*tusecs >= 1000000) {
+		(*tsecs)++;
+		*tusecs -= 1000000;
+	}
+	return dsecs >= 4000 ? 0xffffffff : dsecs*1000000 + dnsecs/1000;
+}
+
+void
+lockstat_acquired(struct lockstat *ls, int contended,
+		  time_t secs, u_int32_t nsecs)
+{
+	u_int32_t us;
+	int i;
+
+	assert(curspl>0);
+
+	ls->ls_acquires++;
+	if (contended) {
+		ls->ls_contended++;
+		us = lockstat_since(secs, nsecs,
+				    &ls->ls_waitsecs, &ls->ls_waitusecs);
+		if (us > ls->ls_maxwait) {
+			ls->ls_maxwait = us;
+		}
+		for (i=0; i<LOCKSTAT_NAMELEN-1 && curthread->t_name[i]; i++) {
+			ls->ls_lastwaiter[i] = curthread->t_name[i];
+		}
+		ls->ls_lastwaiter[i] = 0;
+	}
+	lockstat_now(&ls->ls_holdsecs0, &ls->ls_holdnsecs0);
+}
+
+void
+lockstat_released(struct lockstat *ls)
+{
+	u_int32_t us;
+
+	assert(curspl>0);
+
+	us = lockstat_since(ls->ls_holdsecs0, ls->ls_holdnsecs0,
+			    &ls->ls_holdsecs, &ls->ls_holdusecs);
+	if (us > ls->ls_maxhold) {
+		ls->ls_maxhold = us;
+	}
+	ls->ls_holdsecs0 = 0;
+	ls->ls_holdnsecs0 = 0;
+}
+
+/*
+ * Is A ahead of B in the ordering (most wait first; ties broken by
+ * address so every entry has a distinct place)?
+ */
+static
+int
+lockstat_before(struct lockstat *a, struct lockstat *b)
+{
+	if (a->ls_waitsecs != b->ls_waitsecs) {
+		return a->ls_waitsecs > b->ls_waitsecs;
+	}
+	if (a->ls_waitusecs != b->ls_waitusecs) {
+		return a->ls_waitusecs > b->ls_waitusecs;
+	}
+	return a > b;
+}
+
+/*
+ * Print the top N. Each line is found by a pass over the list for the
+ * biggest entry after the last one printed, so nothing needs to be
+ * allocated; this is a debugging command, and N is small.
+ */
+void
+lockstat_print(int n)
+{
+	struct lockstat *ls, *best, *last = NULL;
+	int i, spl;
+
+	spl = splhigh();
+	kprintf("%-16s %4s %8s %8s %10s %8s %10s %8s  %s\n",
+		"name", "type", "acquires", "waited", "wait ms", "max us",
+		"hold ms", "max us", "last waiter");
+	for (i=0; i<n; i++) {
+		best = NULL;
+		for (ls = lockstats; ls != NULL; ls = ls->ls_next) {
+			if (last != NULL && !lockstat_before(last, ls)) {
+				continue;
+			}
+			if (best == NULL || lockstat_before(ls, best)) {
+				best = ls;
+			}
+		}
+		if (best == NULL || best->ls_acquires == 0) {
+			break;
+		}
+		kprintf("%-16s %4s %8lu %8lu %10lu %8lu %10lu %8lu  %s\n",
+			best->ls_name, best->ls_issem ? "sem" : "lock",
+			(unsigned long) best->ls_acquires,
+			(unsigned long) best->ls_contended,
+			(unsigned long) (best->ls_waitsecs*1000 +
+					 best->ls_waitusecs/1000),
+			(unsigned long) best->ls_maxwait,
+			(unsigned long) (best->ls_holdsecs*1000 +
+					 best->ls_holdusecs/1000),
+			(unsigned long) best->ls_maxhold,
+			best->ls_lastwaiter[0] ? best->ls_lastwaiter : "-");
+		last = best;
+	}
+	splx(spl);
+}
+
+void
+lockstat_reset(void)
+{
+	struct lockstat *ls;
+	int spl;
+
+	spl = splhigh();
+	for (ls = lockstats; ls != NULL; ls = ls->ls_next) {
+		ls->ls_acquires = 0;
+		ls->ls_contended = 0;
+		ls->ls_waitsecs = ls->ls_waitusecs = 0;
+		ls->ls_maxwait = 0;
+		ls->ls_holdsecs = ls->ls_holdusecs = 0;
+		ls->ls_maxhold = 0;
+		ls->ls_lastwaiter[0] = 0;
+	}
+	splx(spl);
+}
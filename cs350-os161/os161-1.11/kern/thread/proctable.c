@@ -0,0 +1,542 @@
+/*
+ * Process table: pid allocation and pid -> process lookup.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <kern/unistd.h>
+#include <kern/psinfo.h>
+#include <bitmap.h>
+#include <thread.h>
+#include <curthread.h>
+#include <addrspace.h>
+#include <machine/spl.h>
+#include <proctable.h>
+#include <uthread.h>
+
+/* procs[pid] is the record for pid, or NULL. Has proc_cap slots. */
+static struct process **procs;
+static u_int32_t proc_cap;
+
+/* Which pids are in use. Same size as procs; bit 0 is always set. */
+static struct bitmap *pidmap;
+
+/* Where the next-fit search starts. */
+static u_int32_t nextpid;
+
+/* Number of pids in use, and how many we allow. */
+static int nprocs;
+static int maxproc = PROC_MAX_DEFAULT;
+
+void
+proctable_bootstrap(void)
+{
+	proc_cap = PROCTABLE_INITSIZE;
+	procs = kmalloc(proc_cap * sizeof(struct process *));
+	pidmap = bitmap_create(proc_cap);
+	if (procs == NULL || pidmap == NULL) {
+		panic("proctable_bootstrap: Out of memory\n");
+	}
+	bzero(procs, proc_cap * sizeof(struct process *));
+
+	/* pid 0 is never used */
+	bitmap_mark(pidmap, 0);
+	nextpid = 1;
+	nprocs = 0;
+}
+
+/*
+ * Double the table, without going past maxproc+1 slots (pids
+ * 0..maxproc). Interrupts must be off.
+ */
+static
+int
+proctable_grow(void)
+{
+	struct process **ntab;
+	u_int32_t ncap;
+	int result;
+
+	assert(curspl>0);
+
+	ncap = proc_cap * 2;
+	if (ncap > (u_int32_t)maxproc + 1) {
+		ncap = maxproc + 1;
+	}
+	if (ncap <= proc_cap) {
+		return EAGAIN;
+	}
+
+	ntab = kmalloc(ncap * sizeof(struct process *));
+	if (ntab == NULL) {
+		return ENOMEM;
+	}
+	result = bitmap_resize(pidmap, ncap);
+	if (result) {
+		kfree(ntab);
+		return result;
+	}
+
+	bzero(ntab, ncap * sizeof(struct process *));
+	memcpy(ntab, procs, proc_cap * sizeof(struct process *));
+	kfree(procs);
+
+	/* Start handing out the new pids first */
+	nextpid = proc_cap;
+
+	procs = ntab;
+	proc_cap = ncap;
+	return 0;
+}
+
+int
+proc_alloc(struct thread *t, pid_t *ret)
+{
+	struct process *p;
+	u_int32_t pid;
+	int s, result;
+
+	p = kmalloc(sizeof(struct process));
+	if (p == NULL) {
+		return ENOMEM;
+	}
+	p->ppid = -1;
+	p->exited = 0;
+	p->exitcode = -1;
+	p->children = NULL;
+	p->zombies = NULL;
+	p->next = p->prev = NULL;
+	p->t = t;
+	p->nthreads = 1;
+	p->exiting = 0;
+	p->nexttid = 1;
+	p->threads = NULL;
+	p->utime = p->stime = 0;
+	p->nvcsw = p->nivcsw = 0;
+
+	s = splhigh();
+
+	if (nprocs >= maxproc) {
+		splx(s);
+		kfree(p);
+		return EAGAIN;
+	}
+
+	if (bitmap_alloc_from(pidmap, nextpid, &pid)) {
+		result = proctable_grow();
+		if (result == 0) {
+			result = bitmap_alloc_from(pidmap, nextpid, &pid);
+		}
+		if (result) {
+			splx(s);
+			kfree(p);
+			return result;
+		}
+	}
+
+	assert(pid > 0 && pid < proc_cap);
+	assert(procs[pid] == NULL);
+	procs[pid] = p;
+	p->pid = pid;
+	nprocs++;
+	nextpid = pid + 1;
+
+	splx(s);
+
+	*ret = pid;
+	return 0;
+}
+
+/*
+ * Look up PID. Interrupts must be off.
+ */
+static
+struct process *
+proc_lookup(pid_t pid)
+{
+	assert(curspl>0);
+	if (pid <= 0 || (u_int32_t)pid >= proc_cap) {
+		return NULL;
+	}
+	return procs[pid];
+}
+
+struct process *
+proc_get(pid_t pid)
+{
+	struct process *p;
+	int s;
+
+	s = splhigh();
+	p = proc_lookup(pid);
+	splx(s);
+
+	return p;
+}
+
+/*
+ * Family list operations. Interrupts must be off.
+ */
+static
+void
+plist_add(struct process **head, struct process *p)
+{
+	p->prev = NULL;
+	p->next = *head;
+	if (*head != NULL) {
+		(*head)->prev = p;
+	}
+	*head = p;
+}
+
+static
+void
+plist_remove(struct process **head, struct process *p)
+{
+	if (p->prev != NULL) {
+		p->prev->next = p->next;
+	}
+	else {
+		assert(*head == p);
+		*head = p->next;
+	}
+	if (p->next != NULL) {
+		p->next->prev = p->prev;
+	}
+	p->next = p->prev = NULL;
+}
+
+/*
+ * Take P out of its parent's lists and forget the parent.
+ * Interrupts must be off.
+ */
+static
+void
+proc_unlink(struct process *p)
+{
+	struct process *parent;
+
+	if (p->ppid == -1) {
+		return;
+	}
+	parent = proc_lookup(p->ppid);
+	assert(parent != NULL);
+	plist_remove(p->exited ? &parent->zombies : &parent->children, p);
+	p->ppid = -1;
+}
+
+/*
+ * P is going away: its running children become orphans, and its
+ * zombies can never be waited for, so free them. Interrupts must be
+ * off.
+ */
+static
+void
+proc_disown(struct process *p)
+{
+	struct process *c;
+
+	while ((c = p->children) != NULL) {
+		plist_remove(&p->children, c);
+		c->ppid = -1;
+	}
+	while ((c = p->zombies) != NULL) {
+		plist_remove(&p->zombies, c);
+		c->ppid = -1;
+		proc_free(c->pid);
+	}
+}
+
+void
+proc_free(pid_t pid)
+{
+	struct process *p;
+	int s;
+
+	s = splhigh();
+	p = proc_lookup(pid);
+	assert(p != NULL);
+	proc_unlink(p);
+	proc_disown(p);
+	procs[pid] = NULL;
+	bitmap_unmark(pidmap, pid);
+	nprocs--;
+	splx(s);
+
+	uthread_freeall(p);
+	kfree(p);
+}
+
+void
+proc_adopt(pid_t ppid, pid_t pid)
+{
+	struct process *parent, *p;
+	int s;
+
+	s = splhigh();
+	parent = proc_lookup(ppid);
+	p = proc_lookup(pid);
+	assert(parent != NULL && p != NULL);
+	assert(p->ppid == -1 && !p->exited);
+	p->ppid = ppid;
+	plist_add(&parent->children, p);
+	splx(s);
+}
+
+void
+proc_detach(pid_t pid)
+{
+	struct process *p;
+	pid_t ppid;
+	int s;
+
+	s = splhigh();
+	p = proc_lookup(pid);
+	assert(p != NULL);
+	ppid = p->ppid;
+	proc_unlink(p);
+	if (ppid != -1) {
+		/* it might have been the last child a wait-any was after */
+		thread_wakeup(proc_lookup(ppid));
+	}
+	splx(s);
+}
+
+void
+proc_exit(pid_t pid, int code)
+{
+	struct process *p, *parent;
+	int s;
+
+	s = splhigh();
+	p = proc_lookup(pid);
+	assert(p != NULL && !p->exited);
+
+	proc_disown(p);
+	p->exitcode = code;
+	if (p->ppid != -1) {
+		parent = proc_lookup(p->ppid);
+		assert(parent != NULL);
+		plist_remove(&parent->children, p);
+		plist_add(&parent->zombies, p);
+		thread_wakeup(parent);
+	}
+	p->exited = 1;
+	splx(s);
+}
+
+int
+proc_wait(pid_t ppid, pid_t pid, int options, pid_t *retpid, int *retcode)
+{
+	struct process *me, *c;
+	int s;
+
+	s = splhigh();
+	me = proc_lookup(ppid);
+	assert(me != NULL);
+
+	while (1) {
+		if (pid == -1) {
+			c = me->zombies;
+			if (c == NULL && me->children == NULL) {
+				splx(s);
+				return ECHILD;
+			}
+		}
+		else {
+			c = proc_lookup(pid);
+			if (c == NULL || c->ppid != ppid) {
+				splx(s);
+				return EINVAL;
+			}
+			if (!c->exited) {
+				c = NULL;
+			}
+		}
+		if (c != NULL) {
+			break;
+		}
+		if (options & WNOHANG) {
+			splx(s);
+			*retpid = 0;
+			return 0;
+		}
+		if (thread_interrupted()) {
+			splx(s);
+			return EINTR;
+		}
+		/* children wake us up when they exit */
+		thread_sleep(me);
+	}
+
+	*retpid = c->pid;
+	*retcode = c->exitcode;
+	proc_free(c->pid);
+	splx(s);
+
+	return 0;
+}
+
+int
+proctable_setmax(int n)
+{
+	int s, result = 0;
+
+	s = splhigh();
+	if (n < 1 || n > PROC_MAX_LIMIT || (u_int32_t)n + 1 < proc_cap
+	    || n < nprocs) {
+		result = EINVAL;
+	}
+	else {
+		maxproc = n;
+	}
+	splx(s);
+
+	return result;
+}
+
+int
+proctable_getmax(void)
+{
+	return maxproc;
+}
+
+int
+proctable_count(void)
+{
+	return nprocs;
+}
+
+void
+proctable_shutdown(void)
+{
+	u_int32_t i;
+
+	for (i = 1; i < proc_cap; i++) {
+		if (procs[i] != NULL) {
+			proc_free(i);
+		}
+	}
+	bitmap_destroy(pidmap);
+	kfree(procs);
+	pidmap = NULL;
+	procs = NULL;
+	proc_cap = 0;
+}
+
+void
+proc_tick(pid_t pid, int user)
+{
+	struct process *p;
+
+	p = proc_lookup(pid);
+	if (p == NULL) {
+		return;
+	}
+	if (user) {
+		p->utime++;
+	}
+	else {
+		p->stime++;
+	}
+}
+
+void
+proc_switched(pid_t pid, int voluntary)
+{
+	struct process *p;
+
+	p = proc_lookup(pid);
+	if (p == NULL) {
+		return;
+	}
+	if (voluntary) {
+		p->nvcsw++;
+	}
+	else {
+		p->nivcsw++;
+	}
+}
+
+/*
+ * Fill in the parts of PS that come from thread T, unless an earlier
+ * thread (FIRST is 0) was busier. Interrupts must be off.
+ */
+static
+void
+proc_snapthread(struct psinfo *ps, struct thread *t, int first)
+{
+	int state, i;
+
+	if (t == curthread) {
+		state = PS_RUN;
+	}
+	else if (t->t_sleepaddr != NULL) {
+		state = PS_SLEEP;
+	}
+	else {
+		state = PS_READY;
+	}
+	if (!first && state >= ps->ps_state) {
+		return;
+	}
+
+	ps->ps_state = state;
+	ps->ps_level = t->t_level;
+	ps->ps_tickets = t->t_tickets;
+	if (ps->ps_rss == 0 && t->t_vmspace != NULL) {
+		ps->ps_rss = as_resident(t->t_vmspace);
+	}
+	for (i=0; i<PSINFO_NAMELEN-1 && t->t_name[i] != 0; i++) {
+		ps->ps_name[i] = t->t_name[i];
+	}
+	ps->ps_name[i] = 0;
+}
+
+int
+proc_snapshot(struct psinfo *buf, int max)
+{
+	struct process *p;
+	struct psinfo *ps;
+	struct uthread *ut;
+	u_int32_t pid;
+	int n = 0, first, s;
+
+	s = splhigh();
+	for (pid=1; pid<proc_cap && n<max; pid++) {
+		p = procs[pid];
+		if (p == NULL) {
+			continue;
+		}
+		ps = &buf[n++];
+		bzero(ps, sizeof(*ps));
+		ps->ps_pid = p->pid;
+		ps->ps_ppid = p->ppid;
+		ps->ps_nthreads = p->nthreads;
+		ps->ps_utime = p->utime;
+		ps->ps_stime = p->stime;
+		ps->ps_nvcsw = p->nvcsw;
+		ps->ps_nivcsw = p->nivcsw;
+
+		/* a zombie's thread may be gone already */
+		if (p->exited) {
+			ps->ps_state = PS_ZOMB;
+			ps->ps_nthreads = 0;
+			continue;
+		}
+		first = 1;
+		if (p->t != NULL) {
+			proc_snapthread(ps, p->t, first);
+			first = 0;
+		}
+		for (ut = p->threads; ut != NULL; ut = ut->ut_next) {
+			if (ut->ut_thread != NULL && ut->ut_thread != p->t) {
+				proc_snapthread(ps, ut->ut_thread, first);
+				first = 0;
+			}
+		}
+	}
+	splx(s);
+
+	return n;
+}
@@ -0,0 +1,246 @@
+/*
+ * PC-sampling profiler. See prof.h.
+ *
+ * Sampling happens in the timer interrupt, so everything it touches
+ * is allocated up front by prof_start, and the rest of the code
+ * works with interrupts off.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <vm.h>
+#include <thread.h>
+#include <curthread.h>
+#include <machine/spl.h>
+#include <machine/trapframe.h>
+#include <machine/specialreg.h>
+#include <prof.h>
+#include "opt-A2.h"
+
+/* End of kernel code, from the linker script. */
+extern char _etext[];
+
+/* A process that has user samples. */
+struct prof_proc {
+	pid_t pp_pid;
+	char pp_name[PROF_NAMELEN];
+};
+
+/* One user bucket. pu_count == 0 means the slot is free. */
+struct prof_user {
+	int pu_proc;            /* index into prof_procs */
+	vaddr_t pu_pc;          /* start of bucket */
+	u_int32_t pu_count;
+};
+
+static int prof_running;
+
+static u_int32_t *prof_kern;          /* kernel histogram */
+static u_int32_t prof_nkern;          /* its number of buckets */
+static struct prof_user *prof_users;
+static struct prof_proc *prof_procs;
+static int prof_nprocs;
+
+static u_int32_t prof_samples;        /* ticks while running */
+static u_int32_t prof_ksamples;
+static u_int32_t prof_usamples;
+static u_int32_t prof_dropped;        /* samples with nowhere to go */
+
+/*
+ * Whether NAME, cut to fit, is the name stored as SAVED.
+ */
+static
+int
+prof_samename(const char *saved, const char *name)
+{
+	int i;
+
+	for (i=0; i<PROF_NAMELEN-1; i++) {
+		if (saved[i] != name[i]) {
+			return 0;
+		}
+		if (name[i] == 0) {
+			return 1;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Find or add the record for the current process. Returns -1 if the
+ * table is full. Matches on name as well as pid, so a pid that gets
+ * reused, or a process that execs, starts a new record.
+ */
+static
+int
+prof_getproc(void)
+{
+	struct prof_proc *pp;
+	const char *name = curthread->t_name;
+	pid_t pid = 0;
+	int i;
+
+#if OPT_A2
+	pid = curthread->pid;
+#endif
+	for (i=0; i<prof_nprocs; i++) {
+		pp = &prof_procs[i];
+		if (pp->pp_pid == pid && prof_samename(pp->pp_name, name)) {
+			return i;
+		}
+	}
+	if (prof_nprocs == PROF_NPROCS) {
+		return -1;
+	}
+
+	pp = &prof_procs[prof_nprocs];
+	pp->pp_pid = pid;
+	for (i=0; i<PROF_NAMELEN-1 && name[i] != 0; i++) {
+		pp->pp_name[i] = name[i];
+	}
+	pp->pp_name[i] = 0;
+	return prof_nprocs++;
+}
+
+/*
+ * Count a user sample at PC. The table is open-addressed on
+ * (process, bucket).
+ */
+static
+void
+prof_user(vaddr_t pc)
+{
+	struct prof_user *pu;
+	int proc, i, slot;
+
+	proc = prof_getproc();
+	if (proc < 0) {
+		prof_dropped++;
+		return;
+	}
+	pc &= ~(vaddr_t)(PROF_BUCKET-1);
+
+	slot = ((pc >> PROF_SHIFT) * 31 + proc) % PROF_USERSLOTS;
+	for (i=0; i<PROF_USERSLOTS; i++) {
+		pu = &prof_users[(slot + i) % PROF_USERSLOTS];
+		if (pu->pu_count == 0) {
+			pu->pu_proc = proc;
+			pu->pu_pc = pc;
+		}
+		if (pu->pu_proc == proc && pu->pu_pc == pc) {
+			pu->pu_count++;
+			prof_usamples++;
+			return;
+		}
+	}
+	prof_dropped++;
+}
+
+void
+prof_tick(void)
+{
+	struct trapframe *tf = curintrframe;
+	vaddr_t pc;
+
+	assert(curspl>0);
+
+	if (!prof_running || tf == NULL || curthread == NULL) {
+		return;
+	}
+	prof_samples++;
+
+	pc = tf->tf_epc;
+	if (tf->tf_status & CST_KUp) {
+		prof_user(pc);
+	}
+	else if (pc >= MIPS_KSEG0 &&
+		 ((pc - MIPS_KSEG0) >> PROF_SHIFT) < prof_nkern) {
+		prof_kern[(pc - MIPS_KSEG0) >> PROF_SHIFT]++;
+		prof_ksamples++;
+	}
+	else {
+		prof_dropped++;
+	}
+}
+
+int
+prof_start(void)
+{
+	int spl;
+
+	if (prof_kern == NULL) {
+		prof_nkern = (((vaddr_t)_etext - MIPS_KSEG0) >> PROF_SHIFT) + 1;
+		prof_kern = kmalloc(prof_nkern * sizeof(u_int32_t));
+		prof_users = kmalloc(PROF_USERSLOTS *
+				     sizeof(struct prof_user));
+		prof_procs = kmalloc(PROF_NPROCS * sizeof(struct prof_proc));
+		if (prof_kern == NULL || prof_users == NULL ||
+		    prof_procs == NULL) {
+			if (prof_kern != NULL) kfree(prof_kern);
+			if (prof_users != NULL) kfree(prof_users);
+			if (prof_procs != NULL) kfree(prof_procs);
+			prof_kern = NULL;
+			prof_users = NULL;
+			prof_procs = NULL;
+			return ENOMEM;
+		}
+	}
+
+	spl = splhigh();
+	bzero(prof_kern, prof_nkern * sizeof(u_int32_t));
+	bzero(prof_users, PROF_USERSLOTS * sizeof(struct prof_user));
+	prof_nprocs = 0;
+	prof_samples = prof_ksamples = prof_usamples = prof_dropped = 0;
+	prof_running = 1;
+	splx(spl);
+	return 0;
+}
+
+void
+prof_stop(void)
+{
+	prof_running = 0;
+}
+
+void
+prof_dump(void)
+{
+	struct prof_user *pu;
+	u_int32_t i;
+	int running, spl;
+
+	if (prof_kern == NULL) {
+		kprintf("prof: no samples; use prof start\n");
+		return;
+	}
+
+	/* hold still while we print */
+	spl = splhigh();
+	running = prof_running;
+	prof_running = 0;
+	splx(spl);
+
+	kprintf("prof: begin %u samples, %u kernel, %u user, %u dropped, "
+		"%d-byte buckets\n", prof_samples, prof_ksamples,
+		prof_usamples, prof_dropped, PROF_BUCKET);
+	for (i=0; i<prof_nkern; i++) {
+		if (prof_kern[i] != 0) {
+			kprintf("prof: k %08x %u\n",
+				MIPS_KSEG0 + (i << PROF_SHIFT), prof_kern[i]);
+		}
+	}
+	for (i=0; i<(u_int32_t)prof_nprocs; i++) {
+		kprintf("prof: p %u %d %s\n", i, prof_procs[i].pp_pid,
+			prof_procs[i].pp_name);
+	}
+	for (i=0; i<PROF_USERSLOTS; i++) {
+		pu = &prof_users[i];
+		if (pu->pu_count != 0) {
+			kprintf("prof: u %d %08x %u\n", pu->pu_proc,
+				pu->pu_pc, pu->pu_count);
+		}
+	}
+	kprintf("prof: end\n");
+
+	prof_running = running;
+}
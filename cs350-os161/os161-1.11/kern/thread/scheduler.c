@@ -1,23 +1,83 @@
 /*
  * Scheduler.
  *
- * The default scheduler is very simple, just a round-robin run queue.
- * You'll want to improve it.
+ * Multi-level feedback queue. There are SCHED_NLEVELS run queues,
+ * level 0 being the highest priority; scheduler() always takes the
+ * first thread from the highest non-empty one. A thread at level L
+ * gets a quantum of sched_quantum_ms[L] milliseconds, rounded to
+ * whole ticks (at least one), so it doesn't change with HZ:
+ *
+ *   - Using up its quantum drops a thread one level. It only has to
+ *     give up the CPU if something else is runnable.
+ *   - Waking up from a sleep (waiting for I/O, the console, a lock,
+ *     ...) raises it one level, and gives it a fresh quantum.
+ *   - Every SCHED_BOOSTTICKS ticks, everything goes back to level 0,
+ *     so a long-running thread at the bottom can't starve.
+ *
+ * A thread is also preempted at the end of a tick if something at a
+ * higher level has become runnable.
+ *
+ * With nothing runnable, the scheduler waits in clock_idle, which
+ * can stop the tick altogether until the next timer is due.
+ *
+ * Threads with tickets (t_tickets > 0, set per process by __tickets)
+ * are scheduled by stride scheduling instead. Each tick such a thread
+ * runs advances its pass by its stride, STRIDE1/tickets, and the
+ * runnable thread with the lowest pass goes next, so CPU time is
+ * shared in proportion to tickets. The feedback queues as a whole
+ * take part as one more client, with SCHED_TSTICKETS tickets and pass
+ * ts_pass, so neither class can starve the other. A client coming
+ * back after sleeping can't spend time it banked while away: its pass
+ * is moved up to sched_vtime, the pass of the last one dispatched.
  */
 
 #include <types.h>
 #include <lib.h>
 #include <scheduler.h>
 #include <thread.h>
+#include <timer.h>
+#include <clock.h>
 #include <machine/spl.h>
 #include <queue.h>
+#include <array.h>
 
 /*
  *  Scheduler data
  */
 
-// Queue of runnable threads
-static struct queue *runqueue;
+// Queues of runnable threads, one per level
+static struct queue *runqueue[SCHED_NLEVELS];
+
+// Quantum at each level, in milliseconds, and in ticks
+static const int sched_quantum_ms[SCHED_NLEVELS] = { 10, 20, 40, 80 };
+static int sched_quantum[SCHED_NLEVELS];
+
+// Ticks until the next anti-starvation boost
+static int boostcount;
+
+// Stride scheduling: runnable threads with tickets, in no order
+static struct array *stridequeue;
+static u_int32_t ts_pass;       /* pass of the feedback queues */
+static u_int32_t sched_vtime;   /* pass of the last dispatch */
+
+#define STRIDE1  (1 << 16)
+#define STRIDE(tickets)  (STRIDE1 / (tickets))
+
+/* Compare passes, allowing for wraparound */
+#define PASS_BEFORE(a, b)  ((int32_t)((a) - (b)) < 0)
+
+// Statistics; see sched_printstats
+static struct {
+	int nready;                /* threads in the queue now */
+	int maxready;              /* most ever */
+	u_int32_t dispatches;      /* threads taken from this queue */
+	u_int32_t waitticks;       /* total ticks they spent queued */
+	u_int32_t maxwait;         /* longest wait */
+	u_int32_t demotions;       /* threads dropped to this level */
+	u_int32_t promotions;      /* threads raised to this level */
+} levelstats[SCHED_NLEVELS];
+static u_int32_t nboosts, npreempts, nkept;
+static u_int32_t stride_dispatches, stride_preempts;
 
 /*
  * Setup function
@@ -25,9 +85,23 @@ static struct queue *runqueue;
 void
 scheduler_bootstrap(void)
 {
-	runqueue = q_create(32);
-	if (runqueue == NULL) {
-		panic("scheduler: Could not create run queue\n");
+	int i;
+
+	for (i=0; i<SCHED_NLEVELS; i++) {
+		runqueue[i] = q_create(32);
+		if (runqueue[i] == NULL) {
+			panic("scheduler: Could not create run queue\n");
+		}
+		sched_quantum[i] = sched_quantum_ms[i] * HZ / 1000;
+		if (sched_quantum[i] < 1) {
+			sched_quantum[i] = 1;
+		}
+	}
+	boostcount = SCHED_BOOSTTICKS;
+
+	stridequeue = array_create();
+	if (stridequeue == NULL) {
+		panic("scheduler: Could not create stride queue\n");
 	}
 }
 
@@ -37,12 +111,23 @@ scheduler_bootstrap(void)
  * if you change the scheduler to not require space outside the 
  * thread structure, for instance, this function can reasonably
  * do nothing.
+ *
+ * Any thread can end up at any level, so every queue needs room for
+ * all of them.
  */
 int
 scheduler_preallocate(int nthreads)
 {
+	int i, result;
+
 	assert(curspl>0);
-	return q_preallocate(runqueue, nthreads);
+	for (i=0; i<SCHED_NLEVELS; i++) {
+		result = q_preallocate(runqueue[i], nthreads);
+		if (result) {
+			return result;
+		}
+	}
+	return array_preallocate(stridequeue, nthreads);
 }
 
 /*
@@ -54,11 +139,21 @@ scheduler_preallocate(int nthreads)
 void
 scheduler_killall(void)
 {
+	int i;
+
 	assert(curspl>0);
-	while (!q_empty(runqueue)) {
-		struct thread *t = q_remhead(runqueue);
+	for (i=0; i<SCHED_NLEVELS; i++) {
+		while (!q_empty(runqueue[i])) {
+			struct thread *t = q_remhead(runqueue[i]);
+			kprintf("scheduler: Dropping thread %s.\n", t->t_name);
+		}
+		levelstats[i].nready = 0;
+	}
+	for (i=0; i<array_getnum(stridequeue); i++) {
+		struct thread *t = array_getguy(stridequeue, i);
 		kprintf("scheduler: Dropping thread %s.\n", t->t_name);
 	}
+	array_setsize(stridequeue, 0);
 }
 
 /*
@@ -71,27 +166,110 @@ scheduler_killall(void)
 void
 scheduler_shutdown(void)
 {
+	int i;
+
 	scheduler_killall();
 
 	assert(curspl>0);
-	q_destroy(runqueue);
-	runqueue = NULL;
+	for (i=0; i<SCHED_NLEVELS; i++) {
+		q_destroy(runqueue[i]);
+		runqueue[i] = NULL;
+	}
+	array_destroy(stridequeue);
+	stridequeue = NULL;
 }
 
 /*
- * Actual scheduler. Returns the next thread to run.  Calls cpu_idle()
- * if there's nothing ready. (Note: cpu_idle must be called in a loop
+ * Highest level with something runnable, or -1 if none.
+ */
+static
+int
+sched_toplevel(void)
+{
+	int i;
+
+	for (i=0; i<SCHED_NLEVELS; i++) {
+		if (!q_empty(runqueue[i])) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Index in the stride queue of the thread with the lowest pass, or
+ * -1 if it's empty. The pass is handed back in PASSP.
+ */
+static
+int
+stride_min(u_int32_t *passp)
+{
+	struct thread *t;
+	int i, best = -1;
+	u_int32_t pass = 0;
+
+	for (i=0; i<array_getnum(stridequeue); i++) {
+		t = array_getguy(stridequeue, i);
+		if (best < 0 || PASS_BEFORE(t->t_pass, pass)) {
+			best = i;
+			pass = t->t_pass;
+		}
+	}
+	*passp = pass;
+	return best;
+}
+
+/*
+ * Take thread I off the stride queue.
+ */
+static
+struct thread *
+stride_take(int i)
+{
+	struct thread *t;
+	int n;
+
+	t = array_getguy(stridequeue, i);
+	n = array_getnum(stridequeue);
+	array_setguy(stridequeue, i, array_getguy(stridequeue, n-1));
+	/* shrinking; can't fail */
+	array_setsize(stridequeue, n-1);
+	return t;
+}
+
+/*
+ * Actual scheduler. Returns the next thread to run.  Calls clock_idle()
+ * if there's nothing ready. (Note: clock_idle must be called in a loop
  * until something's ready - it doesn't know whether the things that
  * wake it up are going to make a thread runnable or not.) 
  */
 struct thread *
 scheduler(void)
 {
+	struct thread *t;
+	u_int32_t wait, pass;
+	int level, i;
+
 	// meant to be called with interrupts off
 	assert(curspl>0);
 	
-	while (q_empty(runqueue)) {
-		cpu_idle();
+	while ((level = sched_toplevel()) < 0 &&
+	       array_getnum(stridequeue) == 0) {
+		clock_idle();
+	}
+
+	/* the feedback queues go only when their pass comes up */
+	i = stride_min(&pass);
+	if (i >= 0 && (level < 0 || PASS_BEFORE(pass, ts_pass))) {
+		t = stride_take(i);
+		if (PASS_BEFORE(sched_vtime, pass)) {
+			sched_vtime = pass;
+		}
+		stride_dispatches++;
+		return t;
+	}
+	if (PASS_BEFORE(sched_vtime, ts_pass)) {
+		sched_vtime = ts_pass;
 	}
 
 	// You can actually uncomment this to see what the scheduler's
@@ -101,20 +279,255 @@ scheduler(void)
 	// 
 	//print_run_queue();
 	
-	return q_remhead(runqueue);
+	t = q_remhead(runqueue[level]);
+	assert(t->t_level == level);
+
+	wait = timer_ticks() - t->t_readytime;
+	levelstats[level].nready--;
+	levelstats[level].dispatches++;
+	levelstats[level].waitticks += wait;
+	if (wait > levelstats[level].maxwait) {
+		levelstats[level].maxwait = wait;
+	}
+	return t;
 }
 
 /* 
  * Make a thread runnable.
- * With the base scheduler, just add it to the end of the run queue.
+ * A thread coming out of thread_sleep (which still has its sleep
+ * address set) is moved up a level first.
  */
 int
 make_runnable(struct thread *t)
 {
+	int result;
+
 	// meant to be called with interrupts off
 	assert(curspl>0);
 
-	return q_addtail(runqueue, t);
+	if (t->t_tickets > 0) {
+		/* no credit for time spent asleep */
+		if (PASS_BEFORE(t->t_pass, sched_vtime)) {
+			t->t_pass = sched_vtime;
+		}
+		result = array_add(stridequeue, t);
+		if (result) {
+			return result;
+		}
+		t->t_readytime = timer_ticks();
+		return 0;
+	}
+
+	/* nor for the feedback queues while they had nothing to run */
+	if (PASS_BEFORE(ts_pass, sched_vtime)) {
+		ts_pass = sched_vtime;
+	}
+
+	if (t->t_sleepaddr != NULL) {
+		if (t->t_level > 0) {
+			t->t_level--;
+			levelstats[t->t_level].promotions++;
+		}
+		t->t_ticks = 0;
+	}
+
+	result = q_addtail(runqueue[t->t_level], t);
+	if (result) {
+		return result;
+	}
+	t->t_readytime = timer_ticks();
+	if (++levelstats[t->t_level].nready > levelstats[t->t_level].maxready) {
+		levelstats[t->t_level].maxready = levelstats[t->t_level].nready;
+	}
+	return 0;
+}
+
+/*
+ * Put everything back at level 0, keeping the order.
+ */
+static
+void
+sched_boost(void)
+{
+	struct thread *t;
+	int i;
+
+	for (i=1; i<SCHED_NLEVELS; i++) {
+		while (!q_empty(runqueue[i])) {
+			t = q_remhead(runqueue[i]);
+			levelstats[i].nready--;
+			t->t_level = 0;
+			t->t_ticks = 0;
+			/* preallocated, so can't fail */
+			q_addtail(runqueue[0], t);
+			levelstats[0].nready++;
+		}
+	}
+	if (levelstats[0].nready > levelstats[0].maxready) {
+		levelstats[0].maxready = levelstats[0].nready;
+	}
+	if (curthread != NULL) {
+		curthread->t_level = 0;
+		curthread->t_ticks = 0;
+	}
+	nboosts++;
+}
+
+int
+scheduler_tick(void)
+{
+	struct thread *cur = curthread;
+	u_int32_t pass;
+	int top, i;
+
+	assert(curspl>0);
+
+	if (--boostcount <= 0) {
+		boostcount = SCHED_BOOSTTICKS;
+		sched_boost();
+	}
+
+	/* idle; nothing to charge */
+	if (cur == NULL) {
+		return 0;
+	}
+
+	top = sched_toplevel();
+	i = stride_min(&pass);
+
+	if (cur->t_tickets > 0) {
+		/* switch if anyone, in either class, is now further back */
+		cur->t_pass += STRIDE(cur->t_tickets);
+		if ((i >= 0 && PASS_BEFORE(pass, cur->t_pass)) ||
+		    (top >= 0 && PASS_BEFORE(ts_pass, cur->t_pass))) {
+			stride_preempts++;
+			return 1;
+		}
+		return 0;
+	}
+
+	ts_pass += STRIDE(SCHED_TSTICKETS);
+	if (i >= 0 && PASS_BEFORE(pass, ts_pass)) {
+		stride_preempts++;
+		return 1;
+	}
+
+	cur->t_ticks++;
+	if (cur->t_ticks >= sched_quantum[cur->t_level]) {
+		cur->t_ticks = 0;
+		if (cur->t_level < SCHED_NLEVELS-1) {
+			cur->t_level++;
+			levelstats[cur->t_level].demotions++;
+		}
+		if (top < 0) {
+			/* no one to switch to; keep going */
+			nkept++;
+			return 0;
+		}
+		return 1;
+	}
+
+	if (top >= 0 && top < cur->t_level) {
+		npreempts++;
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * If T is waiting on a run queue, take it off and return nonzero.
+ */
+static
+int
+sched_unqueue(struct thread *t)
+{
+	struct queue *q;
+	struct thread *x;
+	int i, n, found = 0;
+
+	if (t->t_tickets > 0) {
+		for (i=0; i<array_getnum(stridequeue); i++) {
+			if (array_getguy(stridequeue, i) == t) {
+				stride_take(i);
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	/* go once round its level, putting back everyone else */
+	q = runqueue[t->t_level];
+	n = (q_getend(q) - q_getstart(q) + q_getsize(q)) % q_getsize(q);
+	for (i=0; i<n; i++) {
+		x = q_remhead(q);
+		if (x == t) {
+			found = 1;
+			levelstats[t->t_level].nready--;
+		}
+		else {
+			/* just took one off; can't fail */
+			q_addtail(q, x);
+		}
+	}
+	return found;
+}
+
+void
+sched_settickets(struct thread *t, int tickets)
+{
+	int queued, result;
+
+	assert(curspl>0);
+	assert(tickets >= 0);
+
+	if (t->t_tickets == tickets) {
+		return;
+	}
+	queued = sched_unqueue(t);
+	if (t->t_tickets == 0) {
+		/* joining; start level with everyone else */
+		t->t_pass = sched_vtime;
+	}
+	t->t_tickets = tickets;
+	if (queued) {
+		/* the space was there a moment ago */
+		result = make_runnable(t);
+		assert(result == 0);
+	}
+}
+
+/*
+ * Print the statistics. Quanta and wait times are in milliseconds.
+ */
+void
+sched_printstats(void)
+{
+	int i, spl;
+
+	spl = splhigh();
+	kprintf("level quantum ready maxready dispatches avgwait maxwait "
+		"demoted promoted\n");
+	for (i=0; i<SCHED_NLEVELS; i++) {
+		kprintf("%5d %7d %5d %8d %10lu %7lu %7lu %7lu %8lu\n",
+			i, sched_quantum[i] * (1000/HZ),
+			levelstats[i].nready, levelstats[i].maxready,
+			(unsigned long) levelstats[i].dispatches,
+			levelstats[i].dispatches == 0 ? 0UL :
+			(unsigned long) (levelstats[i].waitticks * (1000/HZ)
+					 / levelstats[i].dispatches),
+			(unsigned long) levelstats[i].maxwait * (1000/HZ),
+			(unsigned long) levelstats[i].demotions,
+			(unsigned long) levelstats[i].promotions);
+	}
+	kprintf("%lu boosts, %lu preemptions by a higher level, "
+		"%lu expired quanta with no one else to run\n",
+		(unsigned long) nboosts, (unsigned long) npreempts,
+		(unsigned long) nkept);
+	kprintf("stride: %d ready, %lu dispatches, %lu preemptions\n",
+		array_getnum(stridequeue),
+		(unsigned long) stride_dispatches,
+		(unsigned long) stride_preempts);
+	splx(spl);
 }
 
 /*
@@ -126,14 +539,18 @@ print_run_queue(void)
 	/* Turn interrupts off so the whole list prints atomically. */
 	int spl = splhigh();
 
-	int i,k=0;
-	i = q_getstart(runqueue);
+	int i,k=0,level;
+
+	for (level=0; level<SCHED_NLEVELS; level++) {
+		i = q_getstart(runqueue[level]);
 	
-	while (i!=q_getend(runqueue)) {
-		struct thread *t = q_getguy(runqueue, i);
-		kprintf("  %2d: %s %p\n", k, t->t_name, t->t_sleepaddr);
-		i=(i+1)%q_getsize(runqueue);
-		k++;
+		while (i!=q_getend(runqueue[level])) {
+			struct thread *t = q_getguy(runqueue[level], i);
+			kprintf("  %2d: [%d] %s %p\n", k, level, t->t_name,
+				t->t_sleepaddr);
+			i=(i+1)%q_getsize(runqueue[level]);
+			k++;
+		}
 	}
 	
 	splx(spl);
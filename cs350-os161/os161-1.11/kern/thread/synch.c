@@ -1,22 +1,146 @@
 /*
  * Synchronization primitives.
  * See synch.h for specifications of the functions.
+ *
+ * Each primitive keeps its own FIFO of blocked threads (a waitq).
+ * Releasing hands the resource directly to the thread at the front
+ * and wakes only that thread, so there's no herd of threads all
+ * waking to fight over it, and nobody can barge in ahead of a thread
+ * that has been waiting.
  */
 #include "opt-A1.h"
 #include <types.h>
+#include <kern/errno.h>
 #include <lib.h>
 #include <synch.h>
 #include <thread.h>
 #include <curthread.h>
 #include <machine/spl.h>
 
-#if OPT_A1
-extern int q_addtail(struct queue *,void *);
-extern void * q_remhead(struct queue *);
-extern int q_empty(struct queue *);
-extern struct queue * q_create(int);
-extern void q_destroy(struct queue *);
-#endif
+////////////////////////////////////////////////////////////
+//
+// Wait queues. Interrupts must be off for all of these.
+
+static
+void
+waitq_init(struct waitq *wq)
+{
+	wq->wq_head = wq->wq_tail = NULL;
+}
+
+static
+int
+waitq_empty(struct waitq *wq)
+{
+	return wq->wq_head == NULL;
+}
+
+/*
+ * Put the current thread on the back of WQ, without sleeping yet.
+ */
+static
+void
+waitq_add(struct waitq *wq)
+{
+	assert(curspl>0);
+
+	curthread->t_synchnext = NULL;
+	curthread->t_synchwait = 1;
+	if (wq->wq_tail == NULL) {
+		wq->wq_head = curthread;
+	}
+	else {
+		wq->wq_tail->t_synchnext = curthread;
+	}
+	wq->wq_tail = curthread;
+}
+
+/*
+ * Take the current thread back off WQ without having been woken.
+ */
+static
+void
+waitq_remove(struct waitq *wq)
+{
+	struct thread *t, *prev = NULL;
+
+	assert(curspl>0);
+
+	for (t = wq->wq_head; t != curthread; t = t->t_synchnext) {
+		assert(t != NULL);
+		prev = t;
+	}
+	if (prev == NULL) {
+		wq->wq_head = t->t_synchnext;
+	}
+	else {
+		prev->t_synchnext = t->t_synchnext;
+	}
+	if (wq->wq_tail == t) {
+		wq->wq_tail = prev;
+	}
+	t->t_synchnext = NULL;
+	t->t_synchwait = 0;
+}
+
+/*
+ * Sleep until taken off WQ by waitq_wakeone or waitq_wakeall.
+ * Each thread sleeps on its own address, so waking it disturbs
+ * nobody else. If INTR is set, also give up, leaving the queue and
+ * returning EINTR, if the thread is interrupted (see
+ * thread_interrupt).
+ */
+static
+int
+waitq_sleep(struct waitq *wq, int intr)
+{
+	assert(curspl>0);
+
+	while (curthread->t_synchwait) {
+		if (intr && thread_interrupted()) {
+			waitq_remove(wq);
+			return EINTR;
+		}
+		thread_sleep(curthread);
+	}
+	return 0;
+}
+
+/*
+ * Take the first thread off WQ and wake it. Returns it, or NULL if
+ * the queue was empty.
+ */
+static
+struct thread *
+waitq_wakeone(struct waitq *wq)
+{
+	struct thread *t;
+
+	assert(curspl>0);
+
+	t = wq->wq_head;
+	if (t == NULL) {
+		return NULL;
+	}
+	wq->wq_head = t->t_synchnext;
+	if (wq->wq_head == NULL) {
+		wq->wq_tail = NULL;
+	}
+	t->t_synchnext = NULL;
+	t->t_synchwait = 0;
+	thread_wakeup(t);
+	return t;
+}
+
+static
+void
+waitq_wakeall(struct waitq *wq)
+{
+	while (waitq_wakeone(wq) != NULL) {
+		/* nothing */
+	}
+}
+
 ////////////////////////////////////////////////////////////
 //
 // Semaphore.
@@ -40,6 +164,10 @@ sem_create(const char *namearg, int initial_count)
 	}
 
 	sem->count = initial_count;
+	waitq_init(&sem->waiters);
+#if OPT_LOCKSTAT
+	lockstat_init(&sem->stats, sem->name, 1);
+#endif
 	return sem;
 }
 
@@ -50,9 +178,13 @@ sem_destroy(struct semaphore *sem)
 	assert(sem != NULL);
 
 	spl = splhigh();
-	assert(thread_hassleepers(sem)==0);
+	assert(waitq_empty(&sem->waiters));
 	splx(spl);
 
+#if OPT_LOCKSTAT
+	lockstat_fini(&sem->stats);
+#endif
+
 	/*
 	 * Note: while someone could theoretically start sleeping on
 	 * the semaphore after the above test but before we free it,
@@ -66,10 +198,11 @@ sem_destroy(struct semaphore *sem)
 	kfree(sem);
 }
 
-void 
-P(struct semaphore *sem)
+static
+int
+sem_down(struct semaphore *sem, int intr)
 {
-	int spl;
+	int spl, result = 0;
 	assert(sem != NULL);
 
 	/*
@@ -81,12 +214,41 @@ P(struct semaphore *sem)
 	assert(in_interrupt==0);
 
 	spl = splhigh();
-	while (sem->count==0) {
-		thread_sleep(sem);
+	if (sem->count > 0) {
+		sem->count--;
+#if OPT_LOCKSTAT
+		lockstat_acquired(&sem->stats, 0, 0, 0);
+#endif
+	}
+	else {
+#if OPT_LOCKSTAT
+		time_t secs;
+		u_int32_t nsecs;
+		lockstat_now(&secs, &nsecs);
+#endif
+		/* V hands us the unit directly; count stays 0 */
+		waitq_add(&sem->waiters);
+		result = waitq_sleep(&sem->waiters, intr);
+#if OPT_LOCKSTAT
+		if (result == 0) {
+			lockstat_acquired(&sem->stats, 1, secs, nsecs);
+		}
+#endif
 	}
-	assert(sem->count>0);
-	sem->count--;
 	splx(spl);
+	return result;
+}
+
+void 
+P(struct semaphore *sem)
+{
+	sem_down(sem, 0);
+}
+
+int
+P_intr(struct semaphore *sem)
+{
+	return sem_down(sem, 1);
 }
 
 void
@@ -95,9 +257,13 @@ V(struct semaphore *sem)
 	int spl;
 	assert(sem != NULL);
 	spl = splhigh();
-	sem->count++;
-	assert(sem->count>0);
-	thread_wakeup(sem);
+#if OPT_LOCKSTAT
+	lockstat_released(&sem->stats);
+#endif
+	if (waitq_wakeone(&sem->waiters) == NULL) {
+		sem->count++;
+		assert(sem->count>0);
+	}
 	splx(spl);
 }
 
@@ -123,7 +289,11 @@ lock_create(const char *name)
 	#if OPT_A1
         lock->status = 0;    // initially unlocked
         lock->target = NULL; // no one has a lock
+        waitq_init(&lock->waiters);
 	#endif
+#if OPT_LOCKSTAT
+	lockstat_init(&lock->stats, lock->name, 0);
+#endif
 	return lock;
 }
 
@@ -135,10 +305,15 @@ lock_destroy(struct lock *lock)
 
         int spl;
         spl = splhigh();
-	assert(thread_hassleepers(lock)==0);
+	assert(lock->status == 0);
+	assert(waitq_empty(&lock->waiters));
         splx(spl);
         #endif
 
+#if OPT_LOCKSTAT
+	lockstat_fini(&lock->stats);
+#endif
+
 	kfree(lock->name);
 	kfree(lock);
 }
@@ -154,20 +329,34 @@ lock_acquire(struct lock *lock)
 	int spl;
         // Disable all the interrupts
         spl = splhigh();
-        
-        // other threads must be waiting while one thread is in critical section        
-        while (lock->status == 1){
-           thread_sleep(lock);
+
+        assert (lock->target != curthread);
+
+        if (lock->status == 0) {
+           // free: take it
+           lock->status = 1;
+           lock->target = curthread;
+#if OPT_LOCKSTAT
+           lockstat_acquired(&lock->stats, 0, 0, 0);
+#endif
         }
-        
-       
-        assert (lock->status == 0)
-        // enable the lock
-        lock->status = 1;
-        
+        else {
+#if OPT_LOCKSTAT
+           time_t secs;
+           u_int32_t nsecs;
+           lockstat_now(&secs, &nsecs);
+#endif
+           // wait our turn; lock_release passes it straight to us
+           waitq_add(&lock->waiters);
+           waitq_sleep(&lock->waiters, 0);
+#if OPT_LOCKSTAT
+           lockstat_acquired(&lock->stats, 1, secs, nsecs);
+#endif
+        }
+
         assert(lock->status==1);
-        
-        lock->target = curthread;
+        assert(lock->target == curthread);
+
         // enable interrupts
         splx(spl);
         #else
@@ -184,17 +373,24 @@ lock_release(struct lock *lock)
         assert (lock != NULL);
         
         int spl;
+        struct thread *next;
         // disable interrupts
         spl = splhigh();
         
         assert (lock_do_i_hold(lock) == 1); // make sure right lock locks the right thread
 
-        // release the lock
-        lock ->status = 0;
-        assert (lock->status==0); // check
-
-        lock->target = NULL;
-        thread_wakeup(lock);
+#if OPT_LOCKSTAT
+        lockstat_released(&lock->stats);
+#endif
+        next = waitq_wakeone(&lock->waiters);
+        if (next != NULL) {
+           // hand it over; it stays locked
+           lock->target = next;
+        }
+        else {
+           lock->status = 0;
+           lock->target = NULL;
+        }
   
         // enable interrupts
         splx(spl);
@@ -232,8 +428,7 @@ cv_create(const char *name)
 		return NULL;
 	}
         #if OPT_A1
-	cv->sleeping_list = (struct queue *)q_create(10);
-	// add stuff here as needed
+	waitq_init(&cv->waiters);
 	#endif
 	return cv;
 }
@@ -243,19 +438,22 @@ cv_destroy(struct cv *cv)
 {
 	assert(cv != NULL);
 
-	// add stuff here as needed
-	
-	kfree(cv->name);
         #if OPT_A1
-        q_destroy(cv->sleeping_list);
+        int spl = splhigh();
+        assert(waitq_empty(&cv->waiters));
+        splx(spl);
         #endif
+	
+	kfree(cv->name);
 	kfree(cv);
         
 }
 
-void
-cv_wait(struct cv *cv, struct lock *lock)
+static
+int
+cv_sleep(struct cv *cv, struct lock *lock, int intr)
 {
+	int result = 0;
 	#if OPT_A1
 	// validate parameter
         assert (cv != NULL);
@@ -263,18 +461,14 @@ cv_wait(struct cv *cv, struct lock *lock)
         // disable interrupts
         int spl = splhigh();
 
-        // release the lock
-        assert (lock->status == 1);
-       
-        lock_release(lock);
-        assert (lock->status == 0);
+        assert (lock_do_i_hold(lock) == 1);
 
-        q_addtail(cv->sleeping_list,curthread);
-        // sleep
-        thread_sleep(curthread);
+        // get in line before letting go of the lock, so a signal
+        // sent as soon as it's released isn't lost
+        waitq_add(&cv->waiters);
+        lock_release(lock);
+        result = waitq_sleep(&cv->waiters, intr);
 
-        
-        
         lock_acquire(lock);
         // enable interrupts
         splx(spl);
@@ -282,13 +476,27 @@ cv_wait(struct cv *cv, struct lock *lock)
         #else
         (void) cv;
         (void) lock;
+        (void) intr;
         #endif
+	return result;
+}
+
+void
+cv_wait(struct cv *cv, struct lock *lock)
+{
+	cv_sleep(cv, lock, 0);
+}
+
+int
+cv_wait_intr(struct cv *cv, struct lock *lock)
+{
+	return cv_sleep(cv, lock, 1);
 }
 
 void
 cv_signal(struct cv *cv, struct lock *lock)
 {
-	#if opt_A1
+	#if OPT_A1
         // validate parameter
 
         assert (cv != NULL);
@@ -300,14 +508,11 @@ cv_signal(struct cv *cv, struct lock *lock)
         // disable interrupts
         int spl = splhigh();
        
-        if (q_empty(cv->sleeping_list)) goto done;   // signal must be called after wait!
- 
-        // pick one thread and wake it up
-        thread_wakeup((struct thread*) q_remhead(cv->sleeping_list));
+        // wake the thread that has waited longest
+        waitq_wakeone(&cv->waiters);
        
-        
         // enable interrupts
-done:   splx(spl);    
+        splx(spl);    
         #else
         (void) cv;
         (void) lock;
@@ -330,31 +535,198 @@ cv_broadcast(struct cv *cv, struct lock *lock)
        // disable interrupts
        int spl = splhigh();
  
-       // test
-       if (q_empty(cv->sleeping_list)) goto done;
-
        // wake up all threads
-       while (!q_empty(cv->sleeping_list)) {
-         thread_wakeup((struct thread*) q_remhead(cv->sleeping_list));
-       }
+       waitq_wakeall(&cv->waiters);
        
        // enable interrupts
-done:  splx(spl);
+       splx(spl);
        #else
        (void) cv;
        (void) lock;
        #endif
+}
+
+////////////////////////////////////////////////////////////
+//
+// Reader-writer lock.
+//
+// Like the lock, releasing hands the rwlock straight to whoever is
+// next: a writer finishing lets in all the readers queued behind it
+// at once (counting them into readers itself), otherwise the next
+// writer; the last reader out lets in the next writer.
+
+struct rwlock *
+rwlock_create(const char *name)
+{
+	struct rwlock *rw;
+
+	rw = kmalloc(sizeof(struct rwlock));
+	if (rw == NULL) {
+		return NULL;
+	}
+
+	rw->name = kstrdup(name);
+	if (rw->name == NULL) {
+		kfree(rw);
+		return NULL;
+	}
+	#if OPT_A1
+	rw->readers = 0;
+	rw->writer = NULL;
+	waitq_init(&rw->readwaiters);
+	waitq_init(&rw->writewaiters);
+	#endif
+	return rw;
+}
+
+void
+rwlock_destroy(struct rwlock *rw)
+{
+	assert(rw != NULL);
+
+        #if OPT_A1
+        int spl = splhigh();
+	assert(rw->readers == 0);
+	assert(rw->writer == NULL);
+	assert(waitq_empty(&rw->readwaiters));
+	assert(waitq_empty(&rw->writewaiters));
+        splx(spl);
+        #endif
+
+	kfree(rw->name);
+	kfree(rw);
+}
+
+void
+rwlock_acquire_read(struct rwlock *rw)
+{
+        #if OPT_A1
+	int spl;
+
+        assert(rw != NULL);
+        assert(in_interrupt == 0);
+
+	spl = splhigh();
+	assert(rw->writer != curthread);
 
+	if (rw->writer == NULL && waitq_empty(&rw->writewaiters)) {
+		rw->readers++;
+	}
+	else {
+		// the writer ahead of us counts us in when it's done
+		waitq_add(&rw->readwaiters);
+		waitq_sleep(&rw->readwaiters, 0);
+	}
+
+	assert(rw->readers > 0);
+	assert(rw->writer == NULL);
+	splx(spl);
+        #else
+        (void) rw;
+        #endif
+}
 
+void
+rwlock_release_read(struct rwlock *rw)
+{
+        #if OPT_A1
+	struct thread *next;
+	int spl;
 
+        assert(rw != NULL);
 
+	spl = splhigh();
+	assert(rw->readers > 0);
+	assert(rw->writer == NULL);
+
+	rw->readers--;
+	if (rw->readers == 0) {
+		next = waitq_wakeone(&rw->writewaiters);
+		if (next != NULL) {
+			rw->writer = next;
+		}
+	}
+	splx(spl);
+        #else
+        (void) rw;
+        #endif
 }
 
+void
+rwlock_acquire_write(struct rwlock *rw)
+{
+        #if OPT_A1
+	int spl;
 
+        assert(rw != NULL);
+        assert(in_interrupt == 0);
 
+	spl = splhigh();
+	assert(rw->writer != curthread);
 
+	if (rw->writer == NULL && rw->readers == 0) {
+		rw->writer = curthread;
+	}
+	else {
+		waitq_add(&rw->writewaiters);
+		waitq_sleep(&rw->writewaiters, 0);
+	}
 
+	assert(rw->writer == curthread);
+	assert(rw->readers == 0);
+	splx(spl);
+        #else
+        (void) rw;
+        #endif
+}
 
+void
+rwlock_release_write(struct rwlock *rw)
+{
+        #if OPT_A1
+	int spl;
+
+        assert(rw != NULL);
+
+	spl = splhigh();
+	assert(rwlock_do_i_hold(rw));
+
+	rw->writer = NULL;
+	if (!waitq_empty(&rw->readwaiters)) {
+		// let in everybody who queued up while we had it
+		while (waitq_wakeone(&rw->readwaiters) != NULL) {
+			rw->readers++;
+		}
+	}
+	else {
+		rw->writer = waitq_wakeone(&rw->writewaiters);
+	}
+	splx(spl);
+        #else
+        (void) rw;
+        #endif
+}
 
+int
+rwlock_do_i_hold(struct rwlock *rw)
+{
+        assert(rw != NULL);
 
+        #if OPT_A1
+	return rw->writer == curthread;
+        #else
+        return 1;
+        #endif
+}
 
+int
+rwlock_is_held(struct rwlock *rw)
+{
+        assert(rw != NULL);
+
+        #if OPT_A1
+	return rw->writer != NULL || rw->readers > 0;
+        #else
+        return 1;
+        #endif
+}
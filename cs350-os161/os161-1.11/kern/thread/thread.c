@@ -16,6 +16,8 @@
 #include <filetable.h>
 #include <synch.h>
 #include <syscall.h>
+#include <proctable.h>
+#include <ktrace.h>
 #include "opt-A2.h"
 
 /* States a thread can be in. */
@@ -29,8 +31,19 @@ typedef enum {
 /* Global variable for the thread currently executing at any given time. */
 struct thread *curthread;
 
-/* Table of sleeping threads. */
-static struct array *sleepers;
+/*
+ * Table of sleeping threads, hashed on sleep address.
+ *
+ * For each address with sleepers, the first thread to sleep on it is
+ * the head of that address's queue and is on its bucket's chain (via
+ * t_wchan); the rest hang off it in order (via t_wqnext), and the
+ * head keeps a pointer to the last (t_wqtail). So finding the
+ * sleepers on an address only looks at other addresses that hash the
+ * same, and nothing here ever needs to allocate memory.
+ */
+#define SLEEP_NBUCKETS  64     /* must be a power of 2 */
+static struct thread *sleepers[SLEEP_NBUCKETS];
+static int sleepers_ready;
 
 /* List of dead threads to be disposed of. */
 static struct array *zombies;
@@ -38,48 +51,190 @@ static struct array *zombies;
 /* Total number of outstanding threads. Does not count zombies[]. */
 static int numthreads;
 
+/*
+ * Cache of dead threads, kept with their stacks, for thread_create
+ * to hand out again instead of going back to kmalloc. Chained
+ * through t_synchnext. Holds at most tcache_max; protected by
+ * turning interrupts off.
+ */
+static struct thread *tcache;
+static int tcache_count;
+static int tcache_max = THREAD_CACHE_DEFAULT;
+static u_int32_t tcache_hits, tcache_misses, tcache_drops;
+
+/*
+ * Take a thread from the cache, or NULL if it's empty.
+ */
+static
+struct thread *
+tcache_get(void)
+{
+	struct thread *thread;
+	int s;
+
+	s = splhigh();
+	thread = tcache;
+	if (thread != NULL) {
+		tcache = thread->t_synchnext;
+		tcache_count--;
+		tcache_hits++;
+	}
+	else {
+		tcache_misses++;
+	}
+	splx(s);
+
+	return thread;
+}
+
+/*
+ * Give back a thread that has no name, process, or anything else
+ * attached, along with its stack: to the cache if there's room,
+ * otherwise to the heap.
+ */
+static
+void
+tcache_put(struct thread *thread)
+{
+	int s;
+
+	if (thread->t_stack != NULL) {
+		s = splhigh();
+		if (tcache_count < tcache_max) {
+			thread->t_synchnext = tcache;
+			tcache = thread;
+			tcache_count++;
+			splx(s);
+			return;
+		}
+		tcache_drops++;
+		splx(s);
+		kfree(thread->t_stack);
+	}
+	kfree(thread);
+}
+
+/*
+ * Free cached threads until there are at most N.
+ */
+static
+void
+tcache_trim(int n)
+{
+	struct thread *thread;
+	int s;
+
+	s = splhigh();
+	while (tcache_count > n) {
+		thread = tcache;
+		tcache = thread->t_synchnext;
+		tcache_count--;
+		kfree(thread->t_stack);
+		kfree(thread);
+	}
+	splx(s);
+}
+
+int
+thread_cache_setmax(int n)
+{
+	if (n < 0 || n > THREAD_CACHE_MAX) {
+		return EINVAL;
+	}
+	tcache_max = n;
+	tcache_trim(n);
+	return 0;
+}
+
+void
+thread_cache_printstats(void)
+{
+	u_int32_t hits, misses, drops, total, pct;
+	int count, max, s;
+
+	s = splhigh();
+	hits = tcache_hits;
+	misses = tcache_misses;
+	drops = tcache_drops;
+	count = tcache_count;
+	max = tcache_max;
+	splx(s);
+
+	/* keep hits*100 from overflowing */
+	total = hits + misses;
+	pct = 0;
+	if (total > 0) {
+		pct = total < 40000000 ? hits*100 / total
+			: hits / (total/100);
+	}
+
+	kprintf("tcache: %d/%d threads cached (%d KB of stacks)\n",
+		count, max, count * STACK_SIZE / 1024);
+	kprintf("tcache: %lu hits, %lu misses (%lu%% hit), %lu dropped\n",
+		(unsigned long) hits, (unsigned long) misses,
+		(unsigned long) pct, (unsigned long) drops);
+}
+
 /*
  * Create a thread. This is used both to create the first thread's 
- * thread structure and to create subsequent threads.
+ * thread structure and to create subsequent threads. If PID is not 0
+ * the thread belongs to that (existing) process; otherwise it gets a
+ * pid of its own.
  */
 
 #if OPT_A2
 // filetable management
-extern void destroy_ft(struct filetable*);
-extern struct filetable* copy_ft(struct filetable*);
 extern void sem_destroy(struct semaphore*);
 extern void lock_destroy(struct lock*);
 extern void cv_destroy(struct cv*);
 extern void vfs_close(struct vnode*);
-// process table management
-struct process* p_table[MAX_PROG+1];
-
 // synch
-extern struct semaphore* t;
-extern struct semaphore* wait;
 extern struct semaphore* file;
-extern struct semaphore* forksem;
-extern struct semaphore* exit;
 #endif
 
 
-extern int call_from_fork;
-
-
 static
 struct thread *
-thread_create(const char *name)
+thread_create(const char *name, pid_t pid, int *err)
 {
-	struct thread *thread = kmalloc(sizeof(struct thread));
-	if (thread==NULL) {
+	struct thread *thread;
+	char *tname;
+
+	tname = kstrdup(name);
+	if (tname==NULL) {
+		*err = ENOMEM;
 		return NULL;
 	}
-	thread->t_name = kstrdup(name);
-	if (thread->t_name==NULL) {
-		kfree(thread);
+
+	thread = tcache_get();
+	if (thread != NULL) {
+		/*
+		 * It went through thread_exit and thread_destroy, which
+		 * left the sleep, synch, VM, cwd and descriptor fields
+		 * cleared; only set what a running thread changes.
+		 */
+		assert(thread->t_sleepaddr == NULL);
+		assert(thread->t_synchwait == 0);
+		assert(thread->t_vmspace == NULL);
+		assert(thread->t_cwd == NULL);
+		thread->t_synchnext = NULL;
+		thread->t_name = tname;
+		goto setsched;
+	}
+
+	thread = kmalloc(sizeof(struct thread));
+	if (thread==NULL) {
+		kfree(tname);
+		*err = ENOMEM;
 		return NULL;
 	}
+	thread->t_name = tname;
 	thread->t_sleepaddr = NULL;
+	thread->t_wchan = NULL;
+	thread->t_wqnext = NULL;
+	thread->t_wqtail = NULL;
+	thread->t_synchnext = NULL;
+	thread->t_synchwait = 0;
 	thread->t_stack = NULL;
 	
 	thread->t_vmspace = NULL;
@@ -87,32 +242,39 @@ thread_create(const char *name)
 	thread->t_cwd = NULL;
 	
 	// If you add things to the thread structure, be sure to initialize
-	// them here.
+	// them here (or above, if a cached thread might not have it right).
+
+        #if OPT_A2
+        thread->fdt = NULL;
+        #endif
+
+ setsched:
+	thread->t_level = 0;
+	thread->t_ticks = 0;
+	thread->t_readytime = 0;
+	thread->t_tickets = 0;
+	thread->t_pass = 0;
 
         /* init file table and arrange process */
         #if OPT_A2
-        int i;
-        for (i = 0 ; i < MAX_FILE ; i++) thread->ft[i] = NULL;
+        assert(thread->fdt == NULL);
+        thread->batch = NULL;
+        thread->tid = 0;
+        thread->exiting = 0;
     
-        pid_t pid = get_pid();        
-        thread->pid = pid;
-      
-        struct process* p = kmalloc(sizeof(struct process));
-        if (p == NULL){
+        if (pid != 0) {
+           thread->pid = pid;
+           return thread;
+        }
+        int result = proc_alloc(thread, &thread->pid);
+        if (result) {
            kfree(thread->t_name);
-           kfree(thread);
+           tcache_put(thread);
+           *err = result;
            return NULL;
         }
-        p->ppid = -1;
-        p->exited = 0;
-        p->exitcode = -1;
-        p->waiting = 0;
-        p->exitlock = NULL;
-        p->exit = NULL;
-        p->t = thread;
-
-        p_table[pid] = p; // new process
-
+        #else
+        (void)pid;
         #endif
 	
 	return thread;
@@ -128,33 +290,60 @@ static
 void
 thread_destroy(struct thread *thread)
 {
+	struct addrspace *as;
+	int s;
+
 	assert(thread != curthread);
 
 	// If you add things to the thread structure, be sure to dispose of
 	// them here or in thread_exit.
 
 	// These things are cleaned up in thread_exit.
-	assert(thread->t_vmspace==NULL);
 	assert(thread->t_cwd==NULL);
-	
-	if (thread->t_stack) {
-		kfree(thread->t_stack);
+
+	// The address space is left to us, to keep exit quick. Unhook
+	// it first (ps may be looking), then free it with interrupts on.
+	s = splhigh();
+	as = thread->t_vmspace;
+	thread->t_vmspace = NULL;
+	splx(s);
+	if (as != NULL) {
+		as_destroy(as);
 	}
 
 	kfree(thread->t_name);
+	thread->t_name = NULL;
         #if OPT_A2
-        int i;
-        for (i = 0 ; i < MAX_FILE ; i++){
-            if (thread->ft[i] != NULL) destroy_ft(thread->ft[i]);
+        if (thread->fdt != NULL) {
+           fdtable_destroy(thread->fdt);
+           thread->fdt = NULL;
+        }
+        // nobody can wait for a process without a parent; recycle its
+        // pid (unless it was already reaped and handed out again)
+        struct process* p = proc_get(thread->pid);
+        if (p != NULL && p->t == thread && p->ppid == -1) {
+           proc_free(thread->pid);
         }
         #endif
-	kfree(thread);
+	tcache_put(thread);
 }
 
 
+/*
+ * Work queue function that finishes off zombie Z.
+ */
+static
+void
+thread_reap(void *z)
+{
+	thread_destroy(z);
+}
+
 /*
  * Remove zombies. (Zombies are threads/processes that have exited but not
- * been fully deleted yet.)
+ * been fully deleted yet.) This runs on every context switch, so just
+ * hand them to the work queue; only once that has shut down are they
+ * destroyed here.
  */
 static
 void
@@ -168,7 +357,10 @@ exorcise(void)
 	for (i=0; i<array_getnum(zombies); i++) {
 		struct thread *z = array_getguy(zombies, i);
 		assert(z!=curthread);
-		thread_destroy(z);
+		work_init(&z->t_reap, thread_reap, z);
+		if (workq_add(&z->t_reap)) {
+			thread_destroy(z);
+		}
 	}
 	result = array_setsize(zombies, 0);
 	/* Shrinking the array; not supposed to be able to fail. */
@@ -183,7 +375,7 @@ static
 void
 thread_killall(void)
 {
-	int i, result;
+	int i;
 
 	assert(curspl>0);
 
@@ -192,9 +384,15 @@ thread_killall(void)
 	 * wake up while we're shutting down.
 	 */
 
-	for (i=0; i<array_getnum(sleepers); i++) {
-		struct thread *t = array_getguy(sleepers, i);
-		kprintf("sleep: Dropping thread %s\n", t->t_name);
+	for (i=0; i<SLEEP_NBUCKETS; i++) {
+		struct thread *head, *t;
+
+		for (head = sleepers[i]; head != NULL; head = head->t_wchan) {
+			for (t = head; t != NULL; t = t->t_wqnext) {
+				kprintf("sleep: Dropping thread %s\n",
+					t->t_name);
+			}
+		}
 
 		/*
 		 * Don't do this: because these threads haven't
@@ -204,11 +402,9 @@ thread_killall(void)
 		 *
 		 * array_add(zombies, t);
 		 */
-	}
 
-	result = array_setsize(sleepers, 0);
-	/* shrinking array: not supposed to fail */
-	assert(result==0);
+		sleepers[i] = NULL;
+	}
 }
 
 /*
@@ -266,23 +462,26 @@ struct thread *
 thread_bootstrap(void)
 {
 	struct thread *me;
+	int err;
 
 	/* Create the data structures we need. */
-	sleepers = array_create();
-	if (sleepers==NULL) {
-		panic("Cannot create sleepers array\n");
-	}
+	sleepers_ready = 1;
 
 	zombies = array_create();
 	if (zombies==NULL) {
 		panic("Cannot create zombies array\n");
 	}
+
+        #if OPT_A2
+        /* The first thread needs a pid too */
+        proctable_bootstrap();
+        #endif
 	
 	/*
 	 * Create the thread structure for the first thread
 	 * (the one that's already running)
 	 */
-	me = thread_create("<boot/menu>");
+	me = thread_create("<boot/menu>", 0, &err);
 	if (me==NULL) {
 		panic("thread_bootstrap: Out of memory\n");
 	}
@@ -301,13 +500,6 @@ thread_bootstrap(void)
 	/* Number of threads starts at 1 */
 	numthreads = 1;
 
-        #if OPT_A2
-        /* init process table */
-        int i;
-        for (i = 0 ; i < MAX_PROG+1 ; ++i) p_table[i] = NULL;
-
-
-        #endif
 	/* Done */
 	return me;
 }
@@ -316,21 +508,9 @@ void
 process_shutdown()
 {
         // free memory
-        if (wait != NULL) sem_destroy(wait);
-        if (t != NULL) sem_destroy(t);
         if (file != NULL) sem_destroy(file);
-        if (forksem != NULL) sem_destroy(forksem);
-        if (exit != NULL) sem_destroy(exit);
         // free process
-        int i;
-        for(i = 1 ; i < MAX_PROG+1 ;++i){
-           if (p_table[i] != NULL){
-              struct process* p = p_table[i];
-              if (p->exit != NULL) cv_destroy(p->exit);
-              if (p->exitlock != NULL) lock_destroy(p->exitlock);
-              kfree(p);
-           }
-         }
+        proctable_shutdown();
 }
 /*
  * Thread final cleanup.
@@ -338,10 +518,10 @@ process_shutdown()
 void
 thread_shutdown(void)
 {
-	array_destroy(sleepers);
-	sleepers = NULL;
+	sleepers_ready = 0;
 	array_destroy(zombies);
 	zombies = NULL;
+	tcache_trim(0);
 	// Don't do this - it frees our stack and we blow up
 	//thread_destroy(curthread);
 }
@@ -350,28 +530,57 @@ thread_shutdown(void)
  * Create a new thread based on an existing one.
  * The new thread has name NAME, and starts executing in function FUNC.
  * DATA1 and DATA2 are passed to FUNC.
+ *
+ * If FDT is not NULL the new thread is a child process of the current
+ * one and gets FDT as its descriptor table. FDT is consumed whether or
+ * not this succeeds. The new thread's pid is handed back in RETPID,
+ * which (unlike RET) is safe to use after the child has exited.
+ *
+ * If SIBLING is set the new thread instead joins the current process,
+ * sharing its pid, descriptor table and address space.
  */
+static
 int
-thread_fork(const char *name, 
-	    void *data1, unsigned long data2,
-	    void (*func)(void *, unsigned long),
-	    struct thread **ret)
+thread_fork_common(const char *name, struct fdtable *fdt, int sibling,
+		   void *data1, unsigned long data2,
+		   void (*func)(void *, unsigned long),
+		   struct thread **ret, pid_t *retpid)
 {
     
 	struct thread *newguy;
 	int s, result;
 
 	/* Allocate a thread */
-	newguy = thread_create(name);
+	newguy = thread_create(name, sibling ? curthread->pid : 0, &result);
 	if (newguy==NULL) {
-		return ENOMEM;
+		#if OPT_A2
+		if (fdt != NULL) {
+			fdtable_destroy(fdt);
+		}
+		#endif
+		return result;
 	}
 
-	/* Allocate a stack */
-	newguy->t_stack = kmalloc(STACK_SIZE);
+	#if OPT_A2
+	newguy->fdt = fdt;
+	#endif
+
+	/* Allocate a stack, unless it came from the cache with one */
+	if (newguy->t_stack == NULL) {
+		newguy->t_stack = kmalloc(STACK_SIZE);
+	}
 	if (newguy->t_stack==NULL) {
+		#if OPT_A2
+		if (!sibling) {
+			proc_free(newguy->pid);
+		}
+		if (newguy->fdt != NULL) {
+			fdtable_destroy(newguy->fdt);
+			newguy->fdt = NULL;
+		}
+		#endif
 		kfree(newguy->t_name);
-		kfree(newguy);
+		tcache_put(newguy);
 		return ENOMEM;
 	}
 
@@ -381,6 +590,10 @@ thread_fork(const char *name,
 	newguy->t_stack[2] = 0xda;
 	newguy->t_stack[3] = 0x33;
 
+	/* Inherit the scheduling class */
+	newguy->t_tickets = curthread->t_tickets;
+	newguy->t_pass = curthread->t_pass;
+
 	/* Inherit the current directory */
 	if (curthread->t_cwd != NULL) {
 		VOP_INCREF(curthread->t_cwd);
@@ -389,27 +602,22 @@ thread_fork(const char *name,
 
 
         #if OPT_A2
-        result = conSetup(newguy);
-        if(result) goto exit;
-           
         // pid
         pid_t pid = newguy->pid;
-        struct process* child = p_table[pid];
-        assert(child != NULL);
  
-        if (call_from_fork){
-           int i;
-           for (i = 3 ; i < MAX_FILE ; ++i) {
-              if (curthread->ft[i] != NULL) {
-                 newguy->ft[i] = (struct filetable*)copy_ft(curthread->ft[i]);
-                 if (newguy->ft[i] == NULL) return ENOMEM;
-              }
-           }
-           child->ppid = curthread->pid;
-           call_from_fork = 0;
+        if (sibling) {
+           // the process's own; given back, not freed, on failure
+           newguy->fdt = curthread->fdt;
+           newguy->t_vmspace = curthread->t_vmspace;
         }
+        else {
+           if (fdt != NULL){
+              proc_adopt(curthread->pid, pid);
+           }
 
-        assert(call_from_fork == 0);
+           result = conSetup(newguy); // stdin, stdout, stderr, if not inherited
+           if(result) goto exit;
+        }
         #endif
        
 	/* Set up the pcb (this arranges for func to be called) */
@@ -422,10 +630,6 @@ thread_fork(const char *name,
 	 * Make sure our data structures have enough space, so we won't
 	 * run out later at an inconvenient time.
 	 */
-	result = array_preallocate(sleepers, numthreads+1);
-	if (result) {
-		goto fail;
-	}
 	result = array_preallocate(zombies, numthreads+1);
 	if (result) {
 		goto fail;
@@ -455,6 +659,12 @@ thread_fork(const char *name,
 	 */
 	numthreads++;
 
+	#if OPT_A2
+	if (retpid != NULL) {
+		*retpid = newguy->pid;
+	}
+	#endif
+
 	/* Done with stuff that needs to be atomic */
 	splx(s);
 
@@ -475,14 +685,179 @@ thread_fork(const char *name,
 	splx(s);
  exit:	if (newguy->t_cwd != NULL) {
 		VOP_DECREF(newguy->t_cwd);
+		newguy->t_cwd = NULL;
 	}
-	kfree(newguy->t_stack);
+	#if OPT_A2
+	if (sibling) {
+		newguy->fdt = NULL;
+		newguy->t_vmspace = NULL;
+	}
+	else {
+		proc_free(newguy->pid);
+	}
+	if (newguy->fdt != NULL) {
+		fdtable_destroy(newguy->fdt);
+		newguy->fdt = NULL;
+	}
+	#endif
 	kfree(newguy->t_name);
-	kfree(newguy);
+	tcache_put(newguy);
 
 	return result;
 }
 
+int
+thread_fork(const char *name, 
+	    void *data1, unsigned long data2,
+	    void (*func)(void *, unsigned long),
+	    struct thread **ret)
+{
+	return thread_fork_common(name, NULL, 0, data1, data2, func, ret, NULL);
+}
+
+#if OPT_A2
+int
+thread_fork_process(const char *name, struct fdtable *fdt,
+		    void *data1, unsigned long data2,
+		    void (*func)(void *, unsigned long),
+		    pid_t *retpid)
+{
+	assert(fdt != NULL);
+	return thread_fork_common(name, fdt, 0, data1, data2, func, NULL, retpid);
+}
+
+int
+thread_fork_sibling(const char *name,
+		    void *data1, unsigned long data2,
+		    void (*func)(void *, unsigned long))
+{
+	return thread_fork_common(name, NULL, 1, data1, data2, func, NULL, NULL);
+}
+#endif
+
+/*
+ * Sleep table operations. Interrupts must be off.
+ */
+
+static
+int
+sleepq_hash(const void *addr)
+{
+	u_int32_t k = (u_int32_t)addr;
+
+	/* the low bits are mostly alignment */
+	return ((k >> 3) ^ (k >> 11)) & (SLEEP_NBUCKETS-1);
+}
+
+/*
+ * Find the head of ADDR's queue. If PREVP isn't NULL, also hand back
+ * the link that points to it, for unlinking.
+ */
+static
+struct thread *
+sleepq_find(const void *addr, struct thread ***prevp)
+{
+	struct thread **pp;
+
+	for (pp = &sleepers[sleepq_hash(addr)]; *pp != NULL;
+	     pp = &(*pp)->t_wchan) {
+		if ((*pp)->t_sleepaddr == addr) {
+			if (prevp != NULL) {
+				*prevp = pp;
+			}
+			return *pp;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Add T, which has its sleep address set, to the back of its queue.
+ */
+static
+void
+sleepq_add(struct thread *t)
+{
+	struct thread *head;
+
+	t->t_wqnext = NULL;
+	head = sleepq_find(t->t_sleepaddr, NULL);
+	if (head == NULL) {
+		int b = sleepq_hash(t->t_sleepaddr);
+		t->t_wqtail = t;
+		t->t_wchan = sleepers[b];
+		sleepers[b] = t;
+	}
+	else {
+		head->t_wqtail->t_wqnext = t;
+		head->t_wqtail = t;
+		t->t_wchan = NULL;
+	}
+}
+
+/*
+ * Remove sleepers on ADDR: all of them (returned chained through
+ * t_wqnext, in order) if ALL is set, otherwise just the first.
+ */
+static
+struct thread *
+sleepq_take(const void *addr, int all)
+{
+	struct thread **pp, *head, *next;
+
+	head = sleepq_find(addr, &pp);
+	if (head == NULL) {
+		return NULL;
+	}
+
+	next = head->t_wqnext;
+	if (all || next == NULL) {
+		*pp = head->t_wchan;
+	}
+	else {
+		/* the next one takes over as head */
+		next->t_wqtail = head->t_wqtail;
+		next->t_wchan = head->t_wchan;
+		*pp = next;
+		head->t_wqnext = NULL;
+	}
+	head->t_wchan = NULL;
+	head->t_wqtail = NULL;
+	return head;
+}
+
+/*
+ * Take T, which is asleep, out of its queue wherever it is in it.
+ * Returns zero if it isn't actually in the table (it has been woken
+ * but hasn't run yet).
+ */
+static
+int
+sleepq_remove(struct thread *t)
+{
+	struct thread *head, *prev;
+
+	head = sleepq_find(t->t_sleepaddr, NULL);
+	if (head == NULL) {
+		return 0;
+	}
+	if (head == t) {
+		sleepq_take(t->t_sleepaddr, 0);
+		return 1;
+	}
+	for (prev = head; prev->t_wqnext != NULL; prev = prev->t_wqnext) {
+		if (prev->t_wqnext == t) {
+			prev->t_wqnext = t->t_wqnext;
+			if (head->t_wqtail == t) {
+				head->t_wqtail = prev;
+			}
+			t->t_wqnext = NULL;
+			return 1;
+		}
+	}
+	return 0;
+}
+
 /*
  * High level, machine-independent context switch code.
  */
@@ -530,11 +905,9 @@ mi_switch(threadstate_t nextstate)
 		result = make_runnable(cur);
 	}
 	else if (nextstate==S_SLEEP) {
-		/*
-		 * Because we preallocate sleepers[] during thread_fork,
-		 * this should never fail.
-		 */
-		result = array_add(sleepers, cur);
+		/* The sleep table never needs memory, so can't fail. */
+		sleepq_add(cur);
+		result = 0;
 	}
 	else {
 		assert(nextstate==S_ZOMB);
@@ -553,6 +926,17 @@ mi_switch(threadstate_t nextstate)
         
 	/* update curthread */
 	curthread = next;
+
+#if OPT_A2
+	/* a zombie is done being accounted for */
+	if (next != cur && nextstate != S_ZOMB) {
+		proc_switched(cur->pid, nextstate==S_SLEEP);
+	}
+#endif
+
+	KTRACE(KTRACE_SCHED, KT_SWITCH, cur,
+	       nextstate==S_READY ? KT_STATE_READY :
+	       nextstate==S_SLEEP ? KT_STATE_SLEEP : KT_STATE_ZOMB);
 	
 	/* 
 	 * Call the machine-dependent code that actually does the
@@ -579,7 +963,9 @@ mi_switch(threadstate_t nextstate)
  *
  * We clean up the parts of the thread structure we don't actually
  * need to run right away. The rest has to wait until thread_destroy
- * gets called from exorcise().
+ * gets called, normally from the work queue once exorcise() has put
+ * it there. That includes the address space, which can take a while
+ * to tear down for a big process.
  */
 void
 thread_exit(void)
@@ -598,22 +984,13 @@ thread_exit(void)
 		assert(curthread->t_stack[3] == (char)0x33);
 	}
         #if OPT_A2
-        vfs_close(curthread->ft[0]->file);
-        vfs_close(curthread->ft[1]->file);
-        vfs_close(curthread->ft[2]->file);
+        if (curthread->fdt != NULL) {
+           fdtable_destroy(curthread->fdt);
+           curthread->fdt = NULL;
+        }
         #endif
 	splhigh();
 
-	if (curthread->t_vmspace) {
-		/*
-		 * Do this carefully to avoid race condition with
-		 * context switch code.
-		 */
-		struct addrspace *as = curthread->t_vmspace;
-		curthread->t_vmspace = NULL;
-		as_destroy(as);
-	}
-
 	if (curthread->t_cwd) {
 		VOP_DECREF(curthread->t_cwd);
 		curthread->t_cwd = NULL;
@@ -622,14 +999,6 @@ thread_exit(void)
 	assert(numthreads>0);
 
 	numthreads--;
-       /* #if OPT_A2
-        struct process* current = p_table[curthread->pid];
-        if (current->ppid != -1){
-           struct process* parent = p_table[current->ppid];
-           if (parent->waiting) cv_broadcast(parent->exit,parent->exitlock);
-        }         
-        #endif
-        */
 	mi_switch(S_ZOMB);
 
 	panic("Thread came back from the dead!\n");
@@ -644,7 +1013,7 @@ thread_yield(void)
 	int spl = splhigh();
 
 	/* Check sleepers just in case we get here after shutdown */
-	assert(sleepers != NULL);
+	assert(sleepers_ready);
 
 	mi_switch(S_READY);
 	splx(spl);
@@ -679,64 +1048,101 @@ thread_sleep(const void *addr)
 void
 thread_wakeup(const void *addr)
 {
-	int i, result;
+	struct thread *t, *next;
+	int result;
 	
 	// meant to be called with interrupts off
 	assert(curspl>0);
-	
-	// This is inefficient. Feel free to improve it.
-	
-	for (i=0; i<array_getnum(sleepers); i++) {
-		struct thread *t = array_getguy(sleepers, i);
-		if (t->t_sleepaddr == addr) {
-			
-			// Remove from list
-			array_remove(sleepers, i);
-			
-			// must look at the same sleepers[i] again
-			i--;
-
-			/*
-			 * Because we preallocate during thread_fork,
-			 * this should never fail.
-			 */
-			result = make_runnable(t);
-			assert(result==0);
-		}
+
+	t = sleepq_take(addr, 1);
+	while (t != NULL) {
+		next = t->t_wqnext;
+		t->t_wqnext = NULL;
+
+		/*
+		 * Because we preallocate during thread_fork,
+		 * this should never fail.
+		 */
+		result = make_runnable(t);
+		assert(result==0);
+		t = next;
 	}
 }
 
 /*
- * Return nonzero if there are any threads who are sleeping on "sleep address"
- * ADDR. This is meant to be used only for diagnostic purposes.
+ * Wake up the thread that has been sleeping longest on "sleep
+ * address" ADDR, if any. Returns nonzero if there was one.
  */
 int
-thread_hassleepers(const void *addr)
+thread_wakeone(const void *addr)
 {
-	int i;
-	
+	struct thread *t;
+	int result;
+
 	// meant to be called with interrupts off
 	assert(curspl>0);
-	
-	for (i=0; i<array_getnum(sleepers); i++) {
-		struct thread *t = array_getguy(sleepers, i);
-		if (t->t_sleepaddr == addr) {
-			return 1;
-		}
+
+	t = sleepq_take(addr, 0);
+	if (t == NULL) {
+		return 0;
 	}
+
+	/*
+	 * Because we preallocate during thread_fork,
+	 * this should never fail.
+	 */
+	result = make_runnable(t);
+	assert(result==0);
+	return 1;
+}
+
+/*
+ * Wake thread T if it is asleep, whatever it is sleeping on.
+ */
+void
+thread_interrupt(struct thread *t)
+{
+	int result;
+
+	// meant to be called with interrupts off
+	assert(curspl>0);
+
+	if (t == curthread || t->t_sleepaddr == NULL) {
+		return;
+	}
+	if (sleepq_remove(t)) {
+		/*
+		 * Because we preallocate during thread_fork,
+		 * this should never fail.
+		 */
+		result = make_runnable(t);
+		assert(result==0);
+	}
+}
+
+int
+thread_interrupted(void)
+{
+#if OPT_A2
+	return curthread->exiting;
+#else
 	return 0;
+#endif
 }
 
+/*
+ * Return nonzero if there are any threads who are sleeping on "sleep address"
+ * ADDR. This is meant to be used only for diagnostic purposes.
+ */
+int
+thread_hassleepers(const void *addr)
+{
+	// meant to be called with interrupts off
+	assert(curspl>0);
 
-pid_t get_pid(void){
-   int i;
-   for (i = 1; i < MAX_PROG + 1; ++i){
-      if (p_table[i] == NULL) {
-          return i;
-      }
-   }
-   return -1;
+	return sleepq_find(addr, NULL) != NULL;
 }
+
 /*
  * New threads actually come through here on the way to the function
  * they're supposed to start in. This is so when that function exits,
@@ -766,11 +1172,6 @@ mi_threadstart(void *data1, unsigned long data2,
 		}
 	}
 #endif
-	#if OPT_A2
-        int result = conSetup(curthread); // stdin , stdout, stderr
-        if(result) panic("Out of Memory\n");
-
-        #endif
 	/* Call the function */
 	func(data1, data2);
 
@@ -0,0 +1,168 @@
+/*
+ * Hashed timer wheel. See timer.h.
+ *
+ * Slot i holds every timeout due on a tick congruent to i mod
+ * TIMER_NSLOTS, so arming and disarming are constant time, and each
+ * tick only looks at one slot. Timeouts more than TIMER_NSLOTS ticks
+ * away sit in their slot until the wheel comes round to the right
+ * tick.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <machine/spl.h>
+#include <thread.h>
+#include <timer.h>
+
+static struct timeout *wheel[TIMER_NSLOTS];
+static u_int32_t ticks;
+
+void
+timeout_init(struct timeout *to, void (*func)(void *), void *arg)
+{
+	to->to_func = func;
+	to->to_arg = arg;
+	to->to_expire = 0;
+	to->to_pending = 0;
+	to->to_next = to->to_prev = NULL;
+}
+
+void
+timeout_add(struct timeout *to, u_int32_t nticks)
+{
+	struct timeout **slot;
+	int s;
+
+	if (nticks == 0) {
+		nticks = 1;
+	}
+
+	s = splhigh();
+	assert(!to->to_pending);
+
+	to->to_expire = ticks + nticks;
+	to->to_pending = 1;
+
+	slot = &wheel[to->to_expire & (TIMER_NSLOTS-1)];
+	to->to_prev = NULL;
+	to->to_next = *slot;
+	if (*slot != NULL) {
+		(*slot)->to_prev = to;
+	}
+	*slot = to;
+	splx(s);
+}
+
+/*
+ * Take TO out of its slot. Interrupts must be off.
+ */
+static
+void
+timeout_unlink(struct timeout *to)
+{
+	assert(curspl>0);
+
+	if (to->to_prev != NULL) {
+		to->to_prev->to_next = to->to_next;
+	}
+	else {
+		wheel[to->to_expire & (TIMER_NSLOTS-1)] = to->to_next;
+	}
+	if (to->to_next != NULL) {
+		to->to_next->to_prev = to->to_prev;
+	}
+	to->to_next = to->to_prev = NULL;
+	to->to_pending = 0;
+}
+
+int
+timeout_del(struct timeout *to)
+{
+	int s, was;
+
+	s = splhigh();
+	was = to->to_pending;
+	if (was) {
+		timeout_unlink(to);
+	}
+	splx(s);
+	return was;
+}
+
+void
+timer_tick(void)
+{
+	struct timeout *to, *next;
+
+	assert(curspl>0);
+
+	ticks++;
+	for (to = wheel[ticks & (TIMER_NSLOTS-1)]; to != NULL; to = next) {
+		next = to->to_next;
+		if (to->to_expire != ticks) {
+			/* a later lap */
+			continue;
+		}
+		timeout_unlink(to);
+		/* it may re-arm itself, but can't be due again this tick */
+		to->to_func(to->to_arg);
+	}
+}
+
+u_int32_t
+timer_ticks(void)
+{
+	return ticks;
+}
+
+u_int32_t
+timer_next(u_int32_t max)
+{
+	struct timeout *to;
+	u_int32_t next = max;
+	int i;
+
+	assert(curspl>0);
+
+	for (i=0; i<TIMER_NSLOTS; i++) {
+		for (to = wheel[i]; to != NULL; to = to->to_next) {
+			if (to->to_expire - ticks < next) {
+				next = to->to_expire - ticks;
+			}
+		}
+	}
+	return next;
+}
+
+/*
+ * Timeout function for timer_sleep: wake whoever sleeps on the
+ * timeout itself.
+ */
+static
+void
+timer_wakeup(void *addr)
+{
+	thread_wakeup(addr);
+}
+
+int
+timer_sleep(u_int32_t nticks)
+{
+	struct timeout to;
+	int s, result = 0;
+
+	timeout_init(&to, timer_wakeup, &to);
+
+	s = splhigh();
+	timeout_add(&to, nticks);
+	while (to.to_pending) {
+		if (thread_interrupted()) {
+			timeout_del(&to);
+			result = EINTR;
+			break;
+		}
+		thread_sleep(&to);
+	}
+	splx(s);
+	return result;
+}
@@ -0,0 +1,212 @@
+/*
+ * Deferred work queue. See workq.h.
+ *
+ * The queue is a singly linked FIFO through the work items
+ * themselves, protected by turning interrupts off, so it can be added
+ * to from anywhere. Workers sleep on workq_head while it is empty.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <machine/spl.h>
+#include <thread.h>
+#include <timer.h>
+#include <workq.h>
+
+static struct work *workq_head, *workq_tail;
+static int workq_nworkers;       /* workers running */
+static int workq_stopping;       /* shutting down; workers leave when idle */
+
+/* Statistics */
+static int workq_depth;
+static int workq_maxdepth;
+static u_int32_t workq_nqueued;
+static u_int32_t workq_ndone;
+static u_int32_t workq_nrefused;
+static u_int32_t workq_waitticks;  /* total ticks spent queued */
+static u_int32_t workq_maxwait;
+
+void
+work_init(struct work *w, void (*func)(void *), void *arg)
+{
+	w->w_func = func;
+	w->w_arg = arg;
+	w->w_queued = 0;
+	w->w_next = NULL;
+}
+
+int
+workq_add(struct work *w)
+{
+	int s;
+
+	s = splhigh();
+	if (workq_stopping && workq_nworkers == 0) {
+		workq_nrefused++;
+		splx(s);
+		return ENXIO;
+	}
+
+	w->w_queued = timer_ticks();
+	w->w_next = NULL;
+	if (workq_tail != NULL) {
+		workq_tail->w_next = w;
+	}
+	else {
+		workq_head = w;
+	}
+	workq_tail = w;
+
+	workq_nqueued++;
+	workq_depth++;
+	if (workq_depth > workq_maxdepth) {
+		workq_maxdepth = workq_depth;
+	}
+
+	/* one worker is enough */
+	thread_wakeone(&workq_head);
+	splx(s);
+
+	return 0;
+}
+
+/*
+ * Take the next item off the queue, or NULL if it's empty. Interrupts
+ * must be off.
+ */
+static
+struct work *
+workq_take(void)
+{
+	struct work *w;
+	u_int32_t wait;
+
+	assert(curspl>0);
+
+	w = workq_head;
+	if (w == NULL) {
+		return NULL;
+	}
+	workq_head = w->w_next;
+	if (workq_head == NULL) {
+		workq_tail = NULL;
+	}
+	w->w_next = NULL;
+	workq_depth--;
+
+	wait = timer_ticks() - w->w_queued;
+	workq_waitticks += wait;
+	if (wait > workq_maxwait) {
+		workq_maxwait = wait;
+	}
+	return w;
+}
+
+/*
+ * Run W. It may be requeued or freed as soon as its function starts,
+ * so don't touch it afterwards.
+ */
+static
+void
+workq_run(struct work *w)
+{
+	void (*func)(void *) = w->w_func;
+	void *arg = w->w_arg;
+	int s;
+
+	func(arg);
+
+	s = splhigh();
+	workq_ndone++;
+	splx(s);
+}
+
+static
+void
+workq_worker(void *unused1, unsigned long unused2)
+{
+	struct work *w;
+	int s;
+
+	(void)unused1;
+	(void)unused2;
+
+	s = splhigh();
+	while (1) {
+		w = workq_take();
+		if (w == NULL) {
+			if (workq_stopping) {
+				break;
+			}
+			thread_sleep(&workq_head);
+			continue;
+		}
+		splx(s);
+
+		workq_run(w);
+
+		s = splhigh();
+	}
+
+	workq_nworkers--;
+	thread_wakeup(&workq_nworkers);
+	splx(s);
+
+	thread_exit();
+}
+
+void
+workq_bootstrap(void)
+{
+	int i, result;
+
+	for (i=0; i<WORKQ_NWORKERS; i++) {
+		result = thread_fork("workq", NULL, 0, workq_worker, NULL);
+		if (result) {
+			panic("workq_bootstrap: thread_fork: %s\n",
+			      strerror(result));
+		}
+		workq_nworkers++;
+	}
+}
+
+void
+workq_shutdown(void)
+{
+	struct work *w;
+	int s;
+
+	s = splhigh();
+	workq_stopping = 1;
+	thread_wakeup(&workq_head);
+	while (workq_nworkers > 0) {
+		thread_sleep(&workq_nworkers);
+	}
+
+	/* whatever came in as the last workers left */
+	while ((w = workq_take()) != NULL) {
+		splx(s);
+		workq_run(w);
+		s = splhigh();
+	}
+	splx(s);
+}
+
+void
+workq_printstats(void)
+{
+	int s;
+
+	s = splhigh();
+	kprintf("workq: %d workers, %d queued now (at most %d)\n",
+		workq_nworkers, workq_depth, workq_maxdepth);
+	kprintf("workq: %lu queued, %lu done, %lu refused after shutdown\n",
+		(unsigned long) workq_nqueued, (unsigned long) workq_ndone,
+		(unsigned long) workq_nrefused);
+	kprintf("workq: waited %lu ticks on average, %lu at most\n",
+		(unsigned long) (workq_nqueued > (u_int32_t) workq_depth ?
+				 workq_waitticks /
+				 (workq_nqueued - workq_depth) : 0),
+		(unsigned long) workq_maxwait);
+	splx(s);
+}
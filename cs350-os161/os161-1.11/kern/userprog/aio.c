@@ -0,0 +1,566 @@
+/*
+ * Asynchronous I/O, serviced by a pool of kernel worker threads.
+ * See aio.h and kern/aio.h.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/unistd.h>
+#include <kern/aio.h>
+#include <lib.h>
+#include <array.h>
+#include <queue.h>
+#include <synch.h>
+#include <clock.h>
+#include <thread.h>
+#include <curthread.h>
+#include <vnode.h>
+#include <uio.h>
+#include <filetable.h>
+#include <pipe.h>
+#include <syscall.h>
+#include <aio.h>
+
+/* Global file lock, from system_call.c */
+extern struct semaphore *file;
+
+#define AR_QUEUED  0     /* waiting for a worker */
+#define AR_BUSY    1     /* a worker is doing it */
+#define AR_DONE    2     /* finished, waiting to be collected */
+
+struct aioreq {
+	int ar_id;
+	pid_t ar_pid;          /* owner, or -1 once it has exited */
+	int ar_op;             /* AIO_READ or AIO_WRITE */
+	int ar_state;          /* AR_* */
+	struct vnode *ar_vn;   /* referenced until the request is freed */
+	void *ar_kbuf;
+	void *ar_ubuf;
+	size_t ar_len;
+	off_t ar_offset;
+	int ar_result;         /* bytes transferred, or -1 */
+	int ar_err;            /* errno if ar_result is -1 */
+	time_t ar_secs;        /* when submitted */
+	u_int32_t ar_nsecs;
+};
+
+/*
+ * aio_lock protects everything below. Workers sleep on aio_work;
+ * aio_wait callers, and aio_shutdown, sleep on aio_done.
+ */
+static struct lock *aio_lock;
+static struct cv *aio_work;
+static struct cv *aio_done;
+
+static struct array *aio_reqs;    /* every live request */
+static struct queue *aio_queue;   /* requests waiting for a worker */
+static int aio_nreqs;
+static int aio_nextid = 1;
+static int aio_nworkers;          /* workers running */
+static int aio_target = AIO_DEFWORKERS;
+
+/* Statistics */
+static u_int32_t aio_submitted;
+static u_int32_t aio_completed;
+static u_int32_t aio_failed;
+static u_int32_t aio_discarded;
+static int aio_depth;              /* current queue depth */
+static int aio_maxdepth;
+static u_int32_t aio_lat_secs;     /* total submit-to-completion time */
+static u_int32_t aio_lat_usecs;
+static u_int32_t aio_lat_max;      /* in microseconds */
+
+void
+aio_bootstrap(void)
+{
+	aio_lock = lock_create("aio");
+	aio_work = cv_create("aio work");
+	aio_done = cv_create("aio done");
+	aio_reqs = array_create();
+	/* the queue never holds more than AIO_MAXREQS, so never grows */
+	aio_queue = q_create(AIO_MAXREQS+1);
+	if (aio_lock == NULL || aio_work == NULL || aio_done == NULL ||
+	    aio_reqs == NULL || aio_queue == NULL) {
+		panic("aio_bootstrap: Out of memory\n");
+	}
+}
+
+/*
+ * Unlink and free REQ. aio_lock must be held.
+ */
+static
+void
+aio_free(struct aioreq *req)
+{
+	int i;
+
+	for (i=0; i<array_getnum(aio_reqs); i++) {
+		if (array_getguy(aio_reqs, i) == req) {
+			array_remove(aio_reqs, i);
+			break;
+		}
+	}
+	aio_nreqs--;
+	if (aio_nreqs == 0) {
+		/* let idle workers go */
+		cv_broadcast(aio_work, aio_lock);
+	}
+
+	VOP_DECREF(req->ar_vn);
+	kfree(req->ar_kbuf);
+	kfree(req);
+}
+
+/*
+ * Find request ID belonging to PID. aio_lock must be held.
+ */
+static
+struct aioreq *
+aio_find(pid_t pid, int id)
+{
+	struct aioreq *req;
+	int i;
+
+	for (i=0; i<array_getnum(aio_reqs); i++) {
+		req = array_getguy(aio_reqs, i);
+		if (req->ar_pid == pid && req->ar_id == id) {
+			return req;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Do the transfer for REQ. Called by a worker without aio_lock.
+ */
+static
+void
+aio_doio(struct aioreq *req)
+{
+	struct uio u;
+	int ispipe, result;
+
+	mk_kuio(&u, req->ar_kbuf, req->ar_len, req->ar_offset,
+		req->ar_op == AIO_READ ? UIO_READ : UIO_WRITE);
+
+	/* same rule as sys_read/sys_write: pipes may block */
+	ispipe = pipe_isvnode(req->ar_vn);
+	if (file == NULL) file = sem_create("file",1);
+	if (!ispipe) P(file);
+	if (req->ar_op == AIO_READ) {
+		result = VOP_READ(req->ar_vn, &u);
+	}
+	else {
+		result = VOP_WRITE(req->ar_vn, &u);
+	}
+	if (!ispipe) V(file);
+
+	if (result) {
+		req->ar_result = -1;
+		req->ar_err = result;
+	}
+	else {
+		req->ar_result = req->ar_len - u.uio_resid;
+		req->ar_err = 0;
+	}
+}
+
+/*
+ * Account for the latency of REQ, which just finished. aio_lock
+ * must be held.
+ */
+static
+void
+aio_account(struct aioreq *req)
+{
+	time_t secs, dsecs;
+	u_int32_t nsecs, dnsecs, usecs;
+
+	gettime(&secs, &nsecs);
+	getinterval(req->ar_secs, req->ar_nsecs, secs, nsecs,
+		    &dsecs, &dnsecs);
+
+	aio_lat_secs += dsecs;
+	aio_lat_usecs += dnsecs / 1000;
+	if (aio_lat_usecs >= 1000000) {
+		aio_lat_secs++;
+		aio_lat_usecs -= 1000000;
+	}
+
+	/* cap so the max stays meaningful in 32 bits */
+	usecs = dsecs >= 4000 ? 0xffffffff : dsecs*1000000 + dnsecs/1000;
+	if (usecs > aio_lat_max) {
+		aio_lat_max = usecs;
+	}
+
+	aio_completed++;
+	if (req->ar_result < 0) {
+		aio_failed++;
+	}
+}
+
+static
+void
+aio_worker(void *unused1, unsigned long unused2)
+{
+	struct aioreq *req;
+
+	(void)unused1;
+	(void)unused2;
+
+	lock_acquire(aio_lock);
+	while (1) {
+		while (q_empty(aio_queue) && aio_nworkers <= aio_target &&
+		       aio_nreqs > 0) {
+			cv_wait(aio_work, aio_lock);
+		}
+		if (aio_nworkers > aio_target) {
+			/* pool shrank; let the others carry on */
+			break;
+		}
+		if (q_empty(aio_queue)) {
+			/* nothing outstanding; the next submit restarts us */
+			break;
+		}
+
+		req = q_remhead(aio_queue);
+		aio_depth--;
+		if (req->ar_pid < 0) {
+			/* owner exited before we got to it */
+			aio_discarded++;
+			aio_free(req);
+			continue;
+		}
+		req->ar_state = AR_BUSY;
+		lock_release(aio_lock);
+
+		aio_doio(req);
+
+		lock_acquire(aio_lock);
+		req->ar_state = AR_DONE;
+		aio_account(req);
+		if (req->ar_pid < 0) {
+			aio_discarded++;
+			aio_free(req);
+		}
+		else {
+			cv_broadcast(aio_done, aio_lock);
+		}
+	}
+
+	aio_nworkers--;
+	cv_broadcast(aio_done, aio_lock);
+	lock_release(aio_lock);
+	thread_exit();
+}
+
+/*
+ * Bring the pool up to aio_target workers. Returns an error only if
+ * there are no workers at all afterwards.
+ */
+static
+int
+aio_startworkers(void)
+{
+	int result = 0;
+
+	lock_acquire(aio_lock);
+	while (aio_nworkers < aio_target) {
+		aio_nworkers++;
+		lock_release(aio_lock);
+		result = thread_fork("aio worker", NULL, 0, aio_worker, NULL);
+		lock_acquire(aio_lock);
+		if (result) {
+			aio_nworkers--;
+			break;
+		}
+	}
+	if (aio_nworkers > 0) {
+		result = 0;
+	}
+	lock_release(aio_lock);
+
+	return result;
+}
+
+int
+sys_aio_submit(const struct aiocb *ucb, int *err)
+{
+	struct aiocb cb;
+	struct filetable *ft;
+	struct vnode *vn;
+	struct aioreq *req;
+	int result, id;
+
+	result = copyin((const_userptr_t)ucb, &cb, sizeof(cb));
+	if (result) {
+		*err = result;
+		return -1;
+	}
+
+	// validate parameter
+	if ((cb.aio_op != AIO_READ && cb.aio_op != AIO_WRITE) ||
+	    cb.aio_nbytes > AIO_MAXBYTES || cb.aio_offset < 0) {
+		*err = EINVAL;
+		return -1;
+	}
+	ft = fdtable_get(curthread->fdt, cb.aio_fd);
+	if (ft == NULL) {
+		*err = EBADF;
+		return -1;
+	}
+	if ((cb.aio_op == AIO_READ && ft->mode == O_WRONLY) ||
+	    (cb.aio_op == AIO_WRITE && ft->mode == O_RDONLY)) {
+		release_ft(ft);
+		*err = EBADF;
+		return -1;
+	}
+	if (cb.aio_buf == NULL) {
+		release_ft(ft);
+		*err = EFAULT;
+		return -1;
+	}
+	/* the request holds the vnode itself, since the fd may be closed */
+	vn = ft->file;
+	VOP_INCREF(vn);
+	release_ft(ft);
+
+	req = kmalloc(sizeof(struct aioreq));
+	if (req == NULL) {
+		VOP_DECREF(vn);
+		*err = ENOMEM;
+		return -1;
+	}
+	req->ar_kbuf = kmalloc(cb.aio_nbytes+1);
+	if (req->ar_kbuf == NULL) {
+		kfree(req);
+		VOP_DECREF(vn);
+		*err = ENOMEM;
+		return -1;
+	}
+
+	/*
+	 * For a write this takes the data now; for a read it just
+	 * makes sure the buffer is there, so a bad pointer is
+	 * reported here rather than at aio_wait.
+	 */
+	result = copyin((const_userptr_t)cb.aio_buf, req->ar_kbuf,
+			cb.aio_nbytes);
+	if (result) {
+		kfree(req->ar_kbuf);
+		kfree(req);
+		VOP_DECREF(vn);
+		*err = result;
+		return -1;
+	}
+
+	req->ar_pid = curthread->pid;
+	req->ar_op = cb.aio_op;
+	req->ar_state = AR_QUEUED;
+	req->ar_vn = vn;
+	req->ar_ubuf = cb.aio_buf;
+	req->ar_len = cb.aio_nbytes;
+	req->ar_offset = cb.aio_offset;
+	req->ar_result = 0;
+	req->ar_err = 0;
+	gettime(&req->ar_secs, &req->ar_nsecs);
+
+	lock_acquire(aio_lock);
+	if (aio_nreqs >= AIO_MAXREQS) {
+		result = EAGAIN;
+	}
+	else {
+		result = array_add(aio_reqs, req);
+	}
+	if (result) {
+		lock_release(aio_lock);
+		VOP_DECREF(req->ar_vn);
+		kfree(req->ar_kbuf);
+		kfree(req);
+		*err = result;
+		return -1;
+	}
+
+	id = req->ar_id = aio_nextid++;
+	if (aio_nextid <= 0) {
+		aio_nextid = 1;
+	}
+	aio_nreqs++;
+	result = q_addtail(aio_queue, req);
+	assert(result == 0);
+
+	aio_submitted++;
+	aio_depth++;
+	if (aio_depth > aio_maxdepth) {
+		aio_maxdepth = aio_depth;
+	}
+	cv_broadcast(aio_work, aio_lock);
+	lock_release(aio_lock);
+
+	/*
+	 * Workers leave when nothing is outstanding, so start them
+	 * only now that this request is queued. If none can be
+	 * started, disown it; whoever next dequeues it, or
+	 * aio_shutdown, throws it away.
+	 */
+	result = aio_startworkers();
+	if (result) {
+		lock_acquire(aio_lock);
+		req->ar_pid = -1;
+		lock_release(aio_lock);
+		*err = result;
+		return -1;
+	}
+
+	return id;
+}
+
+int
+sys_aio_wait(int id, int flags, int *err)
+{
+	struct aioreq *req;
+	int result;
+
+	lock_acquire(aio_lock);
+	req = aio_find(curthread->pid, id);
+	if (req == NULL) {
+		lock_release(aio_lock);
+		*err = EINVAL;
+		return -1;
+	}
+	while (req->ar_state != AR_DONE) {
+		if (flags & AIO_NOWAIT) {
+			lock_release(aio_lock);
+			*err = EAGAIN;
+			return -1;
+		}
+		/* left on the list; aio_cleanup gets it if we're exiting */
+		result = cv_wait_intr(aio_done, aio_lock);
+		if (result) {
+			lock_release(aio_lock);
+			*err = result;
+			return -1;
+		}
+	}
+
+	/* take it off the list now; nobody else can see it */
+	req->ar_pid = -1;
+	lock_release(aio_lock);
+
+	result = req->ar_result;
+	if (result < 0) {
+		*err = req->ar_err;
+	}
+	else if (req->ar_op == AIO_READ && result > 0) {
+		*err = copyout(req->ar_kbuf, (userptr_t)req->ar_ubuf, result);
+		if (*err) {
+			result = -1;
+		}
+	}
+
+	lock_acquire(aio_lock);
+	aio_free(req);
+	lock_release(aio_lock);
+
+	return result;
+}
+
+void
+aio_cleanup(pid_t pid)
+{
+	struct aioreq *req;
+	int i;
+
+	if (aio_lock == NULL) {
+		return;
+	}
+
+	lock_acquire(aio_lock);
+	i = 0;
+	while (i < array_getnum(aio_reqs)) {
+		req = array_getguy(aio_reqs, i);
+		if (req->ar_pid != pid) {
+			i++;
+		}
+		else if (req->ar_state == AR_DONE) {
+			/* aio_free removes slot i */
+			aio_discarded++;
+			aio_free(req);
+		}
+		else {
+			/* the worker frees it when it gets there */
+			req->ar_pid = -1;
+			i++;
+		}
+	}
+	lock_release(aio_lock);
+}
+
+int
+aio_setworkers(int n)
+{
+	if (n < 1 || n > AIO_MAXWORKERS) {
+		return EINVAL;
+	}
+
+	lock_acquire(aio_lock);
+	aio_target = n;
+	/* extra workers notice and exit; new ones start on next submit */
+	cv_broadcast(aio_work, aio_lock);
+	lock_release(aio_lock);
+	return 0;
+}
+
+int
+aio_getworkers(void)
+{
+	return aio_target;
+}
+
+void
+aio_shutdown(void)
+{
+	struct aioreq *req;
+
+	lock_acquire(aio_lock);
+	aio_target = 0;
+	cv_broadcast(aio_work, aio_lock);
+	while (aio_nworkers > 0) {
+		cv_wait(aio_done, aio_lock);
+	}
+
+	/* whatever is left belongs to processes that are gone */
+	while (!q_empty(aio_queue)) {
+		req = q_remhead(aio_queue);
+		aio_depth--;
+		aio_free(req);
+	}
+	lock_release(aio_lock);
+}
+
+void
+aio_printstats(void)
+{
+	u_int32_t avg = 0;
+
+	lock_acquire(aio_lock);
+	if (aio_completed > 0) {
+		/* average in microseconds, without 64-bit arithmetic */
+		if (aio_lat_secs < 4000) {
+			avg = (aio_lat_secs*1000000 + aio_lat_usecs)
+				/ aio_completed;
+		}
+		else {
+			avg = (aio_lat_secs / aio_completed) * 1000000;
+		}
+	}
+	kprintf("aio: %d/%d workers, %d requests outstanding\n",
+		aio_nworkers, aio_target, aio_nreqs);
+	kprintf("aio: %lu submitted, %lu completed, %lu failed, "
+		"%lu discarded\n",
+		(unsigned long) aio_submitted, (unsigned long) aio_completed,
+		(unsigned long) aio_failed, (unsigned long) aio_discarded);
+	kprintf("aio: queue depth %d (max %d)\n", aio_depth, aio_maxdepth);
+	kprintf("aio: latency avg %lu us, max %lu us\n",
+		(unsigned long) avg, (unsigned long) aio_lat_max);
+	lock_release(aio_lock);
+}
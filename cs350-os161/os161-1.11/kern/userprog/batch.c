@@ -0,0 +1,136 @@
+/*
+ * Batched system calls: run a process's queued operations in one
+ * trap. See kern/batch.h for the ring layout.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/batch.h>
+#include <lib.h>
+#include <thread.h>
+#include <curthread.h>
+#include <syscall.h>
+
+/*
+ * Run one submission and return its result, or -errno.
+ */
+static
+int
+batch_run(const struct batch_sqe *sqe)
+{
+	int err = 0;
+	int ret;
+
+	switch (sqe->bs_op) {
+	    case BATCH_READ:
+		ret = sys_read(sqe->bs_fd, sqe->bs_buf, sqe->bs_len, &err);
+		break;
+	    case BATCH_WRITE:
+		ret = sys_write(sqe->bs_fd, sqe->bs_buf, sqe->bs_len, &err);
+		break;
+	    case BATCH_OPEN:
+		ret = sys_open(sqe->bs_buf, sqe->bs_arg, &err);
+		break;
+	    case BATCH_CLOSE:
+		ret = sys_close(sqe->bs_fd, &err);
+		break;
+	    case BATCH_LSEEK:
+		ret = sys_lseek(sqe->bs_fd, sqe->bs_arg, sqe->bs_len, &err);
+		break;
+	    default:
+		ret = -1;
+		err = ENOSYS;
+		break;
+	}
+
+	return err ? -err : ret;
+}
+
+int
+sys___batch_register(struct batch_ring *ring, int *err)
+{
+	unsigned hdr[4];
+	int result;
+
+	/* NULL unregisters */
+	if (ring != NULL) {
+		/* Make sure we can at least get at the counters */
+		result = copyin((const_userptr_t)ring, hdr, sizeof(hdr));
+		if (result) {
+			*err = result;
+			return -1;
+		}
+	}
+
+	curthread->batch = ring;
+	return 0;
+}
+
+int
+sys___batch_submit(int *err)
+{
+	struct batch_ring *ring = curthread->batch;
+	struct batch_sqe sqe;
+	struct batch_cqe cqe;
+	unsigned sqhead, sqtail, cqhead, cqtail;
+	int result, count = 0;
+
+	if (ring == NULL) {
+		*err = EINVAL;
+		return -1;
+	}
+
+	result = copyin((const_userptr_t)&ring->br_sqhead, &sqhead,
+			sizeof(unsigned));
+	if (!result) result = copyin((const_userptr_t)&ring->br_sqtail,
+				     &sqtail, sizeof(unsigned));
+	if (!result) result = copyin((const_userptr_t)&ring->br_cqhead,
+				     &cqhead, sizeof(unsigned));
+	if (!result) result = copyin((const_userptr_t)&ring->br_cqtail,
+				     &cqtail, sizeof(unsigned));
+	if (result) {
+		*err = result;
+		return -1;
+	}
+
+	if (sqtail - sqhead > BATCH_RING_SIZE ||
+	    cqtail - cqhead > BATCH_RING_SIZE) {
+		*err = EINVAL;
+		return -1;
+	}
+
+	while (sqhead != sqtail && cqtail - cqhead < BATCH_RING_SIZE) {
+		result = copyin((const_userptr_t)
+				&ring->br_sq[sqhead % BATCH_RING_SIZE],
+				&sqe, sizeof(sqe));
+		if (result) {
+			break;
+		}
+
+		cqe.bc_cookie = sqe.bs_cookie;
+		cqe.bc_result = batch_run(&sqe);
+
+		result = copyout(&cqe, (userptr_t)
+				 &ring->br_cq[cqtail % BATCH_RING_SIZE],
+				 sizeof(cqe));
+		if (result) {
+			break;
+		}
+		sqhead++;
+		cqtail++;
+		count++;
+	}
+
+	/*
+	 * Publish how far we got even if we stopped on a fault, so
+	 * the operations that did run aren't run again.
+	 */
+	if (copyout(&sqhead, (userptr_t)&ring->br_sqhead, sizeof(unsigned)) ||
+	    copyout(&cqtail, (userptr_t)&ring->br_cqtail, sizeof(unsigned))) {
+		result = EFAULT;
+	}
+	if (result && count == 0) {
+		*err = result;
+		return -1;
+	}
+	return count;
+}
@@ -0,0 +1,178 @@
+/*
+ * Cache of parsed ELF executables. See elfcache.h.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <machine/spl.h>
+#include <vnode.h>
+#include <elfcache.h>
+
+struct elfcache_entry {
+	struct vnode *ec_vnode;        /* NULL if slot is unused */
+	u_int32_t ec_lastuse;          /* for picking a victim */
+	struct elf_image ec_image;
+};
+
+static struct elfcache_entry elfcache[ELFCACHE_SIZE];
+static u_int32_t elfcache_clock;
+static int elfcache_on = 1;
+
+/* Statistics */
+static u_int32_t elfcache_hits;
+static u_int32_t elfcache_misses;
+static u_int32_t elfcache_invalidations;
+static u_int32_t elfcache_evictions;
+
+/*
+ * Find the slot for V. Interrupts must be off.
+ */
+static
+struct elfcache_entry *
+elfcache_find(struct vnode *v)
+{
+	int i;
+
+	assert(curspl>0);
+	for (i=0; i<ELFCACHE_SIZE; i++) {
+		if (elfcache[i].ec_vnode == v) {
+			return &elfcache[i];
+		}
+	}
+	return NULL;
+}
+
+int
+elfcache_lookup(struct vnode *v, struct elf_image *img)
+{
+	struct elfcache_entry *ec;
+	int s;
+
+	s = splhigh();
+	ec = elfcache_on ? elfcache_find(v) : NULL;
+	if (ec == NULL) {
+		elfcache_misses++;
+		splx(s);
+		return ENOENT;
+	}
+	ec->ec_lastuse = ++elfcache_clock;
+	*img = ec->ec_image;
+	elfcache_hits++;
+	splx(s);
+
+	return 0;
+}
+
+void
+elfcache_insert(struct vnode *v, const struct elf_image *img)
+{
+	struct elfcache_entry *ec;
+	struct vnode *victim = NULL;
+	int i, s;
+
+	/*
+	 * Take the cache's reference up front: VOP_INCREF can sleep,
+	 * which would break the splhigh critical section below.
+	 */
+	VOP_INCREF(v);
+
+	s = splhigh();
+	if (!elfcache_on || elfcache_find(v) != NULL) {
+		/* Disabled, or someone else beat us to it. */
+		splx(s);
+		VOP_DECREF(v);
+		return;
+	}
+
+	/* Take a free slot, or else the least recently used one. */
+	ec = &elfcache[0];
+	for (i=0; i<ELFCACHE_SIZE; i++) {
+		if (elfcache[i].ec_vnode == NULL) {
+			ec = &elfcache[i];
+			break;
+		}
+		if (elfcache[i].ec_lastuse < ec->ec_lastuse) {
+			ec = &elfcache[i];
+		}
+	}
+	if (ec->ec_vnode != NULL) {
+		victim = ec->ec_vnode;
+		elfcache_evictions++;
+	}
+
+	ec->ec_vnode = v;
+	ec->ec_lastuse = ++elfcache_clock;
+	ec->ec_image = *img;
+	splx(s);
+
+	/* Dropping the last reference can do I/O; not at splhigh. */
+	if (victim != NULL) {
+		VOP_DECREF(victim);
+	}
+}
+
+void
+elfcache_invalidate(struct vnode *v)
+{
+	struct elfcache_entry *ec;
+	int s;
+
+	s = splhigh();
+	ec = elfcache_find(v);
+	if (ec == NULL) {
+		splx(s);
+		return;
+	}
+	ec->ec_vnode = NULL;
+	elfcache_invalidations++;
+	splx(s);
+
+	/* The caller is using V, so this is never the last reference. */
+	VOP_DECREF(v);
+}
+
+void
+elfcache_flush(void)
+{
+	struct vnode *v;
+	int i, s;
+
+	for (i=0; i<ELFCACHE_SIZE; i++) {
+		s = splhigh();
+		v = elfcache[i].ec_vnode;
+		elfcache[i].ec_vnode = NULL;
+		splx(s);
+
+		if (v != NULL) {
+			VOP_DECREF(v);
+		}
+	}
+}
+
+void
+elfcache_setenabled(int on)
+{
+	elfcache_on = on;
+	if (!on) {
+		elfcache_flush();
+	}
+}
+
+void
+elfcache_printstats(void)
+{
+	int i, n = 0;
+
+	for (i=0; i<ELFCACHE_SIZE; i++) {
+		if (elfcache[i].ec_vnode != NULL) {
+			n++;
+		}
+	}
+	kprintf("elfcache: %s, %d/%d entries\n", elfcache_on ? "on" : "off",
+		n, ELFCACHE_SIZE);
+	kprintf("elfcache: %lu hits, %lu misses, %lu invalidations, "
+		"%lu evictions\n",
+		(unsigned long) elfcache_hits, (unsigned long) elfcache_misses,
+		(unsigned long) elfcache_invalidations,
+		(unsigned long) elfcache_evictions);
+}
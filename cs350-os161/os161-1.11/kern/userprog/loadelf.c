@@ -17,6 +17,7 @@
 #include <thread.h>
 #include <curthread.h>
 #include <vnode.h>
+#include <elfcache.h>
 
 /*
  * Load a segment at virtual address VADDR. The segment in memory
@@ -71,15 +72,24 @@ load_segment(struct vnode *v, off_t offset, vaddr_t vaddr,
 }
 
 /*
- * Load an ELF executable user program into the current address space.
- *
- * Returns the entry point (initial PC) for the program in ENTRYPOINT.
+ * Most program headers we are willing to read. Real executables have
+ * a handful; this only guards the size of the read below.
+ */
+#define ELF_MAXPHDRS 64
+
+/*
+ * Read and check the executable header and program headers of V and
+ * fill in IMG with the entry point and the PT_LOAD segments. The
+ * program headers are fetched with one read.
  */
+static
 int
-load_elf(struct vnode *v, vaddr_t *entrypoint)
+elf_parse(struct vnode *v, struct elf_image *img)
 {
 	Elf_Ehdr eh;   /* Executable header */
 	Elf_Phdr ph;   /* "Program header" = segment header */
+	char *phbuf;
+	size_t phsize;
 	int result, i;
 	struct uio ku;
 
@@ -124,13 +134,6 @@ load_elf(struct vnode *v, vaddr_t *entrypoint)
 	}
 
 	/*
-	 * Go through the list of segments and set up the address space.
-	 *
-	 * Ordinarily there will be one code segment, one read-only
-	 * data segment, and one data/bss segment, but there might
-	 * conceivably be more. You don't need to support such files
-	 * if it's unduly awkward to do so.
-	 *
 	 * Note that the expression eh.e_phoff + i*eh.e_phentsize is 
 	 * mandated by the ELF standard - we use sizeof(ph) to load,
 	 * because that's the structure we know, but the file on disk
@@ -138,20 +141,35 @@ load_elf(struct vnode *v, vaddr_t *entrypoint)
 	 * to find where the phdr starts.
 	 */
 
-	for (i=0; i<eh.e_phnum; i++) {
-		off_t offset = eh.e_phoff + i*eh.e_phentsize;
-		mk_kuio(&ku, &ph, sizeof(ph), offset, UIO_READ);
+	if (eh.e_phentsize < sizeof(ph) || eh.e_phnum > ELF_MAXPHDRS) {
+		return ENOEXEC;
+	}
 
-		result = VOP_READ(v, &ku);
-		if (result) {
-			return result;
-		}
+	phsize = eh.e_phnum * eh.e_phentsize;
+	phbuf = kmalloc(phsize);
+	if (phbuf == NULL) {
+		return ENOMEM;
+	}
 
-		if (ku.uio_resid != 0) {
-			/* short read; problem with executable? */
-			kprintf("ELF: short read on phdr - file truncated?\n");
-			return ENOEXEC;
-		}
+	mk_kuio(&ku, phbuf, phsize, eh.e_phoff, UIO_READ);
+	result = VOP_READ(v, &ku);
+	if (result) {
+		kfree(phbuf);
+		return result;
+	}
+
+	if (ku.uio_resid != 0) {
+		/* short read; problem with executable? */
+		kprintf("ELF: short read on phdr - file truncated?\n");
+		kfree(phbuf);
+		return ENOEXEC;
+	}
+
+	img->ei_entry = eh.e_entry;
+	img->ei_nsegs = 0;
+
+	for (i=0; i<eh.e_phnum; i++) {
+		memcpy(&ph, phbuf + i*eh.e_phentsize, sizeof(ph));
 
 		switch (ph.p_type) {
 		    case PT_NULL: /* skip */ continue;
@@ -161,16 +179,70 @@ load_elf(struct vnode *v, vaddr_t *entrypoint)
 		    default:
 			kprintf("loadelf: unknown segment type %d\n", 
 				ph.p_type);
+			kfree(phbuf);
+			return ENOEXEC;
+		}
+
+		if (img->ei_nsegs == ELF_MAXSEGS) {
+			kprintf("loadelf: too many segments\n");
+			kfree(phbuf);
 			return ENOEXEC;
 		}
+
+		img->ei_segs[img->ei_nsegs].es_vaddr = ph.p_vaddr;
+		img->ei_segs[img->ei_nsegs].es_offset = ph.p_offset;
+		img->ei_segs[img->ei_nsegs].es_memsz = ph.p_memsz;
+		img->ei_segs[img->ei_nsegs].es_filesz = ph.p_filesz;
+		img->ei_segs[img->ei_nsegs].es_flags = ph.p_flags;
+		img->ei_nsegs++;
+	}
+
+	kfree(phbuf);
+	return 0;
+}
+
+/*
+ * Load an ELF executable user program into the current address space.
+ *
+ * Returns the entry point (initial PC) for the program in ENTRYPOINT.
+ *
+ * The headers come from the ELF cache if this file was run before;
+ * otherwise they are parsed and added to it.
+ */
+int
+load_elf(struct vnode *v, vaddr_t *entrypoint)
+{
+	struct elf_image img;
+	struct elf_seg *seg;
+	int result, i;
+
+	if (elfcache_lookup(v, &img)) {
+		result = elf_parse(v, &img);
+		if (result) {
+			return result;
+		}
+		elfcache_insert(v, &img);
+	}
+
+	/*
+	 * Go through the list of segments and set up the address space.
+	 *
+	 * Ordinarily there will be one code segment, one read-only
+	 * data segment, and one data/bss segment, but there might
+	 * conceivably be more. You don't need to support such files
+	 * if it's unduly awkward to do so.
+	 */
+
+	for (i=0; i<img.ei_nsegs; i++) {
+		seg = &img.ei_segs[i];
                 // order:
                 // first load code segment (read-only)
                 // second load data segment
 		result = as_define_region(curthread->t_vmspace,
-					  ph.p_vaddr, ph.p_memsz,
-					  ph.p_flags & PF_R,
-					  ph.p_flags & PF_W,
-                                          ph.p_flags & PF_X);
+					  seg->es_vaddr, seg->es_memsz,
+					  seg->es_flags & PF_R,
+					  seg->es_flags & PF_W,
+                                          seg->es_flags & PF_X);
 		if (result) {
 			return result;
 		}
@@ -185,35 +257,11 @@ load_elf(struct vnode *v, vaddr_t *entrypoint)
 	/* Now actually load each segment. */
 	 
 
-	for (i=0; i<eh.e_phnum; i++) {
-		off_t offset = eh.e_phoff + i*eh.e_phentsize;
-		mk_kuio(&ku, &ph, sizeof(ph), offset, UIO_READ);
-
-		result = VOP_READ(v, &ku);
-		if (result) {
-			return result;
-		}
-
-		if (ku.uio_resid != 0) {
-			/* short read; problem with executable? */
-			kprintf("ELF: short read on phdr - file truncated?\n");
-			return ENOEXEC;
-		}
-
-		switch (ph.p_type) {
-		    case PT_NULL: /* skip */ continue;
-		    case PT_PHDR: /* skip */ continue;
-		    case PT_MIPS_REGINFO: /* skip */ continue;
-		    case PT_LOAD: break;
-		    default:
-			kprintf("loadelf: unknown segment type %d\n", 
-				ph.p_type);
-			return ENOEXEC;
-		}
-
-		result = load_segment(v, ph.p_offset, ph.p_vaddr, 
-				      ph.p_memsz, ph.p_filesz,
-				      ph.p_flags & PF_X);
+	for (i=0; i<img.ei_nsegs; i++) {
+		seg = &img.ei_segs[i];
+		result = load_segment(v, seg->es_offset, seg->es_vaddr, 
+				      seg->es_memsz, seg->es_filesz,
+				      seg->es_flags & PF_X);
 		if (result) {
 			return result;
 		}
@@ -224,7 +272,7 @@ load_elf(struct vnode *v, vaddr_t *entrypoint)
 		return result;
 	}
         
-	*entrypoint = eh.e_entry;
+	*entrypoint = img.ei_entry;
 
 	return 0;
 }
@@ -16,17 +16,17 @@
 #include <test.h>
 #include "opt-A2.h"
 /*
- * Load program "progname" and start running it in usermode.
- * Does not return except on error.
+ * Load program "progname" into a new address space for the current
+ * thread, which must not have one yet. Hands back the entry point and
+ * the initial user stack pointer. On error, the partly built address
+ * space is left for thread_exit (or the caller) to destroy.
  *
  * Calls vfs_open on progname and thus may destroy it.
  */
-extern int call_from_execv;
 int
-runprogram(char *progname,char** args, int nargs)
+load_program(char *progname, vaddr_t *entrypoint, vaddr_t *stackptr)
 {
 	struct vnode *v;
-	vaddr_t entrypoint, stackptr;
 	int result;
 
 	/* Open the file. */
@@ -49,7 +49,7 @@ runprogram(char *progname,char** args, int nargs)
 	as_activate(curthread->t_vmspace);
 
 	/* Load the executable. */
-	result = load_elf(v, &entrypoint);
+	result = load_elf(v, entrypoint);
 	if (result) {
 		/* thread_exit destroys curthread->t_vmspace */
 		vfs_close(v);
@@ -60,41 +60,76 @@ runprogram(char *progname,char** args, int nargs)
 	vfs_close(v);
 
 	/* Define the user stack in the address space */
-	result = as_define_stack(curthread->t_vmspace, &stackptr);
+	result = as_define_stack(curthread->t_vmspace, stackptr);
 	if (result) {
 		/* thread_exit destroys curthread->t_vmspace */
 		return result;
 	}
-      
-        #if OPT_A2
-        stackptr -= (sizeof (char*) * (nargs + 1)); // dont forget NULL
-        userptr_t *u_args = (userptr_t*)stackptr;
-        int i;
-        for (i = 0 ; i < nargs ; ++i  ){
-           int len = strlen(args[i]) + 1;
-           stackptr -= len;
-           u_args[i] = (userptr_t)stackptr;
-           copyout(args[i], u_args[i], sizeof(char) * len );
-                 
-        }
-        u_args[nargs] = NULL;
-
-        stackptr -= stackptr % 8; //align 
-        /* dont forget free memory! */
-        if (call_from_execv){
-           for(i = 0; i < nargs ;++i) kfree(args[i]);
-           kfree(args);
-           call_from_execv = 0;
-        }
-        assert(call_from_execv == 0);
+
+	return 0;
+}
+
+/*
+ * Copy the NARGS strings in ARGS onto the user stack below *STACKPTR,
+ * followed by a NULL-terminated argv array pointing at them. Updates
+ * *STACKPTR and returns the user address of argv in *UARGV.
+ */
+int
+copyout_args(char **args, int nargs, vaddr_t *stackptr, userptr_t *uargv)
+{
+	vaddr_t sp = *stackptr;
+	userptr_t *u_args;
+	int i, len, result;
+
+	sp -= (sizeof (char*) * (nargs + 1)); // dont forget NULL
+	u_args = (userptr_t*)sp;
+	for (i = 0 ; i < nargs ; ++i) {
+		len = strlen(args[i]) + 1;
+		sp -= len;
+		u_args[i] = (userptr_t)sp;
+		result = copyout(args[i], u_args[i], sizeof(char) * len);
+		if (result) {
+			return result;
+		}
+	}
+	u_args[nargs] = NULL;
+
+	sp -= sp % 8; //align 
+
+	*stackptr = sp;
+	*uargv = (userptr_t)u_args;
+	return 0;
+}
+
+/*
+ * Load program "progname" and start running it in usermode.
+ * Does not return except on error. ARGS belongs to the caller and
+ * must stay valid until the program has started.
+ *
+ * Calls vfs_open on progname and thus may destroy it.
+ */
+int
+runprogram(char *progname,char** args, int nargs)
+{
+	vaddr_t entrypoint, stackptr;
+	userptr_t u_args;
+	int result;
+
+	result = load_program(progname, &entrypoint, &stackptr);
+	if (result) {
+		return result;
+	}
+
+	result = copyout_args(args, nargs, &stackptr, &u_args);
+	if (result) {
+		return result;
+	}
 
 	/* Warp to user mode. */
-	md_usermode(nargs /*argc*/, (userptr_t)u_args /*userspace addr of argv*/,
+	md_usermode(nargs /*argc*/, u_args /*userspace addr of argv*/,
 		    stackptr, entrypoint);
-	#endif
+	
 	/* md_usermode does not return */
 	panic("md_usermode returned\n");
 	return EINVAL;
 }
-
-
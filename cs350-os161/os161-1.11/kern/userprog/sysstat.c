@@ -0,0 +1,223 @@
+/*
+ * Per-system-call statistics. See sysstat.h and kern/sysstat.h.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <kern/callno.h>
+#include <lib.h>
+#include <clock.h>
+#include <machine/spl.h>
+#include <syscall.h>
+#include <sysstat.h>
+
+/* Names for the table; a call not listed here shows as its number. */
+static const struct {
+	int num;
+	const char *name;
+} sysstat_names[] = {
+	{ SYS__exit,           "_exit" },
+	{ SYS_execv,           "execv" },
+	{ SYS_fork,            "fork" },
+	{ SYS_waitpid,         "waitpid" },
+	{ SYS_open,            "open" },
+	{ SYS_read,            "read" },
+	{ SYS_write,           "write" },
+	{ SYS_close,           "close" },
+	{ SYS_reboot,          "reboot" },
+	{ SYS_sync,            "sync" },
+	{ SYS_sbrk,            "sbrk" },
+	{ SYS_getpid,          "getpid" },
+	{ SYS_ioctl,           "ioctl" },
+	{ SYS_lseek,           "lseek" },
+	{ SYS_fsync,           "fsync" },
+	{ SYS_ftruncate,       "ftruncate" },
+	{ SYS_fstat,           "fstat" },
+	{ SYS_remove,          "remove" },
+	{ SYS_rename,          "rename" },
+	{ SYS_link,            "link" },
+	{ SYS_mkdir,           "mkdir" },
+	{ SYS_rmdir,           "rmdir" },
+	{ SYS_chdir,           "chdir" },
+	{ SYS_getdirentry,     "getdirentry" },
+	{ SYS_symlink,         "symlink" },
+	{ SYS_readlink,        "readlink" },
+	{ SYS_dup2,            "dup2" },
+	{ SYS_pipe,            "pipe" },
+	{ SYS___time,          "__time" },
+	{ SYS___getcwd,        "__getcwd" },
+	{ SYS_stat,            "stat" },
+	{ SYS_lstat,           "lstat" },
+	{ SYS___spawn,         "__spawn" },
+	{ SYS___batch_register, "__batch_register" },
+	{ SYS___batch_submit,  "__batch_submit" },
+	{ SYS_aio_submit,      "aio_submit" },
+	{ SYS_aio_wait,        "aio_wait" },
+	{ SYS___thread_create, "__thread_create" },
+	{ SYS___thread_exit,   "__thread_exit" },
+	{ SYS___thread_join,   "__thread_join" },
+	{ SYS___sysstat,       "__sysstat" },
+	{ SYS_nanosleep,       "nanosleep" },
+	{ SYS___psinfo,        "__psinfo" },
+	{ SYS___tickets,       "__tickets" },
+};
+
+#define NNAMES (sizeof(sysstat_names)/sizeof(sysstat_names[0]))
+
+static struct sysstat sysstats[SYSSTAT_NCALLS];
+
+void
+sysstat_enter(int callno)
+{
+	int s;
+
+	if (callno < 0 || callno >= SYSSTAT_NCALLS) {
+		return;
+	}
+	s = splhigh();
+	sysstats[callno].ss_count++;
+	splx(s);
+}
+
+void
+sysstat_exit(int callno, int err, time_t secs, u_int32_t nsecs)
+{
+	struct sysstat *ss;
+	time_t now, dsecs;
+	u_int32_t nnow, dnsecs, usecs, limit;
+	int s, b;
+
+	if (callno < 0 || callno >= SYSSTAT_NCALLS) {
+		return;
+	}
+
+	gettime(&now, &nnow);
+	getinterval(secs, nsecs, now, nnow, &dsecs, &dnsecs);
+	/* cap, so it fits in 32 bits; the >=1s bucket is all that matters */
+	usecs = dsecs >= 4000 ? 0xffffffff : dsecs*1000000 + dnsecs/1000;
+
+	for (b=0, limit=10; b<SYSSTAT_NBUCKETS-1 && usecs>=limit; b++) {
+		limit *= 10;
+	}
+
+	ss = &sysstats[callno];
+	s = splhigh();
+	if (err) {
+		ss->ss_errors++;
+	}
+	ss->ss_secs += dsecs;
+	ss->ss_usecs += dnsecs/1000;
+	if (ss->ss_usecs >= 1000000) {
+		ss->ss_secs++;
+		ss->ss_usecs -= 1000000;
+	}
+	if (usecs > ss->ss_max) {
+		ss->ss_max = usecs;
+	}
+	ss->ss_hist[b]++;
+	splx(s);
+}
+
+/*
+ * Fill in the names, which the counters don't keep.
+ */
+static
+void
+sysstat_name(struct sysstat *ss, int callno)
+{
+	unsigned i;
+
+	ss->ss_name[0] = 0;
+	for (i=0; i<NNAMES; i++) {
+		if (sysstat_names[i].num == callno) {
+			assert(strlen(sysstat_names[i].name) < SYSSTAT_NAMELEN);
+			strcpy(ss->ss_name, sysstat_names[i].name);
+			return;
+		}
+	}
+}
+
+void
+sysstat_reset(void)
+{
+	int s;
+
+	s = splhigh();
+	bzero(sysstats, sizeof(sysstats));
+	splx(s);
+}
+
+void
+sysstat_print(void)
+{
+	struct sysstat ss;
+	u_int32_t avg;
+	int i, b, s;
+
+	kprintf("%-16s %8s %6s %10s %10s  histogram (<10us <100us "
+		"<1ms <10ms <100ms <1s >=1s)\n",
+		"call", "count", "errors", "avg us", "max us");
+	for (i=0; i<SYSSTAT_NCALLS; i++) {
+		s = splhigh();
+		ss = sysstats[i];
+		splx(s);
+		if (ss.ss_count == 0) {
+			continue;
+		}
+		sysstat_name(&ss, i);
+
+		/* average over the calls that returned */
+		avg = 0;
+		for (b=0; b<SYSSTAT_NBUCKETS; b++) {
+			avg += ss.ss_hist[b];
+		}
+		if (avg > 0) {
+			avg = ss.ss_secs < 4000 ?
+				(ss.ss_secs*1000000 + ss.ss_usecs) / avg :
+				(ss.ss_secs / avg) * 1000000;
+		}
+
+		if (ss.ss_name[0]) {
+			kprintf("%-16s", ss.ss_name);
+		}
+		else {
+			kprintf("%-16d", i);
+		}
+		kprintf(" %8lu %6lu %10lu %10lu ",
+			(unsigned long) ss.ss_count,
+			(unsigned long) ss.ss_errors,
+			(unsigned long) avg, (unsigned long) ss.ss_max);
+		for (b=0; b<SYSSTAT_NBUCKETS; b++) {
+			kprintf(" %lu", (unsigned long) ss.ss_hist[b]);
+		}
+		kprintf("\n");
+	}
+}
+
+int
+sys___sysstat(struct sysstat *buf, int n, int *err)
+{
+	struct sysstat ss;
+	int i, s, result;
+
+	if (n < 0) {
+		*err = EINVAL;
+		return -1;
+	}
+	if (n > SYSSTAT_NCALLS) {
+		n = SYSSTAT_NCALLS;
+	}
+
+	for (i=0; i<n; i++) {
+		s = splhigh();
+		ss = sysstats[i];
+		splx(s);
+		sysstat_name(&ss, i);
+
+		result = copyout(&ss, (userptr_t)&buf[i], sizeof(ss));
+		if (result) {
+			*err = result;
+			return -1;
+		}
+	}
+	return n;
+}
@@ -13,23 +13,25 @@
 #include <machine/trapframe.h>
 #include <machine/spl.h>
 #include <kern/limits.h>
+#include <machine/pcb.h>
+#include <proctable.h>
+#include <clock.h>
+#include <pipe.h>
+#include <aio.h>
+#include <uthread.h>
+#include <kern/stat.h>
+#include <kern/psinfo.h>
+#include <timer.h>
+#include <scheduler.h>
 
-struct semaphore* wait = NULL;
-struct semaphore* t = NULL;
 struct semaphore* file = NULL;
-struct semaphore* forksem = NULL;
-struct semaphore* exit = NULL;
 
 extern struct filetable* create_ft();
 extern void as_destroy(struct addrspace*);
 extern int as_copy(struct addrspace*,struct addrspace**);
 extern void md_forkentry(void*,unsigned long);
-extern int runprogram(const char*,char**,int);
 extern void destroy_ft(struct filetable* ft);
-extern struct process* p_table[MAX_PROG+1];
 
-int call_from_fork = 0;
-int call_from_execv = 0;
 /*
  *  err will store error code
  *  if fail to open a file, return -1 , other syscall will check this
@@ -55,73 +57,58 @@ int sys_open(const char* filename,int flag,int* err) {
         return -1;
     }
 
-    // find the first available slot
-    int i;
-    for (i = 3 ;curthread->ft[i] != NULL && i < MAX_FILE; i++);
-
-    // error checking
-    if (i == MAX_FILE && curthread->ft[i] != NULL) {
-       *err = EMFILE; // full
+    struct filetable* ft = create_ft();
+    if (ft == NULL) {
+       *err = ENOMEM;
        return -1;
     }
-    // now i is the first available slot
-
-    curthread->ft[i] = create_ft();
-    curthread->ft[i]->mode = flag;
-    // dup filename
-    char* name = NULL;
-    name = kstrdup(filename);
-    // open file
-    result = vfs_open(name,flag,&(curthread->ft[i]->file));
-
-    kfree(name);
-    // error checking
+    ft->mode = flag;
+    // open file (vfs_open may modify the name, so use the kernel copy)
+    result = vfs_open(kbuf,flag,&ft->file);
     if(result) {
-       destroy_ft(curthread->ft[i]);
-       curthread->ft[i] = NULL;
+       destroy_ft(ft);
+       *err = result;
+       return -1;
+    }
+
+    // lowest available descriptor
+    int fd;
+    result = fdtable_add(curthread->fdt,ft,&fd);
+    if (result) {
+       vfs_close(ft->file);
+       destroy_ft(ft);
        *err = result;
        return -1;
     }
 
     // return
-    return i;
+    return fd;
 }
 
 
 int sys_close (int fd, int* err){
 
-    // validate parameter
-    if (fd < 3 || fd > MAX_FILE || curthread->ft[fd] == NULL){
+    // validate parameter; another thread may close it first
+    if (fd < 3 || fdtable_close(curthread->fdt,fd)){
        *err = EBADF;
        return -1;
     }
-
-    // close
-    if (curthread->ft[fd]->dup > 0) {
-       curthread->ft[fd]->dup--;
-       return 0;
-    }
-
-    vfs_close(curthread->ft[fd]->file);
-
-    destroy_ft(curthread->ft[fd]);
-    curthread->ft[fd] = NULL;
     return 0;
 }
 
-int sys_read(int fd, void* ubuf, size_t len, int* err){
+/*
+ * sys_read, sys_write and sys_lseek hold a reference to the open file
+ * for the whole call, so a close in another thread of the process
+ * can't free it underneath them; the work is done by these.
+ */
+static int ft_read(struct filetable* ft, void* ubuf, size_t len, int* err){
     // validate parameter
-    if (fd < 0 || fd > MAX_FILE || curthread->ft[fd] == NULL) {
-       *err = EBADF;
-       return -1;
-    }
-
     if (ubuf == NULL){
        *err = EFAULT;
        return -1;
     }
 
-    if (curthread->ft[fd]->mode == O_WRONLY){
+    if (ft->mode == O_WRONLY){
       *err = EBADF;
       return -1;
     }
@@ -133,15 +120,16 @@ int sys_read(int fd, void* ubuf, size_t len, int* err){
     struct uio u;
 
     // this is kernel level I/O setup
-    mk_kuio(&u,kbuf,len,curthread->ft[fd]->offset,UIO_READ);
+    mk_kuio(&u,kbuf,len,ft->offset,UIO_READ);
 
 
-    // read
+    // read; a pipe may block, so it can't hold the global file lock
+    int ispipe = pipe_isvnode(ft->file);
     if (file == NULL) file = sem_create("file",1);
-    P(file);
-    result = VOP_READ(curthread->ft[fd]->file, &u);
-    V(file);
-    curthread->ft[fd]->offset = u.uio_offset;
+    if (!ispipe) P(file);
+    result = VOP_READ(ft->file, &u);
+    if (!ispipe) V(file);
+    ft->offset = u.uio_offset;
 
     if (result) {
        *err = result;
@@ -150,7 +138,7 @@ int sys_read(int fd, void* ubuf, size_t len, int* err){
     }
 
     // error checking & copy memory
-    result = copyout(kbuf,ubuf,len-u.uio_resid+1);
+    result = copyout(kbuf,ubuf,len-u.uio_resid);
     if (result){
        *err = result;
        kfree(kbuf);
@@ -161,12 +149,8 @@ int sys_read(int fd, void* ubuf, size_t len, int* err){
 }
 
 
-int sys_write(int fd, const void* ubuf ,size_t nbytes, int* err){
+static int ft_write(struct filetable* ft, const void* ubuf, size_t nbytes, int* err){
     // valadate parameter
-    if (fd < 0 || fd > MAX_FILE || curthread->ft[fd] == NULL) {
-       *err = EBADF;
-       return -1;
-    }
     if (ubuf == NULL) {
        *err = EFAULT;
        return -1;
@@ -183,7 +167,7 @@ int sys_write(int fd, const void* ubuf ,size_t nbytes, int* err){
     }
     kfree(test);
  
-    if (curthread->ft[fd]->mode == O_RDONLY){
+    if (ft->mode == O_RDONLY){
        *err = EBADF;
        return -1;
     }
@@ -191,34 +175,180 @@ int sys_write(int fd, const void* ubuf ,size_t nbytes, int* err){
     // error checking completed!
 
     // this is user-level I/O setup, not kernel-level
-    mk_uuio(&u,(void*)ubuf,nbytes,curthread->ft[fd]->offset,UIO_WRITE);
+    mk_uuio(&u,(void*)ubuf,nbytes,ft->offset,UIO_WRITE);
 
     // write
+    int ispipe = pipe_isvnode(ft->file);
+    if (file == NULL) file = sem_create("file",1);
+    if (!ispipe) P(file);
+    result = VOP_WRITE(ft->file,&u);
+    if (!ispipe) V(file);
+    ft->offset = u.uio_offset;
+
+    if (result) {
+       *err = result;
+       return -1;
+    }
+
+    return nbytes - u.uio_resid;
+}
+
+static off_t ft_lseek(struct filetable* ft, off_t pos, int whence, int* err){
+    // validate parameter
+    if (pipe_isvnode(ft->file)) {
+       *err = ESPIPE;
+       return -1;
+    }
+
+    int result;
+    off_t newpos;
+    struct stat st;
+
     if (file == NULL) file = sem_create("file",1);
     P(file);
-    result = VOP_WRITE(curthread->ft[fd]->file,&u);
+    switch (whence) {
+       case SEEK_SET:
+          newpos = pos;
+          break;
+       case SEEK_CUR:
+          newpos = ft->offset + pos;
+          break;
+       case SEEK_END:
+          result = VOP_STAT(ft->file,&st);
+          if (result) {
+             V(file);
+             *err = result;
+             return -1;
+          }
+          newpos = st.st_size + pos;
+          break;
+       default:
+          V(file);
+          *err = EINVAL;
+          return -1;
+    }
+
+    if (newpos < 0) {
+       V(file);
+       *err = EINVAL;
+       return -1;
+    }
+    result = VOP_TRYSEEK(ft->file,newpos);
+    if (result) {
+       V(file);
+       *err = result;
+       return -1;
+    }
+    ft->offset = newpos;
     V(file);
-    curthread->ft[fd]->offset = u.uio_offset;
 
+    return newpos;
+}
+
+int sys_read(int fd, void* ubuf, size_t len, int* err){
+    int result;
+    struct filetable* ft = fdtable_get(curthread->fdt,fd);
+    if (ft == NULL) {
+       *err = EBADF;
+       return -1;
+    }
+    result = ft_read(ft,ubuf,len,err);
+    release_ft(ft);
+    return result;
+}
+
+int sys_write(int fd, const void* ubuf, size_t nbytes, int* err){
+    int result;
+    struct filetable* ft = fdtable_get(curthread->fdt,fd);
+    if (ft == NULL) {
+       *err = EBADF;
+       return -1;
+    }
+    result = ft_write(ft,ubuf,nbytes,err);
+    release_ft(ft);
+    return result;
+}
+
+off_t sys_lseek(int fd, off_t pos, int whence, int* err){
+    off_t result;
+    struct filetable* ft = fdtable_get(curthread->fdt,fd);
+    if (ft == NULL) {
+       *err = EBADF;
+       return -1;
+    }
+    result = ft_lseek(ft,pos,whence,err);
+    release_ft(ft);
+    return result;
+}
+
+
+int sys_pipe(int* fds, int* err){
+    struct vnode *rv, *wv;
+    struct filetable *rft, *wft;
+    int kfds[2];
+    int result;
+
+    if (fds == NULL) {
+       *err = EFAULT;
+       return -1;
+    }
+
+    result = pipe_create(&rv,&wv);
     if (result) {
        *err = result;
        return -1;
     }
 
-    return nbytes - u.uio_resid;
+    rft = create_ft();
+    wft = create_ft();
+    if (rft == NULL || wft == NULL) {
+       result = ENOMEM;
+       goto fail;
+    }
+    rft->file = rv;
+    rft->mode = O_RDONLY;
+    wft->file = wv;
+    wft->mode = O_WRONLY;
+
+    result = fdtable_add(curthread->fdt,rft,&kfds[0]);
+    if (result) goto fail;
+    result = fdtable_add(curthread->fdt,wft,&kfds[1]);
+    if (result) {
+       // closing the descriptor closes rv too
+       fdtable_close(curthread->fdt,kfds[0]);
+       rft = NULL;
+       rv = NULL;
+       goto fail;
+    }
+
+    result = copyout(kfds,(userptr_t)fds,sizeof(kfds));
+    if (result) {
+       fdtable_close(curthread->fdt,kfds[1]);
+       fdtable_close(curthread->fdt,kfds[0]);
+       *err = result;
+       return -1;
+    }
+    return 0;
+
+ fail:
+    if (rft != NULL) destroy_ft(rft);
+    if (wft != NULL) destroy_ft(wft);
+    if (rv != NULL) vfs_close(rv);
+    vfs_close(wv);
+    *err = result;
+    return -1;
 }
 
 
 pid_t sys_fork(struct trapframe* tf, int* err) {
-    if(forksem == NULL) forksem = sem_create("thread",0);
-    if(t == NULL) t = sem_create("fork",1);
-    P(t);
-
     int result;
+    pid_t pid;
+
+    // everything the child needs is handed to it directly, so
+    // forks in different processes don't wait on each other
     struct trapframe* newTrap = kmalloc(sizeof (struct trapframe));
     if (newTrap == NULL){
        *err = ENOMEM;
-       V(t);
        return -1;
     }
     // copy a new tf
@@ -230,212 +360,491 @@ pid_t sys_fork(struct trapframe* tf, int* err) {
     // copy as
     result = as_copy(curthread->t_vmspace,&newAddr);
     if (result){
+       kfree(newTrap);
        *err = result;
-       V(t);
        return -1;
     }   
 
-   
-    struct thread* child = NULL; // return value
-    
-    call_from_fork = 1;
-    result = thread_fork(curthread->t_name,(void*)newTrap,(unsigned long)newAddr,md_forkentry,&child);
+    // descriptors
+    struct fdtable* fdt = NULL;
+    result = fdtable_copy(curthread->fdt,&fdt);
+    if (result){
+       as_destroy(newAddr);
+       kfree(newTrap);
+       *err = result;
+       return -1;
+    }
 
+    result = thread_fork_process(curthread->t_name,fdt,(void*)newTrap,(unsigned long)newAddr,md_forkentry,&pid);
     if (result) {
+       as_destroy(newAddr);
+       kfree(newTrap);
        *err = result;
-       V(t);
        return -1;
     }
 
-
-    P(forksem);
-    assert(child != NULL);
-
-    return child->pid;
+    // the child is runnable; don't wait for it to be scheduled
+    return pid;
 }
 
 pid_t sys_getpid(void){
     return curthread->pid;
 }
 
-pid_t sys_waitpid(pid_t pid, int* status, int options,int* err){
-    if (wait == NULL) wait = sem_create("wait",1);
-    P(wait);
-    // wrong option
-    if (options != 0){
+/*
+ * Copies out a snapshot of the process table, at most N entries.
+ * Processes that appear while we allocate the buffer may be left
+ * off the end.
+ */
+int sys___psinfo(struct psinfo* ubuf, int n, int* err){
+    struct psinfo* buf;
+    int count, result;
+
+    if (n < 0) {
+       *err = EINVAL;
+       return -1;
+    }
+    if (n > proctable_count()) {
+       n = proctable_count();
+    }
+    if (n == 0) {
+       return 0;
+    }
+
+    buf = kmalloc(n * sizeof(struct psinfo));
+    if (buf == NULL) {
+       *err = ENOMEM;
+       return -1;
+    }
+    count = proc_snapshot(buf,n);
+    result = copyout(buf,(userptr_t)ubuf,count * sizeof(struct psinfo));
+    kfree(buf);
+    if (result) {
+       *err = result;
+       return -1;
+    }
+    return count;
+}
+
+/*
+ * Give process PID (0 for the caller) TICKETS tickets, 0 to go back to
+ * the feedback queues, and return how many it had. Only the caller and
+ * its children may be changed. Applies to all the process's threads.
+ */
+int sys___tickets(pid_t pid, int tickets, int* err){
+    struct process* p;
+    struct uthread* ut;
+    int old = 0, s;
+
+    if (pid == 0) {
+       pid = curthread->pid;
+    }
+    if (tickets < TICKETS_QUERY || tickets > TICKETS_MAX) {
        *err = EINVAL;
-       V(wait);
        return -1;
     }
-    // beyond the region
-    if (pid <= 0 || pid > MAX_PROG) {
+
+    s = splhigh();
+    p = proc_get(pid);
+    if (p == NULL || p->exited ||
+        (pid != curthread->pid && p->ppid != curthread->pid)) {
+       splx(s);
+       *err = EINVAL;
+       return -1;
+    }
+
+    // every thread holds the process's tickets; read them off the first
+    if (p->t != NULL) {
+       old = p->t->t_tickets;
+    }
+    else {
+       for (ut = p->threads; ut != NULL; ut = ut->ut_next) {
+          if (ut->ut_thread != NULL) {
+             old = ut->ut_thread->t_tickets;
+             break;
+          }
+       }
+    }
+    if (tickets == TICKETS_QUERY) {
+       splx(s);
+       return old;
+    }
+
+    if (p->t != NULL) {
+       sched_settickets(p->t,tickets);
+    }
+    for (ut = p->threads; ut != NULL; ut = ut->ut_next) {
+       if (ut->ut_thread != NULL && ut->ut_thread != p->t) {
+          sched_settickets(ut->ut_thread,tickets);
+       }
+    }
+    splx(s);
+    return old;
+}
+
+/*
+ * Reads the clock itself, so is finer than the copy in the user page
+ * that libc normally uses. Either pointer may be NULL.
+ */
+time_t sys___time(time_t* secs, unsigned long* nsecs, int* err){
+    time_t s;
+    u_int32_t ns;
+    unsigned long uns;
+    int result;
+
+    gettime(&s,&ns);
+    if (secs != NULL){
+       result = copyout(&s,(userptr_t)secs,sizeof(time_t));
+       if (result){
+          *err = result;
+          return -1;
+       }
+    }
+    if (nsecs != NULL){
+       uns = ns;
+       result = copyout(&uns,(userptr_t)nsecs,sizeof(unsigned long));
+       if (result){
+          *err = result;
+          return -1;
+       }
+    }
+    return s;
+}
+
+/*
+ * Sleeps on the timer wheel, so the time is rounded up to whole
+ * ticks, plus one since we may be partway through the current tick.
+ * Nothing can interrupt the sleep, so REM, if given, is always zero.
+ */
+int sys_nanosleep(const struct timespec* req, struct timespec* rem, int* err){
+    struct timespec ts;
+    u_int32_t nticks;
+    int result;
+
+    result = copyin((const_userptr_t)req,&ts,sizeof(ts));
+    if (result){
+       *err = result;
+       return -1;
+    }
+    if (ts.tv_sec < 0 || ts.tv_nsec < 0 || ts.tv_nsec >= 1000000000){
+       *err = EINVAL;
+       return -1;
+    }
+
+    // cap so the tick count can't overflow
+    if ((u_int32_t)ts.tv_sec > 0x7fffffff / HZ){
+       ts.tv_sec = 0x7fffffff / HZ;
+    }
+    nticks = ts.tv_sec * HZ + (ts.tv_nsec + (1000000000/HZ - 1)) / (1000000000/HZ);
+    if (nticks > 0){
+       result = timer_sleep(nticks + 1);
+       if (result){
+          *err = result;
+          return -1;
+       }
+    }
+
+    if (rem != NULL){
+       ts.tv_sec = 0;
+       ts.tv_nsec = 0;
+       result = copyout(&ts,(userptr_t)rem,sizeof(ts));
+       if (result){
+          *err = result;
+          return -1;
+       }
+    }
+    return 0;
+}
+
+pid_t sys_waitpid(pid_t pid, int* status, int options,int* err){
+    // wrong option
+    if ((options & ~WNOHANG) != 0){
        *err = EINVAL;
-       V(wait);
        return -1;
     }
     // invalid pid
-    if (p_table[pid] == NULL){
+    if (pid <= 0 && pid != -1){
        *err = EINVAL;
-       V(wait);
        return -1;
     }
     if (status == NULL){
        *err = EFAULT;
-       V(wait);
        return -1;
     }
     
-    // pointer legit?
+    // pointer legit? check before reaping, or the child is lost
     int test = 1;
     int result = copyin((const_userptr_t)status, &test, sizeof(int));
     if (result) {
        *err = EFAULT;
-       V(wait);
        return -1;
     }
 
-    struct process* parent = p_table[curthread->pid];
-    struct process* child = p_table[pid];
-    assert(child != NULL);
-    assert(parent != NULL);
-
-    // right person
-    if (child->ppid != curthread->pid) {
-       *status = 0;
-       V(wait);
-       return 0;
-    }
-   
-    // whether child has been exited?
-    if (child->exited == 1){
-       // grab exitcode and return
-       *status = child->exitcode;
-       V(wait);
-       return pid;
+    pid_t child;
+    int code;
+    result = proc_wait(curthread->pid,pid,options,&child,&code);
+    if (result) {
+       *err = result;
+       return -1;
     }
-    // check
-    assert(child->exited == 0);
+    // WNOHANG and nobody has exited yet
+    if (child == 0) return 0;
 
-    if (child->exit == NULL) child->exit = cv_create("exit");
-    if (child->exitlock == NULL) child->exitlock = lock_create("exitlock");
+    result = copyout(&code,(userptr_t)status,sizeof(int));
+    if (result) {
+       *err = result;
+       return -1;
+    }
+    return child;
+}
 
-    V(wait);
+void sys__exit(int code){
+   // stop our other threads, if any, and wait for them to leave
+   uthread_single();
 
-    lock_acquire(child->exitlock);
-    parent->waiting = 1;
-    cv_wait(child->exit,child->exitlock);
-    parent->waiting = 0;
+   // drop unfinished async I/O while our pid is still ours
+   aio_cleanup(curthread->pid);
 
-    // if code runs here, it means child has been exited!
-    assert(child->exited == 1);
+   // become a zombie and wake our parent, if it's waiting
+   proc_exit(curthread->pid,code);
 
-    *status = child->exitcode;
-    lock_release(child->exitlock);
+   thread_exit();
+}
 
-    // no one will care this child any more
-    lock_destroy(child->exitlock);
-    cv_destroy(child->exit);
-    kfree(p_table[pid]);
-    p_table[pid] = NULL;
+// most arguments execv and __spawn will take
+#define MAX_ARGS 1024
 
-    return pid;
+static void free_args(char** argv, int nargs){
+    int n;
+    for (n = 0 ; n < nargs ; ++n) kfree(argv[n]);
+    kfree(argv);
 }
 
+/*
+ * Copy a NULL-terminated user argv array into the kernel. The strings
+ * and the array come back in *RET (free them with free_args) and the
+ * count in *NARGS. Shared by execv and __spawn.
+ */
+static int copyin_args(char** args, char*** ret, int* nargs){
+    int result, n, count;
+    size_t actual;
+    char* uarg;
 
+    if (args == NULL) return EFAULT;
 
- 
+    // count them first
+    count = 0;
+    do {
+       result = copyin((const_userptr_t)&args[count], &uarg, sizeof(char*));
+       if (result) return result;
+       if (uarg != NULL) count++;
+       if (count > MAX_ARGS) return E2BIG;
+    } while (uarg != NULL);
 
-void sys__exit(int code){
-   if (exit == NULL) exit = sem_create("exit",1);
-
-   P(exit);
-
-   pid_t pid = sys_getpid();
-   struct process* p = p_table[pid];
-   assert(p != NULL);
-
-   int hasParent;
-   if (p->ppid == -1) hasParent = 0;
-   else hasParent = 1;
-
-   p->exited = 1;
-   p->exitcode = code;
-   if(hasParent){
-      struct process* parent = p_table[p->ppid];
-      assert(parent != NULL);
-
-      if(parent->waiting){
-         if(p->exitlock == NULL) p->exitlock = lock_create("exitlock");
-         if(p->exit == NULL) p->exit = cv_create("exit");
-         lock_acquire(p->exitlock);
-         cv_broadcast(p->exit,p->exitlock);
-         lock_release(p->exitlock);
-      }
-   }
-   V(exit);
+    // copy to kernel
+    char** argv = kmalloc(sizeof(char*) * (count + 1));
+    if (argv == NULL) return ENOMEM;
+    char* buf = kmalloc(PATH_MAX);
+    if (buf == NULL) {
+       kfree(argv);
+       return ENOMEM;
+    }
+    for (n = 0 ; n < count; ++n){
+       result = copyin((const_userptr_t)&args[n], &uarg, sizeof(char*));
+       if (result == 0) {
+          result = copyinstr((const_userptr_t)uarg,buf,PATH_MAX,&actual);
+       }
+       if (result == 0) {
+          argv[n] = kstrdup(buf);
+          if (argv[n] == NULL) result = ENOMEM;
+       }
+       if (result) {
+          kfree(buf);
+          free_args(argv,n);
+          return result;
+       }
+    }
+    argv[count] = NULL;
+    kfree(buf);
 
-   thread_exit();
+    *ret = argv;
+    *nargs = count;
+    return 0;
 }
 
-int sys_execv(const char* prog, char** args,int* err){
-    // check prog
+
+/*
+ * Copy in the program name for execv/__spawn into BUF (PATH_MAX).
+ */
+static int copyin_progname(const char* prog, char* buf){
     int result;
     size_t actual;
-    char buf[PATH_MAX];
-    if (prog == NULL){
-       *err = EFAULT;
-       return -1;
-    }
+    if (prog == NULL) return EFAULT;
     result = copyinstr((const_userptr_t)prog,buf,PATH_MAX,&actual);
+    if (result) return result;
+    // empty string
+    if (actual == 1) return EINVAL;
+    return 0;
+}
+
+int sys_execv(const char* prog, char** args,int* err){
+    int result, spl;
+    vaddr_t entrypoint, stackptr;
+    userptr_t uargv;
+    char buf[PATH_MAX];
+    char *name, *oldname;
+    struct addrspace* as;
+
+    // check prog
+    result = copyin_progname(prog,buf);
     if (result){
        *err = result;
        return -1;
     }
-    // empty string
-    if (actual == 1){
-       *err = EINVAL;
-       return -1;
-    }
 
     // check args
-    int k;
-    result = copyin((const_userptr_t)args,&k,sizeof(int));
+    char** argv;
+    int nargs;
+    result = copyin_args(args,&argv,&nargs);
     if (result){
        *err = result;
        return -1;
     }
+    // error checking completed
 
-
-    int nargs = 0;
-    while(args[nargs] != NULL) {
-       result = copyin((const_userptr_t)args + nargs * 4, &k, sizeof(int));
-       if (result) {
-          *err = result;
-          return -1;
-	}
-       nargs++;
+    // we gonna run a new program, with just this thread
+    uthread_single();
+    // copy the new program's name now; vfs_open may scribble on buf
+    name = kstrdup(buf);
+    // unhook the old image before tearing it down; ps looks at it
+    as = curthread->t_vmspace;
+    curthread->t_vmspace = NULL;
+    as_destroy(as);
+    // a registered batch ring lived in the old image
+    curthread->batch = NULL;
+    
+    result = load_program(buf,&entrypoint,&stackptr);
+    if (result == 0) {
+       result = copyout_args(argv,nargs,&stackptr,&uargv);
+    }
+    free_args(argv,nargs);
+    if (result) {
+       if (name != NULL) kfree(name);
+       *err = result;
+       return -1;
     }
 
-    // copy to kernel
-    char** argv = kmalloc(sizeof(char*) * nargs);
-    int n;
-    for (n = 0 ; n < nargs; ++n){
-       argv[n] = kmalloc(sizeof(char) * PATH_MAX);
-       result = copyinstr((const_userptr_t)args[n],argv[n],PATH_MAX,&actual);
-       if (result) {
-          *err = result;
-          return -1;
-       }
+    // go by the new program's name (the profiler reads it from the
+    // clock interrupt, so swap it with interrupts off)
+    if (name != NULL) {
+       spl = splhigh();
+       oldname = curthread->t_name;
+       curthread->t_name = name;
+       splx(spl);
+       kfree(oldname);
     }
-    // error checking completed
 
-    // we gonna run a new program
-    as_destroy(curthread->t_vmspace);
-    curthread->t_vmspace = NULL;
-    
-    // mem will be freed in runprogram.c
-    call_from_execv = 1;
-    result = runprogram(buf,argv,nargs);
-    *err = result;
+    md_usermode(nargs,uargv,stackptr,entrypoint);
+    panic("md_usermode returned\n");
     return -1;
 }
+
+/*
+ * State shared between sys___spawn and the new process while it
+ * loads its program. Owned by the parent; the child stops touching
+ * it once it signals done.
+ */
+struct spawninfo {
+    char* prog;
+    char** argv;
+    int nargs;
+    struct semaphore* done;
+    int result;
+};
+
+/*
+ * First thing the spawned process runs. Loads the program into a
+ * fresh address space, reports how that went, and goes to user mode.
+ */
+static void spawn_entry(void* data1, unsigned long data2){
+    struct spawninfo* si = data1;
+    vaddr_t entrypoint, stackptr;
+    userptr_t uargv;
+    int result, nargs;
+    (void)data2;
+
+    result = load_program(si->prog,&entrypoint,&stackptr);
+    if (result == 0) {
+       result = copyout_args(si->argv,si->nargs,&stackptr,&uargv);
+    }
+    nargs = si->nargs;
+    si->result = result;
+
+    if (result) {
+       // the parent sees the error instead of a pid, so nobody will
+       // wait for us; drop the parent link so our pid gets recycled
+       proc_detach(curthread->pid);
+       V(si->done);
+       thread_exit();
+    }
+
+    V(si->done);
+    md_usermode(nargs,uargv,stackptr,entrypoint);
+    panic("md_usermode returned\n");
+}
+
+pid_t sys___spawn(const char* prog, char** args, int* err){
+    int result;
+    pid_t pid;
+    char* buf;
+
+    buf = kmalloc(PATH_MAX);
+    if (buf == NULL) {
+       *err = ENOMEM;
+       return -1;
+    }
+    result = copyin_progname(prog,buf);
+    if (result) {
+       kfree(buf);
+       *err = result;
+       return -1;
+    }
+
+    struct spawninfo si;
+    si.prog = buf;
+    si.result = 0;
+    result = copyin_args(args,&si.argv,&si.nargs);
+    if (result) {
+       kfree(buf);
+       *err = result;
+       return -1;
+    }
+    si.done = sem_create("spawn",0);
+    if (si.done == NULL) {
+       result = ENOMEM;
+       goto out;
+    }
+
+    // the child inherits our descriptors, but not our address space
+    struct fdtable* fdt = NULL;
+    result = fdtable_copy(curthread->fdt,&fdt);
+    if (result) goto out;
+
+    result = thread_fork_process(si.argv[0] != NULL ? si.argv[0] : buf,
+                                 fdt,&si,0,spawn_entry,&pid);
+    if (result) goto out;
+
+    // wait until it has loaded the program, so we can report errors
+    P(si.done);
+    result = si.result;
+
+ out:
+    if (si.done != NULL) sem_destroy(si.done);
+    free_args(si.argv,si.nargs);
+    kfree(buf);
+    if (result) {
+       *err = result;
+       return -1;
+    }
+    return pid;
+}
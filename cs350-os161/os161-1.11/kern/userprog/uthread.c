@@ -0,0 +1,318 @@
+/*
+ * Multithreaded user processes. See uthread.h.
+ *
+ * The per-process thread state lives in the process record and, like
+ * the rest of it, is protected by turning interrupts off.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <machine/spl.h>
+#include <machine/pcb.h>
+#include <thread.h>
+#include <curthread.h>
+#include <addrspace.h>
+#include <filetable.h>
+#include <proctable.h>
+#include <syscall.h>
+#include <uthread.h>
+
+/* What a new thread needs to get to user mode. */
+struct uthread_start {
+	vaddr_t us_entry;
+	vaddr_t us_stack;
+	int us_arg;
+	struct uthread *us_ut;
+};
+
+/*
+ * Find thread TID's join record. Interrupts must be off.
+ */
+static
+struct uthread *
+uthread_find(struct process *p, int tid)
+{
+	struct uthread *ut;
+
+	assert(curspl>0);
+	for (ut = p->threads; ut != NULL; ut = ut->ut_next) {
+		if (ut->ut_tid == tid) {
+			return ut;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Unlink UT from P's list. Interrupts must be off.
+ */
+static
+void
+uthread_unlink(struct process *p, struct uthread *ut)
+{
+	struct uthread **pp;
+
+	for (pp = &p->threads; *pp != ut; pp = &(*pp)->ut_next) {
+		assert(*pp != NULL);
+	}
+	*pp = ut->ut_next;
+}
+
+void
+uthread_freeall(struct process *p)
+{
+	struct uthread *ut;
+
+	while ((ut = p->threads) != NULL) {
+		p->threads = ut->ut_next;
+		kfree(ut);
+	}
+}
+
+/*
+ * Drop out of process P, which carries on without us. Posts our exit
+ * value RETVAL for joiners. If we are the last thread, the process
+ * exits with RETVAL instead. Does not return.
+ */
+static
+void
+uthread_quit(struct process *p, int retval)
+{
+	struct uthread *ut;
+	int s;
+
+	s = splhigh();
+	if (p->nthreads == 1) {
+		splx(s);
+		sys__exit(retval);
+	}
+
+	/* the address space and descriptors belong to whoever is last */
+	curthread->fdt = NULL;
+	curthread->t_vmspace = NULL;
+
+	ut = uthread_find(p, curthread->tid);
+	if (ut != NULL) {
+		ut->ut_exited = 1;
+		ut->ut_retval = retval;
+		ut->ut_thread = NULL;
+		thread_wakeup(ut);
+	}
+	if (p->t == curthread) {
+		p->t = NULL;
+	}
+	p->nthreads--;
+	thread_wakeup(&p->nthreads);
+	splx(s);
+
+	thread_exit();
+}
+
+void
+uthread_leave(void)
+{
+	struct process *p = proc_get(curthread->pid);
+
+	assert(p != NULL);
+	uthread_quit(p, -1);
+}
+
+void
+uthread_single(void)
+{
+	struct process *p = proc_get(curthread->pid);
+	struct uthread *ut;
+	int s;
+
+	assert(p != NULL);
+
+	s = splhigh();
+	if (p->exiting) {
+		/* someone else got there first */
+		splx(s);
+		uthread_quit(p, -1);
+	}
+	if (p->nthreads > 1) {
+		p->exiting = 1;
+		for (ut = p->threads; ut != NULL; ut = ut->ut_next) {
+			if (ut->ut_thread != NULL && ut->ut_thread != curthread) {
+				ut->ut_thread->exiting = 1;
+				/* get it out of any wait it's blocked in */
+				thread_interrupt(ut->ut_thread);
+			}
+		}
+		while (p->nthreads > 1) {
+			thread_sleep(&p->nthreads);
+		}
+		p->exiting = 0;
+	}
+	uthread_freeall(p);
+	curthread->tid = 0;
+	p->t = curthread;
+	splx(s);
+}
+
+/*
+ * First thing a new user thread runs. thread_fork_sibling already put
+ * it in the process; take up its place in the thread list.
+ */
+static
+void
+uthread_entry(void *data1, unsigned long data2)
+{
+	struct uthread_start *us = data1;
+	struct process *p;
+	vaddr_t entry, stack;
+	int arg, s;
+
+	(void)data2;
+
+	curthread->tid = us->us_ut->ut_tid;
+
+	p = proc_get(curthread->pid);
+	assert(p != NULL);
+
+	entry = us->us_entry;
+	stack = us->us_stack;
+	arg = us->us_arg;
+
+	s = splhigh();
+	us->us_ut->ut_thread = curthread;
+	if (p->exiting) {
+		curthread->exiting = 1;
+	}
+	splx(s);
+	kfree(us);
+
+	if (curthread->exiting) {
+		uthread_quit(p, -1);
+	}
+
+	as_activate(curthread->t_vmspace);
+	md_usermode(arg, NULL, stack, entry);
+	panic("md_usermode returned\n");
+}
+
+int
+sys___thread_create(vaddr_t entry, vaddr_t stack, int arg, int *err)
+{
+	struct process *p = proc_get(curthread->pid);
+	struct uthread_start *us;
+	struct uthread *ut, *self = NULL;
+	int result, tid, s;
+
+	assert(p != NULL);
+
+	if (entry == 0 || stack == 0) {
+		*err = EFAULT;
+		return -1;
+	}
+
+	us = kmalloc(sizeof(struct uthread_start));
+	ut = kmalloc(sizeof(struct uthread));
+	if (p->threads == NULL) {
+		/* going multithreaded; the caller needs a record too */
+		self = kmalloc(sizeof(struct uthread));
+	}
+	if (us == NULL || ut == NULL || (p->threads == NULL && self == NULL)) {
+		if (us != NULL) kfree(us);
+		if (ut != NULL) kfree(ut);
+		if (self != NULL) kfree(self);
+		*err = ENOMEM;
+		return -1;
+	}
+
+	s = splhigh();
+	if (self != NULL) {
+		self->ut_tid = curthread->tid;
+		self->ut_exited = 0;
+		self->ut_retval = 0;
+		self->ut_thread = curthread;
+		self->ut_next = p->threads;
+		p->threads = self;
+	}
+	tid = ut->ut_tid = p->nexttid++;
+	ut->ut_exited = 0;
+	ut->ut_retval = 0;
+	ut->ut_thread = NULL;
+	ut->ut_next = p->threads;
+	p->threads = ut;
+	p->nthreads++;
+	splx(s);
+
+	us->us_entry = entry;
+	us->us_stack = stack;
+	us->us_arg = arg;
+	us->us_ut = ut;
+
+	result = thread_fork_sibling(curthread->t_name, us, 0, uthread_entry);
+	if (result) {
+		s = splhigh();
+		uthread_unlink(p, ut);
+		p->nthreads--;
+		splx(s);
+		kfree(ut);
+		kfree(us);
+		*err = result;
+		return -1;
+	}
+
+	return tid;
+}
+
+void
+sys___thread_exit(int code)
+{
+	struct process *p = proc_get(curthread->pid);
+
+	assert(p != NULL);
+	uthread_quit(p, code);
+}
+
+int
+sys___thread_join(int tid, int *retval, int *err)
+{
+	struct process *p = proc_get(curthread->pid);
+	struct uthread *ut;
+	int code, result, s;
+
+	assert(p != NULL);
+
+	if (tid == curthread->tid) {
+		*err = EINVAL;
+		return -1;
+	}
+
+	s = splhigh();
+	while (1) {
+		/* look again each time; another joiner may have taken it */
+		ut = uthread_find(p, tid);
+		if (ut == NULL) {
+			splx(s);
+			*err = EINVAL;
+			return -1;
+		}
+		if (ut->ut_exited) {
+			break;
+		}
+		if (curthread->exiting) {
+			splx(s);
+			uthread_leave();
+		}
+		thread_sleep(ut);
+	}
+	uthread_unlink(p, ut);
+	splx(s);
+
+	code = ut->ut_retval;
+	kfree(ut);
+
+	if (retval != NULL) {
+		result = copyout(&code, (userptr_t)retval, sizeof(int));
+		if (result) {
+			*err = result;
+			return -1;
+		}
+	}
+	return 0;
+}
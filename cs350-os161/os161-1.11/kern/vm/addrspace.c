@@ -13,11 +13,16 @@
 #include <vnode.h>
 #include <vm.h>
 #include <uw-vmstats.h>
+#include <synch.h>
 #include <machine/spl.h>
 #include <machine/tlb.h>
+#include <userpage.h>
+#include <ktrace.h>
 
 extern int num_entries;
 extern struct coremap* map;
+extern int coremap_pages;
+extern struct lock* coremap_lock;
 
 /*
  * Note! If OPT_DUMBVM is set, as is the case until you start the VM
@@ -44,6 +49,12 @@ vm_fault(int faulttype, vaddr_t faultaddress)
         // check address
         assert(faultaddress < MIPS_KSEG0);
 
+        // the shared user page isn't in any region
+        if (faultaddress == USERPAGE_ADDR) {
+           splx(spl);
+           return userpage_fault(faulttype);
+        }
+
 	switch (faulttype) {
 	    case VM_FAULT_READONLY:
                 splx(spl);
@@ -57,6 +68,8 @@ vm_fault(int faulttype, vaddr_t faultaddress)
 		splx(spl);
 		return EINVAL;
 	}
+	KTRACE(KTRACE_FAULT, KT_TLBFAULT, faulttype, faultaddress);
+
 	as = curthread->t_vmspace;
 	if (as == NULL){
            splx(spl);
@@ -96,6 +109,7 @@ vm_fault(int faulttype, vaddr_t faultaddress)
         ret = target->pte[index];
         // whether we first access?
         if (ret == NULL){
+           KTRACE(KTRACE_FAULT, KT_PAGEFAULT, faultaddress, 0);
            vmstats_inc(5);
            vmstats_inc(6);
            vmstats_inc(7);
@@ -141,13 +155,34 @@ as_create(void)
 void
 as_destroy(struct addrspace *as)
 {
-        int i;
+        int i, j, index;
+        struct page* p;
+
+        /*
+         * Hand back the frames our pages are in. The coremap is
+         * shared with every other process (and the pager), so only
+         * with coremap_lock held, and only the frames that are ours.
+         */
+        lock_acquire(coremap_lock);
         for(i = 0 ; i < 3; ++i){
-           int size = as->pt[i]->npages;
+           if (as->pt[i] == NULL) continue;
+           for(j = 0 ; j < as->pt[i]->npages; ++j){
+              p = as->pt[i]->pte[j];
+              if (p == NULL || p->valid != 1) continue;
+              index = PADDR_TO_COREMAP(p->pa & PAGE_FRAME);
+              assert(map[index].p == p);
+              map[index].status = FREE;
+              map[index].who = UNKNOWN;
+              map[index].last = 0;
+              map[index].p = NULL;
+           }
+        }
+        lock_release(coremap_lock);
 
-           int j;
-           for(j = 0 ; j < size; ++j){
-              struct page* p = as->pt[i]->pte[j];
+        for(i = 0 ; i < 3; ++i){
+           if (as->pt[i] == NULL) continue;
+           for(j = 0 ; j < as->pt[i]->npages; ++j){
+              p = as->pt[i]->pte[j];
               if (p != NULL){
                  kfree(p);
               }
@@ -155,13 +190,23 @@ as_destroy(struct addrspace *as)
            kfree(as->pt[i]);
         }
 	kfree(as);
-        for(i = 0; i < num_entries; ++i) {
-           if (map[i].who == KERNEL) continue;
-           map[i].status = FREE;
-           map[i].who = UNKNOWN;
-           map[i].last = 0;
-           map[i].p = NULL;
+}
+
+u_int32_t
+as_resident(struct addrspace *as)
+{
+        u_int32_t n = 0;
+        int i, j;
+
+        assert(curspl>0);
+        for(i = 0 ; i < 3; ++i){
+           if (as->pt[i] == NULL) continue;
+           for(j = 0 ; j < as->pt[i]->npages; ++j){
+              struct page* p = as->pt[i]->pte[j];
+              if (p != NULL && p->valid == 1) n++;
+           }
         }
+        return n;
 }
 
 void
@@ -9,6 +9,7 @@
 #include <addrspace.h>
 #include <coremap.h>
 #include <uw-vmstats.h>
+#include <ktrace.h>
 #include "opt-A3.h"
 
 /* global coremap */
@@ -122,6 +123,8 @@ evict_ram(int loc)
    assert((p->pa & PAGE_FRAME) != INVALID_PADDR);
    if (p->valid != 1)panic("%d\n",p->valid);   
 
+   KTRACE(KTRACE_VM, KT_EVICT, p->va, COREMAP_TO_PADDR(loc));
+
    page_evict(p);
    int spl = splhigh();
    // need to invalidate TLB
@@ -9,6 +9,7 @@
 #include <addrspace.h>
 #include <kern/errno.h>
 #include <uw-vmstats.h>
+#include <ktrace.h>
 #include "opt-A3.h"
 #if OPT_A3
 
@@ -103,6 +104,7 @@ page_fault(struct addrspace* as, struct page* p, int faulttype, vaddr_t fa,int w
    if (pfn == INVALID_PADDR){ // swapfile
       assert(p->valid == 0);
       assert(p->swap_loc != INVALID_SWAP);
+      KTRACE(KTRACE_FAULT, KT_PAGEFAULT, fa & PAGE_FRAME, 1);
       paddr_t pa = coremap_alloc_user(p);
 
       map_index = PADDR_TO_COREMAP(pa);
@@ -12,6 +12,7 @@
 #include <coremap.h>
 #include <swapfile.h>
 #include <uw-vmstats.h>
+#include <ktrace.h>
 #include "opt-A3.h"
 
 #if OPT_A3
@@ -123,6 +124,7 @@ swap_in(paddr_t pa, off_t loc)
     va = PADDR_TO_KVADDR(pa);
     mk_kuio(&u,(char*)va,PAGE_SIZE,loc,UIO_READ);
     vmstats_inc(8);
+    KTRACE(KTRACE_VM, KT_SWAPIN, loc, pa);
     int result = VOP_READ(swap_file,&u);
     if (result){
        panic("swap: error when trying to swap in\n");
@@ -148,6 +150,7 @@ swap_out(paddr_t pa, off_t loc)
     va = PADDR_TO_KVADDR(pa);
     mk_kuio(&u,(char*)va,PAGE_SIZE,loc,UIO_WRITE);
     vmstats_inc(9);
+    KTRACE(KTRACE_VM, KT_SWAPOUT, loc, pa);
     int result = VOP_WRITE(swap_file,&u);
     if (result){
        panic("swap: error when trying to swap out\n");     
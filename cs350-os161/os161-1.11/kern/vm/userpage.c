@@ -0,0 +1,86 @@
+/*
+ * The user page. See userpage.h and kern/userpage.h.
+ *
+ * There is one page for the whole system, written through its kseg0
+ * address and mapped read-only into user space on demand. It can
+ * only carry one pid, so that is rewritten on the way out to user
+ * mode; there is only one CPU, so whoever is in user mode is the
+ * process it names.
+ */
+#include <types.h>
+#include <kern/errno.h>
+#include <lib.h>
+#include <clock.h>
+#include <vm.h>
+#include <machine/spl.h>
+#include <machine/tlb.h>
+#include <userpage.h>
+
+static struct userpage *userpage = NULL;
+
+void
+userpage_bootstrap(void)
+{
+	struct userpage *up;
+	vaddr_t va;
+
+	va = alloc_kpages(1);
+	if (va == 0) {
+		panic("userpage_bootstrap: out of memory\n");
+	}
+	bzero((void *)va, PAGE_SIZE);
+
+	up = (struct userpage *)va;
+	gettime(&up->up_secs, &up->up_nsecs);
+	up->up_magic = USERPAGE_MAGIC;
+
+	/* hardclock checks for this, so set it last */
+	userpage = up;
+}
+
+void
+userpage_tick(void)
+{
+	volatile struct userpage *up = userpage;
+	time_t secs;
+	u_int32_t nsecs;
+
+	if (up == NULL) {
+		return;
+	}
+	gettime(&secs, &nsecs);
+
+	/* we are in the timer interrupt, so nothing else writes it */
+	up->up_seq++;
+	up->up_secs = secs;
+	up->up_nsecs = nsecs;
+	up->up_ticks++;
+	up->up_seq++;
+}
+
+void
+userpage_setpid(pid_t pid)
+{
+	if (userpage != NULL) {
+		userpage->up_pid = pid;
+	}
+}
+
+int
+userpage_fault(int faulttype)
+{
+	paddr_t pa;
+	int spl;
+
+	if (userpage == NULL || faulttype != VM_FAULT_READ) {
+		return EFAULT;
+	}
+
+	pa = (vaddr_t)userpage - MIPS_KSEG0;
+
+	/* no TLBLO_DIRTY: writes trap as VM_FAULT_READONLY */
+	spl = splhigh();
+	TLB_Random(USERPAGE_ADDR, pa | TLBLO_VALID);
+	splx(spl);
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include <sys/batch.h>
+#include <string.h>
+#include <errno.h>
+
+/*
+ * Helpers for the batched system call ring (see <kern/batch.h>).
+ * These only manipulate the ring in our own memory; the only trips
+ * into the kernel are __batch_register and __batch_submit.
+ */
+
+int
+batch_init(struct batch_ring *ring)
+{
+	bzero(ring, sizeof(*ring));
+	return __batch_register(ring);
+}
+
+int
+batch_queue(struct batch_ring *ring, int op, int fd, void *buf,
+	    unsigned len, int arg, unsigned cookie)
+{
+	struct batch_sqe *sqe;
+
+	if (ring->br_sqtail - ring->br_sqhead >= BATCH_RING_SIZE) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	sqe = &ring->br_sq[ring->br_sqtail % BATCH_RING_SIZE];
+	sqe->bs_op = op;
+	sqe->bs_fd = fd;
+	sqe->bs_buf = buf;
+	sqe->bs_len = len;
+	sqe->bs_arg = arg;
+	sqe->bs_cookie = cookie;
+	ring->br_sqtail++;
+	return 0;
+}
+
+int
+batch_submit(struct batch_ring *ring)
+{
+	(void)ring;
+	return __batch_submit();
+}
+
+int
+batch_reap(struct batch_ring *ring, struct batch_cqe *ret)
+{
+	if (ring->br_cqhead == ring->br_cqtail) {
+		return 0;
+	}
+	*ret = ring->br_cq[ring->br_cqhead % BATCH_RING_SIZE];
+	ring->br_cqhead++;
+	return 1;
+}
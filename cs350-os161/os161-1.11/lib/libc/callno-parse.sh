@@ -5,6 +5,12 @@
 #
 # Parses the kernel's callno.h into the body of syscalls.S
 #
+# Calls listed in WRAPPED have C versions in libc that try something
+# cheaper first (see userpage.c); their raw entry points are named
+# __sys_<call> instead.
+#
+
+WRAPPED="getpid __time"
 
 # tabs to spaces, just in case
 tr '\t' ' ' |\
@@ -19,8 +25,15 @@ awk '
 	# print the name of the call and the number.
 	print $2, $3;
     }
-' | awk '{
+' | awk -v wrapped="$WRAPPED" '
+    BEGIN { n = split(wrapped, w, " "); for (i=1; i<=n; i++) wrap[w[i]] = 1; }
+    {
 	# output something simple that will work in syscalls.S.
-	printf "SYSCALL(%s, %s)\n", $1, $2;
-}'
+	if ($1 in wrap) {
+	    printf "SYSCALL_AS(__sys_%s, %s)\n", $1, $1;
+	}
+	else {
+	    printf "SYSCALL(%s, %s)\n", $1, $2;
+	}
+    }'
     
@@ -0,0 +1,16 @@
+#include <unistd.h>
+
+/*
+ * Start program PROG with arguments ARGS in a new child process and
+ * return its pid, like fork followed by execv in the child, but
+ * without copying the parent's address space first. Uses the OS/161
+ * system call __spawn. Errors loading the program (such as a bad
+ * path) are reported here, as -1 with errno set, rather than by the
+ * child exiting.
+ */
+
+pid_t
+spawnv(const char *prog, char *const *args)
+{
+	return __spawn(prog, args);
+}
@@ -0,0 +1,84 @@
+#include <unistd.h>
+#include <errno.h>
+
+/*
+ * User threads on top of the OS/161 system calls __thread_create,
+ * __thread_exit and __thread_join.
+ *
+ * There is no malloc to get stacks from, so threads run on a fixed
+ * pool of stacks here. A stack is given back when its thread is
+ * joined; a thread that is never joined keeps its stack for good.
+ * threadfork is not safe to call from more than one thread at once.
+ */
+
+#define THREAD_MAX    16
+#define THREAD_STACK  16384
+
+/* double, so the stacks are 8-byte aligned */
+static double stacks[THREAD_MAX][THREAD_STACK/sizeof(double)];
+
+static struct {
+	void (*func)(void);
+	int tid;
+	int busy;
+} slots[THREAD_MAX];
+
+/*
+ * Where new threads start: run the function, then exit if it returns.
+ */
+static
+void
+threadstart(int slot)
+{
+	slots[slot].func();
+	threadexit(0);
+}
+
+int
+threadfork(void (*func)(void))
+{
+	char *sp;
+	int i, tid;
+
+	for (i=0; i<THREAD_MAX && slots[i].busy; i++);
+	if (i == THREAD_MAX) {
+		errno = EAGAIN;
+		return -1;
+	}
+	slots[i].busy = 1;
+	slots[i].func = func;
+	slots[i].tid = -1;
+
+	/* top of the stack, less the 16 bytes the callee may store args in */
+	sp = (char *)&stacks[i+1][0] - 16;
+
+	tid = __thread_create(threadstart, sp, i);
+	if (tid < 0) {
+		slots[i].busy = 0;
+		return -1;
+	}
+	slots[i].tid = tid;
+	return tid;
+}
+
+void
+threadexit(int code)
+{
+	__thread_exit(code);
+}
+
+int
+threadjoin(int tid, int *code)
+{
+	int i;
+
+	if (__thread_join(tid, code) < 0) {
+		return -1;
+	}
+	for (i=0; i<THREAD_MAX; i++) {
+		if (slots[i].busy && slots[i].tid == tid) {
+			slots[i].busy = 0;
+		}
+	}
+	return 0;
+}
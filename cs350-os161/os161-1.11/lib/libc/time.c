@@ -1,4 +1,5 @@
 #include <unistd.h>
+#include <sys/userpage.h>
 
 /*
  * POSIX C function: retrieve time in seconds since the epoch.
@@ -11,3 +12,37 @@ time(time_t *t)
 {
 	return __time(t, NULL);
 }
+
+/*
+ * OS/161 C function: milliseconds since the epoch, for timing
+ * things. Kept in 32 bits, so it wraps every seven weeks or so, but
+ * the difference between two readings taken closer together than
+ * that is still right. Asks the kernel, because the user page's copy
+ * of the time only moves once a clock tick.
+ */
+
+unsigned long
+__time_ms(void)
+{
+	time_t secs;
+	unsigned long nsecs;
+
+	__sys___time(&secs, &nsecs);
+	return secs*1000 + nsecs/1000000;
+}
+
+/*
+ * POSIX C function: sleep for SECONDS seconds. Uses nanosleep, which
+ * can't be interrupted, so always returns 0 (no time left over).
+ */
+
+unsigned
+sleep(unsigned seconds)
+{
+	struct timespec ts;
+
+	ts.tv_sec = seconds;
+	ts.tv_nsec = 0;
+	nanosleep(&ts, NULL);
+	return 0;
+}
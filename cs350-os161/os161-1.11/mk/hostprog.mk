@@ -54,7 +54,7 @@ hostdepend:
 	  sed 's/\.o/\.ho/' |\
 	  sed 's|$(OSTREE)|$$(OSTREE)|;$$p;$$x' > .deptmp
 	mv -f .deptmp dependh.mk
-include dependh.mk
+-include dependh.mk
 
 #
 # [ -d $(OSTREE)/hostbin ] succeeds if $(OSTREE)/hostbin is a directory.
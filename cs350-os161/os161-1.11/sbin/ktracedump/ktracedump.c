@@ -0,0 +1,325 @@
+/*
+ * ktracedump - turn kernel event traces into a readable timeline.
+ *
+ * Usage: host-ktracedump [file]
+ *
+ * Reads a captured console log (from "ktrace dump") or sys161's
+ * output (from "ktrace stream", which sends each word through the
+ * ltrace device), from FILE or standard input, and prints one line
+ * per event. Anything else in the input is ignored, so the whole
+ * session log can be fed in as is.
+ *
+ * Times are shown relative to the first event. Threads are numbered
+ * in the order they first appear.
+ */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <err.h>
+
+#include "kern/ktrace.h"
+#include "kern/callno.h"
+
+#define MAXTHREADS 256
+
+static u_int32_t threads[MAXTHREADS];
+static int nthreads;
+
+static int started;
+static u_int32_t startsecs, startnsecs;
+
+static const struct {
+	int num;
+	const char *name;
+} calls[] = {
+	{ SYS__exit, "_exit" },
+	{ SYS_execv, "execv" },
+	{ SYS_fork, "fork" },
+	{ SYS_waitpid, "waitpid" },
+	{ SYS_open, "open" },
+	{ SYS_read, "read" },
+	{ SYS_write, "write" },
+	{ SYS_close, "close" },
+	{ SYS_reboot, "reboot" },
+	{ SYS_sbrk, "sbrk" },
+	{ SYS_getpid, "getpid" },
+	{ SYS_lseek, "lseek" },
+	{ SYS_pipe, "pipe" },
+	{ SYS___time, "__time" },
+	{ SYS___spawn, "__spawn" },
+	{ SYS___batch_register, "__batch_register" },
+	{ SYS___batch_submit, "__batch_submit" },
+	{ SYS_aio_submit, "aio_submit" },
+	{ SYS_aio_wait, "aio_wait" },
+	{ SYS___thread_create, "__thread_create" },
+	{ SYS___thread_exit, "__thread_exit" },
+	{ SYS___thread_join, "__thread_join" },
+	{ SYS___sysstat, "__sysstat" },
+	{ SYS_nanosleep, "nanosleep" },
+	{ -1, NULL },
+};
+
+static
+const char *
+callname(u_int32_t num)
+{
+	static char buf[32];
+	int i;
+
+	for (i=0; calls[i].name != NULL; i++) {
+		if ((u_int32_t)calls[i].num == num) {
+			return calls[i].name;
+		}
+	}
+	snprintf(buf, sizeof(buf), "call %u", num);
+	return buf;
+}
+
+/*
+ * Short name for the thread at kernel address ADDR.
+ */
+static
+const char *
+threadname(u_int32_t addr)
+{
+	static char bufs[2][16];
+	static int which;
+	char *buf;
+	int i;
+
+	buf = bufs[which];
+	which = !which;
+
+	if (addr == 0) {
+		return "-";
+	}
+	for (i=0; i<nthreads; i++) {
+		if (threads[i] == addr) {
+			break;
+		}
+	}
+	if (i == nthreads) {
+		if (nthreads == MAXTHREADS) {
+			snprintf(buf, sizeof(bufs[0]), "%08x", addr);
+			return buf;
+		}
+		threads[nthreads++] = addr;
+	}
+	snprintf(buf, sizeof(bufs[0]), "t%d", i+1);
+	return buf;
+}
+
+static
+const char *
+statename(u_int32_t state)
+{
+	switch (state) {
+	    case KT_STATE_READY: return "ready";
+	    case KT_STATE_SLEEP: return "sleep";
+	    case KT_STATE_ZOMB: return "exit";
+	}
+	return "?";
+}
+
+static
+const char *
+faultname(u_int32_t type)
+{
+	switch (type) {
+	    case 0: return "read";
+	    case 1: return "write";
+	    case 2: return "readonly";
+	}
+	return "?";
+}
+
+static
+void
+decode(const u_int32_t *w)
+{
+	struct ktrace_rec kr;
+	u_int32_t secs, nsecs;
+
+	kr.kr_secs = w[0];
+	kr.kr_nsecs = w[1];
+	kr.kr_type = w[2];
+	kr.kr_thread = w[3];
+	kr.kr_pid = w[4];
+	kr.kr_arg0 = w[5];
+	kr.kr_arg1 = w[6];
+
+	if (!started) {
+		startsecs = kr.kr_secs;
+		startnsecs = kr.kr_nsecs;
+		started = 1;
+	}
+	secs = kr.kr_secs - startsecs;
+	if (kr.kr_nsecs < startnsecs) {
+		secs--;
+		nsecs = kr.kr_nsecs + 1000000000 - startnsecs;
+	}
+	else {
+		nsecs = kr.kr_nsecs - startnsecs;
+	}
+
+	printf("%4u.%09u  %4u %-5s ", secs, nsecs, kr.kr_pid,
+	       threadname(kr.kr_thread));
+
+	switch (kr.kr_type) {
+	    case KT_SWITCH:
+		printf("switch     from %s (%s)\n",
+		       threadname(kr.kr_arg0), statename(kr.kr_arg1));
+		break;
+	    case KT_TLBFAULT:
+		printf("tlbfault   %s 0x%08x\n",
+		       faultname(kr.kr_arg0), kr.kr_arg1);
+		break;
+	    case KT_PAGEFAULT:
+		printf("pagefault  0x%08x %s\n", kr.kr_arg0,
+		       kr.kr_arg1 ? "from swap" : "zero-fill");
+		break;
+	    case KT_EVICT:
+		printf("evict      0x%08x (paddr 0x%08x)\n",
+		       kr.kr_arg0, kr.kr_arg1);
+		break;
+	    case KT_SWAPIN:
+		printf("swapin     offset 0x%x to paddr 0x%08x\n",
+		       kr.kr_arg0, kr.kr_arg1);
+		break;
+	    case KT_SWAPOUT:
+		printf("swapout    paddr 0x%08x to offset 0x%x\n",
+		       kr.kr_arg1, kr.kr_arg0);
+		break;
+	    case KT_SYSENTER:
+		printf("syscall    %s\n", callname(kr.kr_arg0));
+		break;
+	    case KT_SYSEXIT:
+		if (kr.kr_arg1) {
+			printf("sysret     %s error %u\n",
+			       callname(kr.kr_arg0), kr.kr_arg1);
+		}
+		else {
+			printf("sysret     %s\n", callname(kr.kr_arg0));
+		}
+		break;
+	    case KT_DISKSTART:
+		printf("disk       %s sector %u\n",
+		       kr.kr_arg1 ? "write" : "read", kr.kr_arg0);
+		break;
+	    case KT_DISKDONE:
+		if (kr.kr_arg1) {
+			printf("diskdone   sector %u error %u\n",
+			       kr.kr_arg0, kr.kr_arg1);
+		}
+		else {
+			printf("diskdone   sector %u\n", kr.kr_arg0);
+		}
+		break;
+	    default:
+		printf("type %u    0x%08x 0x%08x\n",
+		       kr.kr_type, kr.kr_arg0, kr.kr_arg1);
+		break;
+	}
+}
+
+/*
+ * A "ktrace dump" line: the tag and then the words in hex.
+ */
+static
+int
+dumpline(const char *line)
+{
+	u_int32_t w[KTRACE_WORDS];
+	const char *s;
+	char *end;
+	int i;
+
+	s = strstr(line, KTRACE_DUMPTAG);
+	if (s == NULL) {
+		return 0;
+	}
+	s += strlen(KTRACE_DUMPTAG);
+	for (i=0; i<KTRACE_WORDS; i++) {
+		w[i] = strtoul(s, &end, 16);
+		if (end == s) {
+			/* "begin" or "end", or damaged */
+			return 1;
+		}
+		s = end;
+	}
+	decode(w);
+	return 1;
+}
+
+/*
+ * An ltrace debug line from sys161. It reports the code written to
+ * the device; take the last number on the line. Records start with
+ * KTRACE_STREAMMAGIC.
+ */
+static
+void
+streamline(const char *line)
+{
+	static u_int32_t w[KTRACE_WORDS];
+	static int nw = -1;
+	const char *s, *num = NULL;
+	u_int32_t val;
+
+	if (strstr(line, "code") == NULL) {
+		return;
+	}
+	for (s = line; *s; s++) {
+		if ((s == line || s[-1] == ' ' || s[-1] == '(') &&
+		    s[0] >= '0' && s[0] <= '9') {
+			num = s;
+		}
+	}
+	if (num == NULL) {
+		return;
+	}
+	val = strtoul(num, NULL, 0);
+
+	if (val == KTRACE_STREAMMAGIC && nw < 0) {
+		nw = 0;
+		return;
+	}
+	if (nw < 0) {
+		return;
+	}
+	w[nw++] = val;
+	if (nw == KTRACE_WORDS) {
+		decode(w);
+		nw = -1;
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	char line[1024];
+	FILE *f = stdin;
+
+	if (argc > 2) {
+		errx(1, "Usage: %s [file]", argv[0]);
+	}
+	if (argc == 2) {
+		f = fopen(argv[1], "r");
+		if (f == NULL) {
+			err(1, "%s", argv[1]);
+		}
+	}
+
+	printf("%14s  %4s %-5s event\n", "time", "pid", "thr");
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (!dumpline(line)) {
+			streamline(line);
+		}
+	}
+
+	if (f != stdin) {
+		fclose(f);
+	}
+	return 0;
+}
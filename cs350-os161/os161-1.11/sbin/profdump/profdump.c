@@ -0,0 +1,382 @@
+/*
+ * profdump - symbolize a kernel profiler dump.
+ *
+ * Usage: host-profdump [-k kernel] [-r root] [file]
+ *
+ * Reads a captured console log containing the output of "prof dump"
+ * from FILE or standard input, and prints, for the kernel and then
+ * for each process, the functions the samples fell in, busiest
+ * first. Kernel PCs are looked up in the ELF file KERNEL (default
+ * "kernel"). User PCs are looked up in the program each process was
+ * running, found by its name under ROOT (default "."), so run it
+ * from the directory the system runs in.
+ *
+ * A bucket covers several instructions, so a sample near the start
+ * of a function can be counted in the function before it.
+ */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <err.h>
+
+#define MAXPROCS   256
+#define NAMELEN    64
+
+/* ELF constants we need */
+#define SHT_SYMTAB  2
+#define STT_NOTYPE  0
+#define STT_FUNC    2
+
+struct sym {
+	u_int32_t addr;
+	const char *name;
+};
+
+struct symtab {
+	struct sym *syms;
+	int nsyms;
+	int loaded;             /* tried to load it */
+};
+
+/* One function's total, while printing. */
+struct hit {
+	const char *name;
+	u_int32_t count;
+};
+
+struct proc {
+	int pid;
+	char name[NAMELEN];
+	struct symtab st;
+};
+
+static struct symtab kernsyms;
+static struct proc procs[MAXPROCS];
+
+/* Samples, as read. proc is -1 for the kernel. */
+struct sample {
+	int proc;
+	u_int32_t pc;
+	u_int32_t count;
+};
+
+static struct sample *samples;
+static int nsamples, maxsamples;
+
+static
+void
+addsample(int proc, u_int32_t pc, u_int32_t count)
+{
+	if (nsamples == maxsamples) {
+		maxsamples = maxsamples ? maxsamples*2 : 256;
+		samples = realloc(samples, maxsamples * sizeof(struct sample));
+		if (samples == NULL) {
+			err(1, "realloc");
+		}
+	}
+	samples[nsamples].proc = proc;
+	samples[nsamples].pc = pc;
+	samples[nsamples].count = count;
+	nsamples++;
+}
+
+////////////////////////////////////////////////////////////
+// ELF symbol tables. OS/161 binaries are big-endian ELF32.
+
+static
+u_int32_t
+get32(const unsigned char *p)
+{
+	return ((u_int32_t)p[0] << 24) | ((u_int32_t)p[1] << 16) |
+		((u_int32_t)p[2] << 8) | p[3];
+}
+
+static
+u_int32_t
+get16(const unsigned char *p)
+{
+	return ((u_int32_t)p[0] << 8) | p[1];
+}
+
+static
+int
+symcmp(const void *a, const void *b)
+{
+	const struct sym *x = a, *y = b;
+
+	if (x->addr < y->addr) return -1;
+	if (x->addr > y->addr) return 1;
+	return 0;
+}
+
+/*
+ * Load the function symbols from the ELF file PATH into ST. Complains
+ * and leaves ST empty if it can't.
+ */
+static
+void
+loadsyms(struct symtab *st, const char *path)
+{
+	FILE *f;
+	long len;
+	unsigned char *img, *sh, *symsh, *strsh, *s;
+	u_int32_t shoff, shentsize, shnum, i, n;
+	u_int32_t symoff, symsize, stroff, strsize, name, type;
+
+	st->loaded = 1;
+
+	f = fopen(path, "rb");
+	if (f == NULL) {
+		warn("%s", path);
+		return;
+	}
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	img = malloc(len);
+	if (img == NULL || fread(img, 1, len, f) != (size_t)len) {
+		warnx("%s: cannot read", path);
+		fclose(f);
+		free(img);
+		return;
+	}
+	fclose(f);
+
+	if (len < 52 || memcmp(img, "\177ELF", 4) || img[4] != 1 ||
+	    img[5] != 2) {
+		warnx("%s: not a big-endian ELF32 file", path);
+		free(img);
+		return;
+	}
+
+	shoff = get32(img+32);
+	shentsize = get16(img+46);
+	shnum = get16(img+48);
+	if (shoff + shnum*shentsize > (u_int32_t)len) {
+		warnx("%s: bad section headers", path);
+		free(img);
+		return;
+	}
+
+	symsh = NULL;
+	for (i=0; i<shnum; i++) {
+		sh = img + shoff + i*shentsize;
+		if (get32(sh+4) == SHT_SYMTAB) {
+			symsh = sh;
+			break;
+		}
+	}
+	if (symsh == NULL || get32(symsh+24) >= shnum) {
+		warnx("%s: no symbol table", path);
+		free(img);
+		return;
+	}
+	strsh = img + shoff + get32(symsh+24)*shentsize;
+
+	symoff = get32(symsh+16);
+	symsize = get32(symsh+20);
+	stroff = get32(strsh+16);
+	strsize = get32(strsh+20);
+	if (symoff + symsize > (u_int32_t)len ||
+	    stroff + strsize > (u_int32_t)len) {
+		warnx("%s: bad symbol table", path);
+		free(img);
+		return;
+	}
+
+	n = symsize / 16;
+	st->syms = malloc(n * sizeof(struct sym));
+	if (st->syms == NULL) {
+		err(1, "malloc");
+	}
+	for (i=0; i<n; i++) {
+		s = img + symoff + i*16;
+		name = get32(s);
+		type = s[12] & 0xf;
+		if (get16(s+14) == 0 || name == 0 || name >= strsize) {
+			continue;
+		}
+		if (type != STT_FUNC && type != STT_NOTYPE) {
+			continue;
+		}
+		/* skip assembler locals */
+		if (img[stroff+name] == '$' || img[stroff+name] == '.') {
+			continue;
+		}
+		st->syms[st->nsyms].addr = get32(s+4);
+		st->syms[st->nsyms].name = (const char *)img + stroff + name;
+		st->nsyms++;
+	}
+	qsort(st->syms, st->nsyms, sizeof(struct sym), symcmp);
+	/* IMG stays allocated; the names point into it */
+}
+
+static
+const char *
+lookup(struct symtab *st, u_int32_t pc)
+{
+	int lo = 0, hi = st->nsyms - 1, mid;
+
+	if (st->nsyms == 0 || pc < st->syms[0].addr) {
+		return NULL;
+	}
+	/* find the last symbol at or below pc */
+	while (lo < hi) {
+		mid = (lo + hi + 1) / 2;
+		if (st->syms[mid].addr <= pc) {
+			lo = mid;
+		}
+		else {
+			hi = mid - 1;
+		}
+	}
+	return st->syms[lo].name;
+}
+
+////////////////////////////////////////////////////////////
+// Reporting
+
+static
+int
+hitcmp(const void *a, const void *b)
+{
+	const struct hit *x = a, *y = b;
+
+	if (x->count > y->count) return -1;
+	if (x->count < y->count) return 1;
+	return strcmp(x->name, y->name);
+}
+
+/*
+ * Print the functions the samples for PROC (-1 for the kernel) fell
+ * in, looked up in ST.
+ */
+static
+void
+report(const char *title, int proc, struct symtab *st)
+{
+	static char unknown[] = "(unknown)";
+	struct hit *hits;
+	const char *name;
+	u_int32_t total = 0;
+	int nhits = 0, i, j;
+
+	hits = malloc((nsamples+1) * sizeof(struct hit));
+	if (hits == NULL) {
+		err(1, "malloc");
+	}
+
+	for (i=0; i<nsamples; i++) {
+		if (samples[i].proc != proc) {
+			continue;
+		}
+		name = lookup(st, samples[i].pc);
+		if (name == NULL) {
+			name = unknown;
+		}
+		for (j=0; j<nhits; j++) {
+			if (!strcmp(hits[j].name, name)) {
+				break;
+			}
+		}
+		if (j == nhits) {
+			hits[nhits].name = name;
+			hits[nhits].count = 0;
+			nhits++;
+		}
+		hits[j].count += samples[i].count;
+		total += samples[i].count;
+	}
+
+	if (total == 0) {
+		free(hits);
+		return;
+	}
+
+	qsort(hits, nhits, sizeof(struct hit), hitcmp);
+	printf("%s: %u samples\n", title, total);
+	for (i=0; i<nhits; i++) {
+		printf("  %8u %5.1f%%  %s\n", hits[i].count,
+		       100.0 * hits[i].count / total, hits[i].name);
+	}
+	printf("\n");
+	free(hits);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *kernel = "kernel", *root = ".";
+	char line[1024], path[1024], title[NAMELEN+64];
+	char name[NAMELEN];
+	unsigned n, pc, count;
+	int pid, i, ch;
+	FILE *f = stdin;
+	const char *s;
+
+	while ((ch = getopt(argc, argv, "k:r:")) != -1) {
+		switch (ch) {
+		    case 'k': kernel = optarg; break;
+		    case 'r': root = optarg; break;
+		    default:
+			errx(1, "Usage: %s [-k kernel] [-r root] [file]",
+			     argv[0]);
+		}
+	}
+	if (optind < argc) {
+		f = fopen(argv[optind], "r");
+		if (f == NULL) {
+			err(1, "%s", argv[optind]);
+		}
+	}
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		s = strstr(line, "prof: ");
+		if (s == NULL) {
+			continue;
+		}
+		s += strlen("prof: ");
+		if (sscanf(s, "k %x %u", &pc, &count) == 2) {
+			addsample(-1, pc, count);
+		}
+		else if (sscanf(s, "p %u %d %63s", &n, &pid, name) == 3) {
+			if (n < MAXPROCS) {
+				procs[n].pid = pid;
+				strcpy(procs[n].name, name);
+			}
+		}
+		else if (sscanf(s, "u %u %x %u", &n, &pc, &count) == 3) {
+			if (n < MAXPROCS) {
+				addsample(n, pc, count);
+			}
+		}
+		else if (!strncmp(s, "begin", 5)) {
+			/* a new dump replaces any earlier one */
+			nsamples = 0;
+			printf("%s", s + 6);
+		}
+	}
+	if (f != stdin) {
+		fclose(f);
+	}
+
+	loadsyms(&kernsyms, kernel);
+	report("Kernel", -1, &kernsyms);
+
+	for (i=0; i<MAXPROCS; i++) {
+		if (procs[i].name[0] == 0) {
+			continue;
+		}
+		snprintf(path, sizeof(path), "%s/%s", root,
+			 procs[i].name[0] == '/' ? procs[i].name+1
+			 : procs[i].name);
+		snprintf(title, sizeof(title), "Process %d (%s)",
+			 procs[i].pid, procs[i].name);
+		loadsyms(&procs[i].st, path);
+		report(title, i, &procs[i].st);
+	}
+	return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * aiobench - overlap computation with file reads using async I/O.
+ *
+ * Usage: aiobench [kbytes] [work]
+ *
+ * Writes a scratch file of KBYTES kilobytes, then reads it back in
+ * CHUNK-sized pieces twice, doing WORK rounds of computation on each
+ * piece: first with plain read(), then with aio_submit/aio_wait,
+ * keeping the next read in flight while the current piece is
+ * processed. Reports the time each way and checks both passes saw
+ * the same data.
+ */
+
+#include <aio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+
+#define DEFAULT_KBYTES  256
+#define DEFAULT_WORK    4
+#define CHUNK           4096
+
+#define FILENAME        "aiobench.tmp"
+
+static char bufs[2][CHUNK];
+
+/* The "computation": a checksum, repeated WORK times. */
+static
+unsigned
+process(const char *buf, int len, int work)
+{
+	unsigned sum = 0;
+	int i, w;
+
+	for (w=0; w<work; w++) {
+		for (i=0; i<len; i++) {
+			sum = sum*31 + (unsigned char)buf[i];
+		}
+	}
+	return sum;
+}
+
+static
+void
+makefile(int fd, int nchunks)
+{
+	int i, j;
+
+	for (i=0; i<nchunks; i++) {
+		for (j=0; j<CHUNK; j++) {
+			bufs[0][j] = i+j;
+		}
+		if (write(fd, bufs[0], CHUNK) != CHUNK) {
+			err(1, "%s: write", FILENAME);
+		}
+	}
+}
+
+static
+unsigned
+plain(int fd, int nchunks, int work)
+{
+	unsigned sum = 0;
+	int i;
+
+	if (lseek(fd, 0, SEEK_SET) < 0) {
+		err(1, "lseek");
+	}
+	for (i=0; i<nchunks; i++) {
+		if (read(fd, bufs[0], CHUNK) != CHUNK) {
+			err(1, "%s: read", FILENAME);
+		}
+		sum += process(bufs[0], CHUNK, work);
+	}
+	return sum;
+}
+
+static
+int
+submit(int fd, int chunk)
+{
+	struct aiocb cb;
+	int id;
+
+	cb.aio_op = AIO_READ;
+	cb.aio_fd = fd;
+	cb.aio_buf = bufs[chunk % 2];
+	cb.aio_nbytes = CHUNK;
+	cb.aio_offset = chunk * CHUNK;
+	id = aio_submit(&cb);
+	if (id < 0) {
+		err(1, "aio_submit");
+	}
+	return id;
+}
+
+static
+unsigned
+async(int fd, int nchunks, int work)
+{
+	unsigned sum = 0;
+	int i, id, next = -1;
+
+	id = submit(fd, 0);
+	for (i=0; i<nchunks; i++) {
+		if (aio_wait(id, 0) != CHUNK) {
+			err(1, "aio_wait");
+		}
+		/* start the next read before working on this one */
+		if (i+1 < nchunks) {
+			next = submit(fd, i+1);
+		}
+		sum += process(bufs[i % 2], CHUNK, work);
+		id = next;
+	}
+	return sum;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int kbytes = DEFAULT_KBYTES, work = DEFAULT_WORK;
+	unsigned long start, plainms, asyncms;
+	unsigned sum1, sum2;
+	int fd, nchunks;
+
+	if (argc > 1) {
+		kbytes = atoi(argv[1]);
+	}
+	if (argc > 2) {
+		work = atoi(argv[2]);
+	}
+	nchunks = kbytes*1024 / CHUNK;
+	if (nchunks < 1 || work < 1) {
+		errx(1, "Usage: aiobench [kbytes (min %d)] [work]",
+		     CHUNK/1024);
+	}
+
+	fd = open(FILENAME, O_RDWR|O_CREAT);
+	if (fd < 0) {
+		err(1, "%s", FILENAME);
+	}
+	makefile(fd, nchunks);
+
+	start = __time_ms();
+	sum1 = plain(fd, nchunks, work);
+	plainms = __time_ms() - start;
+
+	start = __time_ms();
+	sum2 = async(fd, nchunks, work);
+	asyncms = __time_ms() - start;
+
+	close(fd);
+
+	if (sum1 != sum2) {
+		errx(1, "checksum mismatch: %u plain, %u async", sum1, sum2);
+	}
+	printf("%d KB in %d-byte reads, work %d\n", kbytes, CHUNK, work);
+	printf("plain: %lu ms\n", plainms);
+	printf("async: %lu ms\n", asyncms);
+	return 0;
+}
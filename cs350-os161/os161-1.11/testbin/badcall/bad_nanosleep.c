@@ -0,0 +1,65 @@
+/*
+ * nanosleep
+ */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <err.h>
+
+#include "config.h"
+#include "test.h"
+
+static
+void
+nanosleep_badreq(void *ptr, const char *desc)
+{
+	int rv;
+
+	rv = nanosleep(ptr, NULL);
+	report_test(rv, errno, EFAULT, desc);
+}
+
+static
+void
+nanosleep_badrem(void *ptr, const char *desc)
+{
+	struct timespec ts;
+	int rv;
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 1000;
+	rv = nanosleep(&ts, ptr);
+	report_test(rv, errno, EFAULT, desc);
+}
+
+static
+void
+nanosleep_badtime(time_t secs, long nsecs, const char *desc)
+{
+	struct timespec ts;
+	int rv;
+
+	ts.tv_sec = secs;
+	ts.tv_nsec = nsecs;
+	rv = nanosleep(&ts, NULL);
+	report_test(rv, errno, EINVAL, desc);
+}
+
+void
+test_nanosleep(void)
+{
+	nanosleep_badreq(NULL, "nanosleep with NULL time");
+	nanosleep_badreq(INVAL_PTR, "nanosleep with invalid time pointer");
+	nanosleep_badreq(KERN_PTR, "nanosleep with kernel time pointer");
+
+	nanosleep_badrem(INVAL_PTR, "nanosleep with invalid rem pointer");
+	nanosleep_badrem(KERN_PTR, "nanosleep with kernel rem pointer");
+
+	nanosleep_badtime(-1, 0, "nanosleep with negative seconds");
+	nanosleep_badtime(0, -1, "nanosleep with negative nanoseconds");
+	nanosleep_badtime(0, 1000000000, "nanosleep with 1000000000 ns");
+}
@@ -185,11 +185,12 @@ struct {
 	{ 'z', 2, "__getcwd",		test_getcwd },
 	{ '{', 5, "stat",		test_stat },
 	{ '|', 5, "lstat",		test_lstat },
+	{ '}', 2, "nanosleep",		test_nanosleep },
 	{ 0, 0, NULL, NULL }
 };
 
 #define LOWEST  'a'
-#define HIGHEST '|'
+#define HIGHEST '}'
 
 static
 void
@@ -72,3 +72,4 @@ void test_time(void);
 void test_getcwd(void);
 void test_stat(void);
 void test_lstat(void);		/* in bad_stat.c */
+void test_nanosleep(void);
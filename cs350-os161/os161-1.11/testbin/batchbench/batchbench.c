@@ -0,0 +1,138 @@
+/*
+ * batchbench - compare plain and batched system calls.
+ *
+ * Usage: batchbench [count] [size]
+ *
+ * Writes COUNT records of SIZE bytes to a scratch file, first with
+ * one write() per record and then again through the batched syscall
+ * ring, one __batch_submit per BATCH_RING_SIZE records, and reports
+ * the time each way. The file is then checked to be the right size.
+ */
+
+#include <sys/batch.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <err.h>
+
+#define DEFAULT_COUNT  1000
+#define DEFAULT_SIZE   16
+#define MAXSIZE        512
+
+#define FILENAME       "batchbench.tmp"
+
+static char buf[MAXSIZE];
+static struct batch_ring ring;
+
+static
+void
+plain(int fd, int count, int size)
+{
+	int i, r;
+
+	for (i=0; i<count; i++) {
+		r = write(fd, buf, size);
+		if (r != size) {
+			err(1, "write %d", i);
+		}
+	}
+}
+
+/*
+ * Drain the completion queue, checking each write went through in
+ * full. Returns the number of completions seen.
+ */
+static
+int
+reap(int size)
+{
+	struct batch_cqe cqe;
+	int n = 0;
+
+	while (batch_reap(&ring, &cqe)) {
+		if (cqe.bc_result < 0) {
+			errno = -cqe.bc_result;
+			err(1, "batched write %u", cqe.bc_cookie);
+		}
+		if (cqe.bc_result != size) {
+			errx(1, "batched write %u: short write %d",
+			     cqe.bc_cookie, cqe.bc_result);
+		}
+		n++;
+	}
+	return n;
+}
+
+static
+void
+batched(int fd, int count, int size)
+{
+	int queued = 0, done = 0;
+
+	while (done < count) {
+		while (queued < count &&
+		       batch_queue(&ring, BATCH_WRITE, fd, buf, size,
+				   0, queued) == 0) {
+			queued++;
+		}
+		if (batch_submit(&ring) < 0) {
+			err(1, "__batch_submit");
+		}
+		done += reap(size);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	int count = DEFAULT_COUNT, size = DEFAULT_SIZE;
+	unsigned long start, plainms, batchms;
+	int fd, end;
+
+	if (argc > 1) {
+		count = atoi(argv[1]);
+	}
+	if (argc > 2) {
+		size = atoi(argv[2]);
+	}
+	if (count < 1 || size < 1 || size > MAXSIZE) {
+		errx(1, "Usage: batchbench [count] [size (max %d)]", MAXSIZE);
+	}
+	memset(buf, 'b', size);
+
+	if (batch_init(&ring) < 0) {
+		err(1, "__batch_register");
+	}
+
+	fd = open(FILENAME, O_WRONLY|O_CREAT|O_TRUNC);
+	if (fd < 0) {
+		err(1, "%s", FILENAME);
+	}
+
+	start = __time_ms();
+	plain(fd, count, size);
+	plainms = __time_ms() - start;
+
+	/* overwrite the same records */
+	if (lseek(fd, 0, SEEK_SET) < 0) {
+		err(1, "lseek");
+	}
+
+	start = __time_ms();
+	batched(fd, count, size);
+	batchms = __time_ms() - start;
+
+	end = lseek(fd, 0, SEEK_END);
+	if (end != count*size) {
+		errx(1, "%s is %d bytes, expected %d", FILENAME, end,
+		     count*size);
+	}
+	close(fd);
+
+	printf("%d writes of %d bytes\n", count, size);
+	printf("plain:   %lu ms\n", plainms);
+	printf("batched: %lu ms (%d per submit)\n", batchms, BATCH_RING_SIZE);
+	return 0;
+}
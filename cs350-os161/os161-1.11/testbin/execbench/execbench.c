@@ -0,0 +1,64 @@
+/*
+ * execbench - measure how long it takes to start a program.
+ *
+ * Usage: execbench [program] [count]
+ *
+ * Runs PROGRAM (default /bin/true) COUNT times, one after another,
+ * waiting for each, and prints the average time per run. Compare the
+ * numbers with the kernel's ELF cache on and off ("elfcache on" and
+ * "elfcache off" at the kernel menu).
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <err.h>
+
+#define DEFAULT_PROG   "/bin/true"
+#define DEFAULT_COUNT  100
+
+int
+main(int argc, char *argv[])
+{
+	const char *prog = DEFAULT_PROG;
+	int count = DEFAULT_COUNT;
+	char *args[2];
+	int i, pid, status, failures = 0;
+	unsigned long start, total;
+
+	if (argc > 1) {
+		prog = argv[1];
+	}
+	if (argc > 2) {
+		count = atoi(argv[2]);
+	}
+	if (count < 1) {
+		errx(1, "Usage: execbench [program] [count]");
+	}
+
+	args[0] = (char *)prog;
+	args[1] = NULL;
+
+	start = __time_ms();
+	for (i=0; i<count; i++) {
+		pid = spawnv(prog, args);
+		if (pid < 0) {
+			err(1, "%s", prog);
+		}
+		if (waitpid(pid, &status, 0) < 0) {
+			err(1, "waitpid");
+		}
+		if (status != 0) {
+			failures++;
+		}
+	}
+	total = __time_ms() - start;
+
+	printf("%s: %d runs in %lu ms, %lu us per run\n", prog, count,
+	       total, total * 1000 / count);
+	if (failures > 0) {
+		warnx("%d runs exited with nonzero status", failures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * fastcall - compare getpid() and __time() through the user page
+ * against the real system calls.
+ *
+ * Usage: fastcall [count]
+ *
+ * Checks the two ways agree, then makes COUNT calls each way and
+ * reports how long they took.
+ */
+
+#include <sys/types.h>
+#include <sys/userpage.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <err.h>
+
+#define DEFAULT_COUNT 20000
+
+static
+unsigned long
+loop(const char *what, int count, int which)
+{
+	unsigned long start, ms;
+	time_t secs;
+	int i;
+
+	start = __time_ms();
+	for (i=0; i<count; i++) {
+		switch (which) {
+		    case 0: getpid(); break;
+		    case 1: __sys_getpid(); break;
+		    case 2: __time(&secs, NULL); break;
+		    case 3: __sys___time(&secs, NULL); break;
+		}
+	}
+	ms = __time_ms() - start;
+	printf("%-14s %8lu ms\n", what, ms);
+	return ms;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int count = DEFAULT_COUNT;
+	time_t fast, slow;
+
+	if (argc > 1) {
+		count = atoi(argv[1]);
+	}
+	if (count < 1) {
+		errx(1, "Usage: fastcall [count]");
+	}
+
+	if (getpid() != __sys_getpid()) {
+		errx(1, "getpid: page says %d, kernel says %d",
+		     getpid(), __sys_getpid());
+	}
+	/* the page lags by at most a tick */
+	fast = __time(NULL, NULL);
+	slow = __sys___time(NULL, NULL);
+	if (slow - fast > 1 || fast > slow) {
+		errx(1, "__time: page says %ld, kernel says %ld",
+		     (long) fast, (long) slow);
+	}
+
+	printf("%d calls each\n", count);
+	loop("getpid", count, 0);
+	loop("sys getpid", count, 1);
+	loop("__time", count, 2);
+	loop("sys __time", count, 3);
+	return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * forkbench - measure fork throughput.
+ *
+ * Usage: forkbench [forks] [forkers]
+ *
+ * First one process forks FORKS children one after another, each of
+ * which exits right away, and waits for each. Then FORKERS processes
+ * do the same thing at the same time, FORKS/FORKERS children each.
+ * If fork is serialized across the system the second number will be
+ * no better than the first.
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <err.h>
+
+#define DEFAULT_FORKS    200
+#define DEFAULT_FORKERS  4
+
+/*
+ * Fork and reap N children that exit immediately.
+ */
+static
+void
+forkloop(int n)
+{
+	int i, pid, status;
+
+	for (i=0; i<n; i++) {
+		pid = fork();
+		if (pid < 0) {
+			err(1, "fork");
+		}
+		if (pid == 0) {
+			_exit(0);
+		}
+		if (waitpid(pid, &status, 0) < 0) {
+			err(1, "waitpid");
+		}
+	}
+}
+
+static
+void
+report(const char *what, int n, unsigned long ms)
+{
+	if (ms == 0) {
+		ms = 1;
+	}
+	printf("%s: %d forks in %lu ms (%lu forks/sec)\n",
+	       what, n, ms, (unsigned long)n*1000/ms);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int nforks = DEFAULT_FORKS, nforkers = DEFAULT_FORKERS;
+	int pids[32];
+	int i, status, failed = 0;
+	unsigned long start;
+
+	if (argc > 1) {
+		nforks = atoi(argv[1]);
+	}
+	if (argc > 2) {
+		nforkers = atoi(argv[2]);
+	}
+	if (nforks < 1 || nforkers < 1 || nforkers > 32) {
+		errx(1, "Usage: forkbench [forks] [forkers (1-32)]");
+	}
+
+	start = __time_ms();
+	forkloop(nforks);
+	report("serial", nforks, __time_ms() - start);
+
+	start = __time_ms();
+	for (i=0; i<nforkers; i++) {
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			err(1, "fork");
+		}
+		if (pids[i] == 0) {
+			forkloop(nforks / nforkers);
+			_exit(0);
+		}
+	}
+	for (i=0; i<nforkers; i++) {
+		if (waitpid(pids[i], &status, 0) < 0) {
+			warn("waitpid");
+			failed = 1;
+		}
+	}
+	report("concurrent", (nforks / nforkers) * nforkers + nforkers,
+	       __time_ms() - start);
+
+	return failed;
+}
@@ -18,19 +18,11 @@ static
 void
 sink(void)
 {
-	int pid = fork();
-	switch (pid) {
-	    case -1:
-		err(1, "fork");
-	    case 0:
-		/* child */
-		execv("/testbin/sink", sargv);
+	int pid = spawnv("/testbin/sink", sargv);
+	if (pid < 0) {
 		err(1, "/testbin/sink");
-	    default:
-		/* parent */
-		pids[npids++] = pid;
-		break;
 	}
+	pids[npids++] = pid;
 }
 
 static
@@ -206,25 +206,52 @@ status_is_failure(int status)
 	return status != 0;
 }
 
+/*
+ * Start job MYNUM in a new process. On OS/161 we spawn a fresh copy
+ * of ourselves (PROG) with the job number as its argument, so no
+ * address space gets copied just to be thrown away.
+ */
+static
+pid_t
+startjob(const char *prog, int mynum)
+{
+#ifdef HOST
+	pid_t pid;
+
+	(void)prog;
+	pid = fork();
+	if (pid==0) {
+		/* child */
+		go(mynum);
+	}
+	return pid;
+#else
+	char numstr[16];
+	char *args[3];
+
+	snprintf(numstr, sizeof(numstr), "%d", mynum);
+	args[0] = (char *)prog;
+	args[1] = numstr;
+	args[2] = NULL;
+	return spawnv(prog, args);
+#endif
+}
+
 static
 void
-makeprocs(void)
+makeprocs(const char *prog)
 {
 	int i, status, failcount;
 	pid_t pids[NJOBS];
 
 	printf("Job size approximately %lu bytes\n", (unsigned long) JOBSIZE);
-	printf("Forking %d jobs; total load %luk\n", NJOBS,
+	printf("Starting %d jobs; total load %luk\n", NJOBS,
 	       (unsigned long) (NJOBS * JOBSIZE)/1024);
 
 	for (i=0; i<NJOBS; i++) {
-		pids[i] = fork();
+		pids[i] = startjob(prog, i);
 		if (pids[i]<0) {
-			warn("fork");
-		}
-		if (pids[i]==0) {
-			/* child */
-			go(i);
+			warn("%s", prog);
 		}
 	}
 
@@ -251,8 +278,19 @@ makeprocs(void)
 }
 
 int
-main()
+main(int argc, char *argv[])
 {
-	makeprocs();
+	int mynum;
+
+	if (argc == 2) {
+		/* we are one of the jobs */
+		mynum = atoi(argv[1]);
+		if (mynum < 0 || mynum >= NJOBS) {
+			errx(1, "Invalid job number %d", mynum);
+		}
+		go(mynum);
+	}
+
+	makeprocs(argc > 0 && argv[0] != NULL ? argv[0] : "/testbin/parallelvm");
 	return 0;
 }
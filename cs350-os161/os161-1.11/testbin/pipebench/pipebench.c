@@ -0,0 +1,125 @@
+/*
+ * pipebench - measure pipe throughput between two processes.
+ *
+ * Usage: pipebench [kbytes] [chunksize]
+ *
+ * Creates a pipe and starts a second copy of itself that reads from
+ * it until end of file. Then writes KBYTES kilobytes into the pipe in
+ * CHUNKSIZE-byte writes and reports the rate. Writes larger than the
+ * pipe's buffer exercise the direct writer-to-reader copy.
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+
+#define DEFAULT_KBYTES  1024
+#define DEFAULT_CHUNK   8192
+#define MAXCHUNK        65536
+
+static char buf[MAXCHUNK];
+
+/*
+ * Reader side: read FD to end of file and check that EXPECT bytes
+ * came through. WFD is our copy of the write end, inherited through
+ * spawnv; it has to be closed first, or end of file never comes.
+ */
+static
+int
+reader(int fd, int wfd, unsigned long expect)
+{
+	unsigned long total = 0;
+	int r;
+
+	close(wfd);
+
+	while ((r = read(fd, buf, sizeof(buf))) > 0) {
+		total += r;
+	}
+	if (r < 0) {
+		err(1, "read");
+	}
+	if (total != expect) {
+		errx(1, "reader: got %lu bytes, expected %lu", total, expect);
+	}
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int kbytes = DEFAULT_KBYTES, chunk = DEFAULT_CHUNK;
+	unsigned long total, left, start, ms;
+	char fdstr[16], wfdstr[16], sizestr[16];
+	char *args[6];
+	int fds[2], pid, status, w;
+
+	if (argc == 5 && !strcmp(argv[1], "-r")) {
+		/* we are the reader */
+		return reader(atoi(argv[2]), atoi(argv[3]),
+			      (unsigned long)atoi(argv[4]));
+	}
+
+	if (argc > 1) {
+		kbytes = atoi(argv[1]);
+	}
+	if (argc > 2) {
+		chunk = atoi(argv[2]);
+	}
+	if (kbytes < 1 || chunk < 1 || chunk > MAXCHUNK) {
+		errx(1, "Usage: pipebench [kbytes] [chunksize (max %d)]",
+		     MAXCHUNK);
+	}
+	total = (unsigned long)kbytes * 1024;
+
+	if (pipe(fds) < 0) {
+		err(1, "pipe");
+	}
+
+	snprintf(fdstr, sizeof(fdstr), "%d", fds[0]);
+	snprintf(wfdstr, sizeof(wfdstr), "%d", fds[1]);
+	snprintf(sizestr, sizeof(sizestr), "%lu", total);
+	args[0] = argv[0];
+	args[1] = (char *)"-r";
+	args[2] = fdstr;
+	args[3] = wfdstr;
+	args[4] = sizestr;
+	args[5] = NULL;
+
+	start = __time_ms();
+
+	pid = spawnv(argv[0], args);
+	if (pid < 0) {
+		err(1, "%s", argv[0]);
+	}
+
+	/* the reader has its own copy of the read end */
+	close(fds[0]);
+
+	memset(buf, 'p', chunk);
+	for (left = total; left > 0; left -= w) {
+		w = write(fds[1], buf, left < (unsigned long)chunk ?
+			  (int)left : chunk);
+		if (w <= 0) {
+			err(1, "write");
+		}
+	}
+	close(fds[1]);
+
+	if (waitpid(pid, &status, 0) < 0) {
+		err(1, "waitpid");
+	}
+	ms = __time_ms() - start;
+	if (status != 0) {
+		errx(1, "reader failed (exit %d)", status);
+	}
+	if (ms == 0) {
+		ms = 1;
+	}
+
+	printf("%lu bytes in %lu ms (%lu KB/sec), %d-byte writes\n",
+	       total, ms, (unsigned long)kbytes * 1000 / ms, chunk);
+	return 0;
+}
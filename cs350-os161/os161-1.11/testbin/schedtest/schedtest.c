@@ -0,0 +1,100 @@
+/*
+ * schedtest - check an interactive process stays responsive next to
+ * CPU hogs.
+ *
+ * Usage: schedtest [hogs] [rounds]
+ *
+ * Starts HOGS copies of itself that just compute, then ROUNDS times
+ * sleeps for SLEEPMS milliseconds and measures how late it woke up,
+ * like a shell waiting for keystrokes. Reports the average and worst
+ * lateness, then waits for the hogs to finish their (fixed) work.
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <err.h>
+
+#define DEFAULT_HOGS    3
+#define DEFAULT_ROUNDS  50
+#define MAXHOGS         16
+#define SLEEPMS         20
+#define HOGWORK         4000
+
+/* Hog: compute for a while, then exit. */
+static
+void
+hog(void)
+{
+	volatile unsigned sum = 0;
+	int i, j;
+
+	for (i=0; i<HOGWORK; i++) {
+		for (j=0; j<10000; j++) {
+			sum += i*j;
+		}
+	}
+	exit(0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	pid_t pids[MAXHOGS];
+	struct timespec ts;
+	unsigned long start, late, total = 0, worst = 0;
+	char *args[3];
+	int hogs = DEFAULT_HOGS, rounds = DEFAULT_ROUNDS;
+	int i, status;
+
+	if (argc == 2 && argv[1][0] == '-') {
+		hog();
+	}
+	if (argc > 1) {
+		hogs = atoi(argv[1]);
+	}
+	if (argc > 2) {
+		rounds = atoi(argv[2]);
+	}
+	if (hogs < 0 || hogs > MAXHOGS || rounds < 1) {
+		errx(1, "Usage: schedtest [hogs (max %d)] [rounds]", MAXHOGS);
+	}
+
+	args[0] = argv[0];
+	args[1] = (char *)"-";
+	args[2] = NULL;
+	for (i=0; i<hogs; i++) {
+		pids[i] = spawnv(argv[0], args);
+		if (pids[i] < 0) {
+			err(1, "%s", argv[0]);
+		}
+	}
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = SLEEPMS * 1000000;
+	for (i=0; i<rounds; i++) {
+		start = __time_ms();
+		if (nanosleep(&ts, NULL) < 0) {
+			err(1, "nanosleep");
+		}
+		late = __time_ms() - start;
+		late = late > SLEEPMS ? late - SLEEPMS : 0;
+		total += late;
+		if (late > worst) {
+			worst = late;
+		}
+	}
+
+	printf("%d hogs, %d sleeps of %d ms\n", hogs, rounds, SLEEPMS);
+	printf("woke late by %lu ms on average, %lu ms at worst\n",
+	       total / rounds, worst);
+
+	for (i=0; i<hogs; i++) {
+		if (waitpid(pids[i], &status, 0) < 0) {
+			err(1, "waitpid");
+		}
+	}
+	return 0;
+}
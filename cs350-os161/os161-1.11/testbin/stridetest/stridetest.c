@@ -0,0 +1,164 @@
+/*
+ * stridetest - check CPU time is shared out in proportion to tickets.
+ *
+ * Usage: stridetest [tickets ...]
+ *
+ * Forks one child per ticket count given (default 100 200 300). Each
+ * takes its tickets with __tickets and then just computes until a
+ * common finishing time, RUNSECS seconds after they all start. The
+ * parent sleeps through this, then reads how many clock ticks each
+ * child was charged and compares each child's share of the total
+ * with its share of the tickets. Fails if any is more than TOLERANCE
+ * tenths of a percent off.
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/psinfo.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <err.h>
+
+#define MAXKIDS     8
+#define MAXPROCS    256
+#define RUNSECS     3
+#define STARTMS     200    /* time for everyone to get going */
+#define TOLERANCE   50     /* in tenths of a percent */
+
+static struct psinfo procs[MAXPROCS];
+
+static
+void
+sleep_ms(unsigned long ms)
+{
+	struct timespec ts;
+
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000;
+	if (nanosleep(&ts, NULL) < 0) {
+		err(1, "nanosleep");
+	}
+}
+
+/* Child: take TICKETS tickets, then compute from START until END. */
+static
+void
+spin(int tickets, unsigned long start, unsigned long end)
+{
+	volatile unsigned sum = 0;
+	unsigned long now;
+	int i;
+
+	if (__tickets(0, tickets) < 0) {
+		err(1, "__tickets");
+	}
+	now = __time_ms();
+	if (now < start) {
+		sleep_ms(start - now);
+	}
+	while (__time_ms() < end) {
+		for (i=0; i<1000; i++) {
+			sum += i;
+		}
+	}
+	_exit(0);
+}
+
+/* Ticks charged to PID, which must have exited but not been reaped. */
+static
+unsigned long
+ticks(pid_t pid)
+{
+	int n, i;
+
+	n = __psinfo(procs, MAXPROCS);
+	if (n < 0) {
+		err(1, "__psinfo");
+	}
+	for (i=0; i<n; i++) {
+		if (procs[i].ps_pid == pid) {
+			if (procs[i].ps_state != PS_ZOMB) {
+				errx(1, "pid %d still running", pid);
+			}
+			return procs[i].ps_utime + procs[i].ps_stime;
+		}
+	}
+	errx(1, "pid %d not found", pid);
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	int tickets[MAXKIDS] = { 100, 200, 300 };
+	pid_t pids[MAXKIDS];
+	unsigned long used[MAXKIDS];
+	unsigned long start, end, total = 0, want, got, off;
+	int nkids = 3, totaltix = 0, bad = 0;
+	int i, status;
+
+	if (argc > 1) {
+		nkids = argc - 1;
+		if (nkids > MAXKIDS) {
+			errx(1, "Usage: stridetest [tickets ...] (max %d)",
+			     MAXKIDS);
+		}
+		for (i=0; i<nkids; i++) {
+			tickets[i] = atoi(argv[i+1]);
+			if (tickets[i] < 1) {
+				errx(1, "%s: bad ticket count", argv[i+1]);
+			}
+		}
+	}
+	for (i=0; i<nkids; i++) {
+		totaltix += tickets[i];
+	}
+
+	start = __time_ms() + STARTMS;
+	end = start + RUNSECS*1000;
+	for (i=0; i<nkids; i++) {
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			err(1, "fork");
+		}
+		if (pids[i] == 0) {
+			spin(tickets[i], start, end);
+		}
+	}
+
+	/* stay out of the way until they're all done */
+	sleep_ms(end - __time_ms() + 500);
+
+	for (i=0; i<nkids; i++) {
+		used[i] = ticks(pids[i]);
+		total += used[i];
+	}
+	for (i=0; i<nkids; i++) {
+		if (waitpid(pids[i], &status, 0) < 0) {
+			err(1, "waitpid");
+		}
+	}
+	if (total == 0) {
+		errx(1, "no time charged");
+	}
+
+	printf("%5s %7s %7s %7s\n", "pid", "tickets", "want", "got");
+	for (i=0; i<nkids; i++) {
+		/* shares in tenths of a percent */
+		want = tickets[i] * 1000UL / totaltix;
+		got = used[i] * 1000 / total;
+		off = got > want ? got - want : want - got;
+		printf("%5d %7d %5lu.%lu%% %5lu.%lu%%\n", pids[i], tickets[i],
+		       want / 10, want % 10, got / 10, got % 10);
+		if (off > TOLERANCE) {
+			bad = 1;
+		}
+	}
+	if (bad) {
+		errx(1, "shares off by more than %d.%d%%",
+		     TOLERANCE / 10, TOLERANCE % 10);
+	}
+	printf("stridetest: passed\n");
+	return 0;
+}
@@ -11,19 +11,11 @@
 
 static
 pid_t
-spawnv(const char *prog, char **argv)
+spawn(const char *prog, char **argv)
 {
-	pid_t pid = fork();
-	switch (pid) {
-	    case -1:
-		err(1, "fork");
-	    case 0:
-		/* child */
-		execv(prog, argv);
-		err(1, "%s: execv", prog);
-	    default:
-		/* parent */
-		break;
+	pid_t pid = spawnv(prog, argv);
+	if (pid < 0) {
+		err(1, "%s: spawnv", prog);
 	}
 	return pid;
 }
@@ -59,7 +51,7 @@ triple(const char *prog)
 	warnx("Starting: running three copies of %s...", prog);
 
 	for (i=0; i<3; i++) {
-		pids[i]=spawnv(args[0], args);
+		pids[i]=spawn(args[0], args);
 	}
 
 	for (i=0; i<3; i++) {
@@ -3,17 +3,13 @@
  * forks 3 threads off 2 to functions, each of which displays a string
  * every once in a while.
  *
- * This won't do much of anything unless you implement user-level
- * threads.
- *
- * It also makes various assumptions about the thread API. In
- * particular, it believes (1) that you create a thread by calling
- * "threadfork()" and passing the address for execution of the new
- * thread to begin at, (2) that if the parent thread exits any child
- * threads will keep running, and (3) child threads will exit if they
- * return from the function they started in. If any or all of these
- * assumptions are not met by your user-level threads, you will need
- * to patch this test accordingly.
+ * It makes various assumptions about the thread API. In particular,
+ * it believes (1) that you create a thread by calling "threadfork()"
+ * and passing the address for execution of the new thread to begin
+ * at, (2) that "threadjoin()" waits for a thread to finish, and (3)
+ * child threads will exit if they return from the function they
+ * started in. Returning from main exits the whole process, so the
+ * parent joins its threads first.
  *
  * This is also a rather basic test and you'll probably want to write
  * some more of your own.
@@ -22,6 +18,7 @@
 
 #include <unistd.h>
 #include <stdio.h>
+#include <err.h>
 
 #define NTHREADS  3
 #define MAX       1<<25
@@ -38,16 +35,23 @@ void BladeRunner(void);
 int
 main(int argc, char *argv[])
 {
-    int i;
+    int i, tids[NTHREADS];
 
     (void)argc;
     (void)argv;
 
     for (i=0; i<NTHREADS; i++) {
 	if (i)
-	    threadfork(ThreadRunner);
+	    tids[i] = threadfork(ThreadRunner);
         else
-	    threadfork(BladeRunner);
+	    tids[i] = threadfork(BladeRunner);
+	if (tids[i] < 0)
+	    err(1, "threadfork");
+    }
+
+    for (i=0; i<NTHREADS; i++) {
+	if (threadjoin(tids[i], NULL) < 0)
+	    err(1, "threadjoin");
     }
 
     printf("Parent has left.\n");
@@ -0,0 +1,95 @@
+/*
+ * waittest - test waiting for any child and WNOHANG.
+ *
+ * Starts NKIDS copies of itself, each of which sleeps a little and
+ * exits with its own code. Checks that WNOHANG returns 0 while none
+ * have exited, that waitpid(-1) collects every child exactly once
+ * with the right exit code, and that a further waitpid(-1) fails
+ * with ECHILD.
+ */
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <err.h>
+
+#define NKIDS  8
+
+/* Child: sleep for a while, longer for higher numbers, then exit. */
+static
+void
+child(int n)
+{
+	struct timespec ts;
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = (n+1) * 50000000;
+	if (nanosleep(&ts, NULL) < 0) {
+		err(1, "nanosleep");
+	}
+	exit(n+10);
+}
+
+int
+main(int argc, char *argv[])
+{
+	pid_t pids[NKIDS], pid;
+	int seen[NKIDS];
+	char numstr[16];
+	char *args[3];
+	int i, status, found;
+
+	if (argc == 2) {
+		child(atoi(argv[1]));
+	}
+
+	for (i=0; i<NKIDS; i++) {
+		snprintf(numstr, sizeof(numstr), "%d", i);
+		args[0] = argv[0];
+		args[1] = numstr;
+		args[2] = NULL;
+		pids[i] = spawnv(argv[0], args);
+		if (pids[i] < 0) {
+			err(1, "%s", argv[0]);
+		}
+		seen[i] = 0;
+	}
+
+	pid = waitpid(-1, &status, WNOHANG);
+	if (pid < 0) {
+		err(1, "waitpid WNOHANG");
+	}
+	printf("WNOHANG right after starting: %d\n", pid);
+
+	for (found=0; found<NKIDS; ) {
+		pid = waitpid(-1, &status, 0);
+		if (pid < 0) {
+			err(1, "waitpid");
+		}
+		for (i=0; i<NKIDS && pids[i] != pid; i++);
+		if (i == NKIDS) {
+			errx(1, "waitpid returned unknown pid %d", pid);
+		}
+		if (seen[i]) {
+			errx(1, "pid %d reaped twice", pid);
+		}
+		if (status != i+10) {
+			errx(1, "pid %d: exit code %d, expected %d", pid,
+			     status, i+10);
+		}
+		seen[i] = 1;
+		found++;
+	}
+
+	pid = waitpid(-1, &status, 0);
+	if (pid >= 0 || errno != ECHILD) {
+		errx(1, "waitpid with no children: got %d, errno %d",
+		     pid, errno);
+	}
+
+	printf("waittest: passed\n");
+	return 0;
+}